@@ -0,0 +1,84 @@
+// dos.c - time DOS calls through libdos.a and inline (__DOS_INLINE__)
+//
+// Both paths are in the one binary: _dos_xxx(...) expands to the inline
+// trap, (_dos_xxx)(...) calls the library stub. The difference per call is
+// the stub's jsr/rts and argument copy; under run68 the DOS call itself
+// runs natively, so it shows larger there than on real hardware.
+
+#define __DOS_INLINE__
+#include <stdio.h>
+#include <time.h>
+#include <sys/dos.h>
+
+// timing a stub left as a library call would compare it with itself
+#if !defined(_dos_curdrv) || !defined(_dos_seek) || !defined(_dos_write) \
+    || !defined(_dos_read) || !defined(_dos_fgetc)
+#error "not inlined"
+#endif
+
+#define LOOPS 20000
+
+static char data[LOOPS];
+static char buf[4];
+static volatile long ir;
+static clock_t empty;
+
+// microseconds per call, to one decimal
+static long tenths(clock_t t)
+{
+    t -= empty;
+    if (t < 0)
+        t = 0;
+    return (long)((double)t * 1e7 / CLOCKS_PER_SEC / LOOPS);
+}
+
+static void report(const char* name, clock_t lib, clock_t inl)
+{
+    long l = tenths(lib);
+    long i = tenths(inl);
+    printf("  %-8s %5ld.%ld us %5ld.%ld us\n", name, l / 10, l % 10, i / 10, i % 10);
+}
+
+// setup runs before each loop, e.g. to rewind the file
+#define TIME(name, setup, lib, inl)                                         \
+    do                                                                      \
+    {                                                                       \
+        setup;                                                              \
+        clock_t t0 = clock();                                               \
+        for (long i = 0; i < LOOPS; i++)                                    \
+            lib;                                                            \
+        clock_t t1 = clock();                                               \
+        setup;                                                              \
+        clock_t t2 = clock();                                               \
+        for (long i = 0; i < LOOPS; i++)                                    \
+            inl;                                                            \
+        report(name, t1 - t0, clock() - t2);                                \
+    } while (0)
+
+int main(void)
+{
+    static const char name[] = "DOSBENCH.TMP";
+    int fd = _dos_create(name, 0x20);
+    if (fd < 0)
+    {
+        fprintf(stderr, "dos: cannot create %s (%d)\n", name, fd);
+        return 1;
+    }
+    _dos_write(fd, data, LOOPS);
+
+    clock_t t0 = clock();
+    for (long i = 0; i < LOOPS; i++)
+        ir = i;
+    empty = clock() - t0;
+
+    printf("%d calls each      library     inline\n", LOOPS);
+    TIME("curdrv", (void)0, ir = (_dos_curdrv)(), ir = _dos_curdrv());
+    TIME("seek", (void)0, ir = (_dos_seek)(fd, 0, 0), ir = _dos_seek(fd, 0, 0));
+    TIME("write", _dos_seek(fd, 0, 0), ir = (_dos_write)(fd, buf, 1), ir = _dos_write(fd, buf, 1));
+    TIME("read", _dos_seek(fd, 0, 0), ir = (_dos_read)(fd, buf, 1), ir = _dos_read(fd, buf, 1));
+    TIME("fgetc", _dos_seek(fd, 0, 0), ir = (_dos_fgetc)(fd), ir = _dos_fgetc(fd));
+
+    _dos_close(fd);
+    _dos_delete(name);
+    return 0;
+}
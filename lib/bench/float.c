@@ -0,0 +1,104 @@
+// float.c - time each float operation the compiler hands to libgcc
+//
+// Built three times by "make -C lib bench": float-libgcc.x links the plain
+// libgcc routines (lb1sf68.S), float-softfloat.x libsoftfloat
+// (softfloat.specs) and float-dispatch.x goes through libfloat
+// (float.specs). The dispatched build times the soft path and, when the
+// machine has one, the FPU path.
+//
+// Times are per operation with the loop's own cost taken off. Under run68
+// they are host time, not 68000 cycles: compare the builds with each
+// other, not with real hardware.
+
+#include <stdio.h>
+#include <time.h>
+#include "libfloat.h"
+
+// Present only when linked with libfloat
+#pragma weak __float_select
+#pragma weak __float_have_fpu
+
+#ifndef BENCH_NAME
+#define BENCH_NAME "libgcc"
+#endif
+
+#define LOOPS 20000
+
+static volatile double da = 3.14159, db = -2.71828, dr;
+static volatile float fa = 1.5f, fb = 0.3f, fr;
+static volatile long ia = 123456, ir;
+
+// The body of one timing loop, and the loop with nothing in it
+#define TIME(name, body)                                                    \
+    do                                                                      \
+    {                                                                       \
+        clock_t t0 = clock();                                               \
+        for (long i = 0; i < LOOPS; i++)                                    \
+            body;                                                           \
+        report(name, clock() - t0);                                         \
+    } while (0)
+
+static clock_t empty;
+
+static void report(const char* name, clock_t t)
+{
+    t -= empty;
+    if (t < 0)
+        t = 0;
+    // microseconds per operation, to one decimal
+    long tenths = (long)((double)t * 1e7 / CLOCKS_PER_SEC / LOOPS);
+    printf("  %-12s %6ld.%ld us\n", name, tenths / 10, tenths % 10);
+}
+
+static void run(void)
+{
+    clock_t t0 = clock();
+    for (long i = 0; i < LOOPS; i++)
+        ir = ia;
+    empty = clock() - t0;
+
+    TIME("adddf3", dr = da + db);
+    TIME("subdf3", dr = da - db);
+    TIME("muldf3", dr = da * db);
+    TIME("divdf3", dr = da / db);
+    TIME("ltdf2", ir = da < db);
+    TIME("eqdf2", ir = da == db);
+    TIME("addsf3", fr = fa + fb);
+    TIME("subsf3", fr = fa - fb);
+    TIME("mulsf3", fr = fa * fb);
+    TIME("divsf3", fr = fa / fb);
+    TIME("ltsf2", ir = fa < fb);
+    TIME("eqsf2", ir = fa == fb);
+    TIME("floatsidf", dr = ia);
+    TIME("floatsisf", fr = ia);
+    TIME("fixdfsi", ir = da);
+    TIME("fixsfsi", ir = fa);
+    TIME("extendsfdf2", dr = fa);
+    TIME("truncdfsf2", fr = da);
+}
+
+int main(void)
+{
+    printf("%d iterations per operation\n", LOOPS);
+    if (!__float_select)
+    {
+        printf(BENCH_NAME ":\n");
+        run();
+        return 0;
+    }
+
+    __float_select(FLOAT_SOFT);
+    printf("libfloat, soft path:\n");
+    run();
+    if (__float_have_fpu())
+    {
+        __float_select(FLOAT_FPU);
+        printf("libfloat, FPU path:\n");
+        run();
+    }
+    else
+    {
+        printf("libfloat, FPU path: no FPU on this machine\n");
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// stdio.c - count the DOS reads and writes behind common stdio patterns
+//
+// Built twice by "make -C lib bench", both with _dos_read and _dos_write
+// wrapped (ld --wrap) so every call newlib's syscall glue makes is
+// counted: stdio-newlib.x with newlib's own buffering, stdio-dosio.x with
+// libdosio (dosio.specs). run68 makes the same DOS calls real hardware
+// would, so the counts carry over; the console lines print as they go.
+
+#include <stdio.h>
+#include "dosio.h"
+
+// Present only when linked with libdosio
+#pragma weak __dosio_class
+
+#define LINES 50
+#define CHARS 500
+#define FILE_LINES 1000
+
+static const char name[] = "STDIOBEN.TMP";
+
+static long reads, writes;
+
+int __real__dos_read(int fd, void* buf, int n);
+int __real__dos_write(int fd, const void* buf, int n);
+
+int __wrap__dos_read(int fd, void* buf, int n)
+{
+    reads++;
+    return __real__dos_read(fd, buf, n);
+}
+
+int __wrap__dos_write(int fd, const void* buf, int n)
+{
+    writes++;
+    return __real__dos_write(fd, buf, n);
+}
+
+struct Count
+{
+    const char* name;
+    long reads;
+    long writes;
+};
+
+static struct Count counts[8];
+static int numCounts;
+static long reads0, writes0;
+
+static void start(void)
+{
+    reads0 = reads;
+    writes0 = writes;
+}
+
+static void stop(const char* what)
+{
+    struct Count* c = &counts[numCounts++];
+    c->name = what;
+    c->reads = reads - reads0;
+    c->writes = writes - writes0;
+}
+
+int main(void)
+{
+    char line[80];
+    FILE* fp;
+
+    start();
+    for (int i = 0; i < LINES; i++)
+        printf("line %d of %d\n", i + 1, LINES);
+    fflush(stdout);
+    stop("printf lines");
+
+    // the function, as GCC calls it for printf("%c", c) and the like
+    start();
+    for (int i = 0; i < CHARS; i++)
+        (putchar)(i % 50 == 49 ? '\n' : '.');
+    fflush(stdout);
+    stop("putchar");
+
+    start();
+    fp = fopen(name, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "stdio: cannot create %s\n", name);
+        return 1;
+    }
+    for (int i = 0; i < FILE_LINES; i++)
+        fprintf(fp, "record %d\n", i);
+    fclose(fp);
+    stop("fprintf file");
+
+    start();
+    fp = fopen(name, "r");
+    while (fgets(line, sizeof(line), fp))
+        ;
+    fclose(fp);
+    stop("fgets file");
+
+    start();
+    fp = fopen(name, "r");
+    while (fgetc(fp) != EOF)
+        ;
+    fclose(fp);
+    stop("fgetc file");
+
+    remove(name);
+
+    static const char* const classes[] = {"file", "console", "device"};
+    int cls = __dosio_class ? __dosio_class(fileno(stdout)) : -1;
+    fprintf(stderr, "%s", __dosio_class ? "libdosio" : "newlib");
+    if (cls >= 0)
+        fprintf(stderr, ", stdout is a %s", classes[cls]);
+    fprintf(stderr, ":\n");
+    for (int i = 0; i < numCounts; i++)
+        fprintf(stderr, "  %-14s %5ld writes %5ld reads\n", counts[i].name, counts[i].writes, counts[i].reads);
+    return 0;
+}
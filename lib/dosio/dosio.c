@@ -0,0 +1,111 @@
+// dosio.c - handle classes, buffer sizes and the standard streams
+
+#include <stdio.h>
+#include <sys/dos.h>
+#include "dosio.h"
+
+// IOCTRL mode 0 device word
+#define IO_CHAR     0x80    // character device; else a file, bits 0-5 the drive
+#define IO_CONSOLE  0x03    // console input or output
+
+// Link-time overrides; the symbol's address is the size, as with crt0's
+// __stack_size, and 0 (undefined) keeps the default
+extern char __dosio_console_bufsize[] __attribute__((weak));
+extern char __dosio_file_bufsize[] __attribute__((weak));
+extern char __dosio_device_bufsize[] __attribute__((weak));
+
+int __dosio_direct;
+
+static __typeof__(((FILE*)0)->_read) stdinRead;
+static __typeof__(((FILE*)0)->_write) stderrWrite;
+
+int __dosio_class(int fd)
+{
+    int info = _dos_ioctrlgt(fd);
+    if (info < 0)
+        return -1;
+    if (!(info & IO_CHAR))
+        return DOSIO_FILE;
+    return (info & IO_CONSOLE) ? DOSIO_CONSOLE : DOSIO_DEVICE;
+}
+
+int __dosio_bufsize(int cls)
+{
+    long size;
+    switch (cls)
+    {
+    case DOSIO_CONSOLE:
+        size = (long)__dosio_console_bufsize;
+        return size ? size : DOSIO_CONSOLE_BUFSIZE;
+    case DOSIO_FILE:
+        size = (long)__dosio_file_bufsize;
+        return size ? size : DOSIO_FILE_BUFSIZE;
+    default:
+        size = (long)__dosio_device_bufsize;
+        return size ? size : DOSIO_DEVICE_BUFSIZE;
+    }
+}
+
+void __dosio_setbuf(FILE* fp)
+{
+    int cls = __dosio_class(fileno(fp));
+    if (cls < 0)
+        return;
+    // a console opened by name is interactive: keep it line buffered
+    setvbuf(fp, NULL, cls == DOSIO_CONSOLE ? _IOLBF : _IOFBF, __dosio_bufsize(cls));
+}
+
+// With stdout fully buffered on the console, whatever it holds must be out
+// before the program waits for input or writes to stderr
+static _READ_WRITE_RETURN_TYPE flushingRead(struct _reent* r, void* cookie, char* buf,
+                                            _READ_WRITE_BUFSIZE_TYPE n)
+{
+    fflush(stdout);
+    return stdinRead(r, cookie, buf, n);
+}
+
+static _READ_WRITE_RETURN_TYPE flushingWrite(struct _reent* r, void* cookie, const char* buf,
+                                             _READ_WRITE_BUFSIZE_TYPE n)
+{
+    fflush(stdout);
+    return stderrWrite(r, cookie, buf, n);
+}
+
+// Runs before main; dosio.specs links it with -u
+__attribute__((constructor)) void __dosio_init(void)
+{
+    int out = __dosio_class(fileno(stdout));
+    __dosio_direct = 0;
+    if (out == DOSIO_CONSOLE)
+    {
+        int size = __dosio_bufsize(DOSIO_CONSOLE);
+        if (size <= 1)
+        {
+            setvbuf(stdout, NULL, _IONBF, 0);
+            __dosio_direct = 1;
+        }
+        else
+        {
+            // setvbuf has set up all three streams, so the hooks can go in
+            setvbuf(stdout, NULL, _IOFBF, size);
+            if (stdin->_read != flushingRead)
+            {
+                stdinRead = stdin->_read;
+                stdin->_read = flushingRead;
+            }
+            if (stderr->_write != flushingWrite)
+            {
+                stderrWrite = stderr->_write;
+                stderr->_write = flushingWrite;
+            }
+        }
+    }
+    else if (out >= 0)
+    {
+        setvbuf(stdout, NULL, _IOFBF, __dosio_bufsize(out));
+    }
+
+    // console input stays as newlib sets it up: DOS returns a line at a time
+    if (__dosio_class(fileno(stdin)) == DOSIO_FILE)
+        setvbuf(stdin, NULL, _IOFBF, __dosio_bufsize(DOSIO_FILE));
+}
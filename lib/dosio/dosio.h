@@ -0,0 +1,57 @@
+// dosio.h - stdio buffering tuned for Human68k DOS (libdosio)
+//
+// -specs=dosio.specs links libdosio. At startup it gives the standard
+// streams buffers sized by what each handle is (console, file or other
+// character device, from DOS IOCTRL), and it wraps fopen, fdopen and
+// freopen to do the same for every stream opened later:
+//
+//   console  stdout fully buffered, so text goes out in one _dos_write per
+//            buffer rather than one per line; it is flushed before stdin
+//            reads and stderr writes, by fflush and at exit
+//   file     fully buffered, large buffer
+//   device   fully buffered, small buffer (AUX, PRN, NUL, ...)
+//
+// The sizes can be set at link time like __stack_size, e.g.
+// -Wl,--defsym,__dosio_file_bufsize=16384. A console size of 1 leaves
+// stdout unbuffered, and calls to the putchar function then go straight
+// to DOS _PUTCHAR. <stdio.h> defines putchar(c) as a macro over putc, so
+// only (putchar)(c) and the calls GCC makes itself (printf("x") becomes
+// putchar('x')) take that path; putchar(c) written plainly stays on putc.
+// A program that leaves through _dos_exit rather than exit() must
+// fflush(stdout) first.
+
+#ifndef DOSIO_H
+#define DOSIO_H
+
+#include <stdio.h>
+
+enum
+{
+    DOSIO_FILE,
+    DOSIO_CONSOLE,
+    DOSIO_DEVICE
+};
+
+// Default buffer sizes
+#define DOSIO_CONSOLE_BUFSIZE   4096
+#define DOSIO_FILE_BUFSIZE      8192
+#define DOSIO_DEVICE_BUFSIZE    512
+
+// The class of handle fd, or -1 when DOS does not know it
+int __dosio_class(int fd);
+
+// The buffer size for class cls, after any link-time override
+int __dosio_bufsize(int cls);
+
+// Give fp the buffering its handle's class calls for; must come before
+// the first read or write
+void __dosio_setbuf(FILE* fp);
+
+// Set up the standard streams for their handles. Runs before main; call
+// it again after redirecting one of them (e.g. with _dos_dup2).
+void __dosio_init(void);
+
+// Nonzero when stdout is an unbuffered console (putchar's direct path)
+extern int __dosio_direct;
+
+#endif
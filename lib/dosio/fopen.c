@@ -0,0 +1,32 @@
+// fopen.c - size the buffer of every stream opened (ld --wrap)
+
+#include <stdio.h>
+#include "dosio.h"
+
+FILE* __real_fopen(const char* name, const char* mode);
+FILE* __real_fdopen(int fd, const char* mode);
+FILE* __real_freopen(const char* name, const char* mode, FILE* fp);
+
+FILE* __wrap_fopen(const char* name, const char* mode)
+{
+    FILE* fp = __real_fopen(name, mode);
+    if (fp)
+        __dosio_setbuf(fp);
+    return fp;
+}
+
+FILE* __wrap_fdopen(int fd, const char* mode)
+{
+    FILE* fp = __real_fdopen(fd, mode);
+    if (fp)
+        __dosio_setbuf(fp);
+    return fp;
+}
+
+FILE* __wrap_freopen(const char* name, const char* mode, FILE* fp)
+{
+    fp = __real_freopen(name, mode, fp);
+    if (fp)
+        __dosio_setbuf(fp);
+    return fp;
+}
@@ -0,0 +1,27 @@
+// putchar.c - putchar without the stdio call chain (ld --wrap)
+
+#include <stdio.h>
+#include <sys/dos.h>
+#include "dosio.h"
+
+int __real_putchar(int c);
+
+int __wrap_putchar(int c)
+{
+    // unbuffered console: one DOS call, nothing to keep in order with
+    if (__dosio_direct)
+    {
+        _dos_putchar(c);
+        return (unsigned char)c;
+    }
+
+    // room left in a fully buffered stdout: store the byte as putc does
+    // (_w stays 0 for line-buffered and unbuffered streams)
+    FILE* fp = stdout;
+    if (fp->_w > 0)
+    {
+        fp->_w--;
+        return *fp->_p++ = (unsigned char)c;
+    }
+    return __real_putchar(c);
+}
@@ -0,0 +1,75 @@
+// fpu.c - the float routines on the FPU
+//
+// Built with -m68020-60: plain C float arithmetic becomes fadd, fcmp and
+// friends, avoiding the instructions the 68040 and 68060 trap on. Only
+// called after __float_init has found an FPU.
+//
+// Callers are soft-float code, which passes arguments on the stack (the
+// same under both ABIs) but expects results in d0 (float, int) or d0/d1
+// (double), where the FPU ABI would use fp0. So results leave as their
+// bit patterns, in a long or a long long.
+//
+// The comparisons return what libgcc's do: __eqdf2 and __nedf2 zero when
+// equal; __ltdf2 negative when less; __ledf2 zero or negative when less
+// or equal; __gtdf2 positive when greater; __gedf2 zero or positive when
+// greater or equal; false for each when either operand is a NaN.
+// __cmpdf2 is -1, 0 or 1, and 1 for a NaN.
+
+union Double
+{
+    double d;
+    long long bits;
+};
+
+union Float
+{
+    float f;
+    long bits;
+};
+
+static inline long long fromDouble(double d)
+{
+    union Double u;
+    u.d = d;
+    return u.bits;
+}
+
+static inline long fromFloat(float f)
+{
+    union Float u;
+    u.f = f;
+    return u.bits;
+}
+
+long long __fpu_adddf3(double a, double b) { return fromDouble(a + b); }
+long long __fpu_subdf3(double a, double b) { return fromDouble(a - b); }
+long long __fpu_muldf3(double a, double b) { return fromDouble(a * b); }
+long long __fpu_divdf3(double a, double b) { return fromDouble(a / b); }
+
+int __fpu_cmpdf2(double a, double b) { return a < b ? -1 : a == b ? 0 : 1; }
+int __fpu_eqdf2(double a, double b) { return a != b; }
+int __fpu_nedf2(double a, double b) { return a != b; }
+int __fpu_ltdf2(double a, double b) { return a < b ? -1 : 0; }
+int __fpu_ledf2(double a, double b) { return a <= b ? 0 : 1; }
+int __fpu_gtdf2(double a, double b) { return a > b ? 1 : 0; }
+int __fpu_gedf2(double a, double b) { return a >= b ? 0 : -1; }
+
+long __fpu_addsf3(float a, float b) { return fromFloat(a + b); }
+long __fpu_subsf3(float a, float b) { return fromFloat(a - b); }
+long __fpu_mulsf3(float a, float b) { return fromFloat(a * b); }
+long __fpu_divsf3(float a, float b) { return fromFloat(a / b); }
+
+int __fpu_cmpsf2(float a, float b) { return a < b ? -1 : a == b ? 0 : 1; }
+int __fpu_eqsf2(float a, float b) { return a != b; }
+int __fpu_nesf2(float a, float b) { return a != b; }
+int __fpu_ltsf2(float a, float b) { return a < b ? -1 : 0; }
+int __fpu_lesf2(float a, float b) { return a <= b ? 0 : 1; }
+int __fpu_gtsf2(float a, float b) { return a > b ? 1 : 0; }
+int __fpu_gesf2(float a, float b) { return a >= b ? 0 : -1; }
+
+long long __fpu_floatsidf(long i) { return fromDouble(i); }
+long __fpu_floatsisf(long i) { return fromFloat(i); }
+long __fpu_fixdfsi(double d) { return (long)d; }
+long __fpu_fixsfsi(float f) { return (long)f; }
+long long __fpu_extendsfdf2(float f) { return fromDouble(f); }
+long __fpu_truncdfsf2(double d) { return fromFloat(d); }
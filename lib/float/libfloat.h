@@ -0,0 +1,31 @@
+// libfloat.h - runtime-dispatched float support (libfloat)
+//
+// The compiler's calls to libgcc's float routines (__adddf3, __eqsf2, ...)
+// are redirected with ld --wrap into dispatch.S, which jumps through
+// __float_ops. __float_init fills the table once: with the FPU versions
+// (fpu.c, 68881/68882 or the 68040/68060's own FPU) when Human68k reports
+// one, else with the original soft-float routines (__real___adddf3, ...).
+
+#ifndef LIBFLOAT_H
+#define LIBFLOAT_H
+
+enum
+{
+    FLOAT_AUTO,     // probe the machine
+    FLOAT_SOFT,     // soft-float routines
+    FLOAT_FPU       // FPU instructions
+};
+
+// Fill in __float_ops (once; later calls return at once). Runs on the
+// first float operation by itself, so calling it is optional.
+void __float_init(void);
+
+// Choose the implementation: FLOAT_AUTO probes, FLOAT_SOFT and FLOAT_FPU
+// force one. Asking for the FPU where there is none is refused. Returns
+// the mode now in use (FLOAT_SOFT or FLOAT_FPU).
+int __float_select(int mode);
+
+// Nonzero when the machine has a coprocessor the FPU routines can use
+int __float_have_fpu(void);
+
+#endif
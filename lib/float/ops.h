@@ -0,0 +1,33 @@
+// ops.h - the libgcc float routines routed through the dispatch table
+//
+// Included with FLOAT_OP(name) defined, once per use: the table, the
+// wrappers in dispatch.S and both implementations follow this order.
+
+FLOAT_OP(adddf3)
+FLOAT_OP(subdf3)
+FLOAT_OP(muldf3)
+FLOAT_OP(divdf3)
+FLOAT_OP(cmpdf2)
+FLOAT_OP(eqdf2)
+FLOAT_OP(nedf2)
+FLOAT_OP(ltdf2)
+FLOAT_OP(ledf2)
+FLOAT_OP(gtdf2)
+FLOAT_OP(gedf2)
+FLOAT_OP(addsf3)
+FLOAT_OP(subsf3)
+FLOAT_OP(mulsf3)
+FLOAT_OP(divsf3)
+FLOAT_OP(cmpsf2)
+FLOAT_OP(eqsf2)
+FLOAT_OP(nesf2)
+FLOAT_OP(ltsf2)
+FLOAT_OP(lesf2)
+FLOAT_OP(gtsf2)
+FLOAT_OP(gesf2)
+FLOAT_OP(floatsidf)
+FLOAT_OP(floatsisf)
+FLOAT_OP(fixdfsi)
+FLOAT_OP(fixsfsi)
+FLOAT_OP(extendsfdf2)
+FLOAT_OP(truncdfsf2)
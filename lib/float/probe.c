@@ -0,0 +1,64 @@
+// probe.c - FPU detection and the dispatch table
+
+#include <sys/iocs.h>
+#include "libfloat.h"
+
+// Work area bytes Human68k fills in at boot: the MPU (0 = 68000, 1 =
+// 68010, 2 = 68020, 3 = 68030, 4 = 68040, 6 = 68060) and whether an FPU
+// answers on the coprocessor interface. A 68881 on a 68000 sits on a
+// memory-mapped board (CZ-6BP1) instead, which these routines do not
+// drive; such machines take the soft path.
+#define WORK_MPU ((void*)0x0cbc)
+#define WORK_FPU ((void*)0x0cbd)
+
+typedef void (*FloatFn)(void);
+
+// The implementations, by name only; dispatch.S passes the caller's
+// arguments through untouched
+#define FLOAT_OP(name) void __real___##name(void); void __fpu_##name(void);
+#include "ops.h"
+#undef FLOAT_OP
+
+#define FLOAT_OP(name) __real___##name,
+static const FloatFn softOps[] = {
+#include "ops.h"
+};
+#undef FLOAT_OP
+
+#define FLOAT_OP(name) __fpu_##name,
+static const FloatFn fpuOps[] = {
+#include "ops.h"
+};
+#undef FLOAT_OP
+
+#define NUM_OPS (sizeof(softOps) / sizeof(softOps[0]))
+
+extern FloatFn __float_ops[NUM_OPS];
+
+static int current;
+
+int __float_have_fpu(void)
+{
+    // the work area is in supervisor memory; B_BPEEK reads it for us
+    int mpu = _iocs_b_bpeek(WORK_MPU) & 0xff;
+    int fpu = _iocs_b_bpeek(WORK_FPU) & 0xff;
+    return mpu >= 2 && mpu <= 6 && fpu != 0;
+}
+
+int __float_select(int mode)
+{
+    if (mode == FLOAT_AUTO || mode == FLOAT_FPU)
+        mode = __float_have_fpu() ? FLOAT_FPU : FLOAT_SOFT;
+
+    const FloatFn* ops = mode == FLOAT_FPU ? fpuOps : softOps;
+    for (unsigned i = 0; i < NUM_OPS; i++)
+        __float_ops[i] = ops[i];
+    current = mode;
+    return mode;
+}
+
+void __float_init(void)
+{
+    if (!current)
+        __float_select(FLOAT_AUTO);
+}
@@ -0,0 +1,423 @@
+// conv_float.c - %e %f %g %a and their upper-case forms
+//
+// Linked only when the program asks for it with -u __printf_float.
+//
+// Decimal conversion is exact, without dtoa: a double is m * 2^e with a
+// 53-bit m, which is N * 10^-k for the integer N = m * 5^-e (k = -e) when
+// e < 0, or N = m * 2^e (k = 0) otherwise. N is built in base 10000 with
+// 16x16 multiplies, then rounded half-to-even at the digit the conversion
+// needs and printed. The worst case, a denormal with all 767 digits, takes
+// a few thousand mulu.w/divu.w; ordinary values take a handful.
+//
+// long double arguments are taken as such and printed at double precision.
+
+#include <stddef.h>
+#include "format.h"
+
+// Base-10000 limbs for 767 digits, plus one for a rounding carry
+#define BIG_LIMBS 194
+
+struct Big
+{
+    uint16_t d[BIG_LIMBS];  // least significant first
+    int n;                  // limbs in use; 0 for zero
+};
+
+static const uint16_t pow10[4] = { 1, 10, 100, 1000 };
+
+static void bigMul(struct Big* b, uint16_t m)
+{
+    uint16_t carry = 0;
+    for (int i = 0; i < b->n; i++)
+    {
+        uint16_t lo;
+        carry = __udiv16((uint32_t)b->d[i] * m + carry, 10000, &lo);
+        b->d[i] = lo;
+    }
+    // m may exceed 10000, so the carry can take two limbs
+    while (carry)
+        carry = __udiv16(carry, 10000, &b->d[b->n++]);
+}
+
+static int bigDigits(const struct Big* b)
+{
+    if (b->n == 0)
+        return 0;
+    int top = b->d[b->n - 1];
+    return (b->n - 1) * 4 + (top >= 1000 ? 4 : top >= 100 ? 3 : top >= 10 ? 2 : 1);
+}
+
+// Digit of N at 10^pos
+static int bigDigit(const struct Big* b, int pos)
+{
+    if (pos < 0 || pos >= b->n * 4)
+        return 0;
+    uint16_t r;
+    uint16_t q = __udiv16(b->d[pos >> 2], pow10[pos & 3], &r);
+    __udiv16(q, 10, &r);
+    return r;
+}
+
+// Round N half-to-even to a multiple of 10^r
+static void bigRound(struct Big* b, int r)
+{
+    if (r <= 0 || b->n == 0)
+        return;
+
+    int half = bigDigit(b, r - 1);
+    int up = half > 5;
+    if (half == 5)
+    {
+        // exactly half unless something below is nonzero
+        int limb = (r - 1) >> 2;
+        uint16_t below;
+        if (limb < b->n)
+            __udiv16(b->d[limb], pow10[(r - 1) & 3], &below);
+        else
+            below = 0;
+        for (int i = 0; i < limb && i < b->n && !below; i++)
+            below = b->d[i];
+        up = below != 0 || (bigDigit(b, r) & 1);
+    }
+
+    int limb = r >> 2;
+    for (int i = 0; i < limb && i < b->n; i++)
+        b->d[i] = 0;
+    if (limb < b->n)
+    {
+        uint16_t low;
+        __udiv16(b->d[limb], pow10[r & 3], &low);
+        b->d[limb] -= low;
+    }
+    if (up)
+    {
+        while (b->n <= limb)
+            b->d[b->n++] = 0;
+        uint16_t add = pow10[r & 3];
+        for (int i = limb; add; i++)
+        {
+            if (i == b->n)
+                b->d[b->n++] = 0;
+            uint16_t v = b->d[i] + add;
+            add = v >= 10000;
+            b->d[i] = add ? v - 10000 : v;
+        }
+    }
+    while (b->n > 0 && b->d[b->n - 1] == 0)
+        b->n--;
+}
+
+// Write the digits of N at 10^from down to 10^to
+static void putDigits(struct Out* o, const struct Big* b, int from, int to)
+{
+    char buf[32];
+    int len = 0;
+    for (int pos = from; pos >= to; pos--)
+    {
+        buf[len++] = '0' + bigDigit(b, pos);
+        if (len == sizeof(buf))
+        {
+            o->put(o, buf, len);
+            len = 0;
+        }
+    }
+    if (len)
+        o->put(o, buf, len);
+}
+
+// The double's bits as 16-bit words, most significant first
+union Bits
+{
+    double d;
+    uint16_t w[4];
+};
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define W(i) (i)
+#else
+#define W(i) (3 - (i))
+#endif
+
+// Pad, the prefix (sign, "0x") and the zeros the '0' flag asks for, around
+// a body of bodyLen characters the caller writes next. Returns the padding
+// still to go after the body.
+static int fieldStart(struct Out* o, const struct Spec* sp, const char* prefix, int prefixLen, int bodyLen)
+{
+    int pad = sp->width - prefixLen - bodyLen;
+    if (pad > 0 && (sp->flags & (F_MINUS | F_ZERO)) == F_ZERO)
+    {
+        o->put(o, prefix, prefixLen);
+        __outPad(o, '0', pad);
+        return 0;
+    }
+    if (pad > 0 && !(sp->flags & F_MINUS))
+        __outPad(o, ' ', pad);
+    o->put(o, prefix, prefixLen);
+    return pad > 0 && (sp->flags & F_MINUS) ? pad : 0;
+}
+
+// Hex digit i of the mantissa: 0 is the one before the point
+static int hexDigit(uint32_t hi, uint32_t lo, int i)
+{
+    if (i == 0)
+        return hi >> 20;
+    if (i > 13)
+        return 0;
+    int bit = 52 - 4 * i;
+    return (bit >= 32 ? hi >> (bit - 32) : lo >> bit) & 0xf;
+}
+
+// %a: hi holds mantissa bits 32-52, lo bits 0-31
+static void convHex(struct Out* o, struct Spec* sp, char* prefix, int prefixLen,
+                    uint32_t hi, uint32_t lo, int exp)
+{
+    const char* hex = (sp->flags & F_UPPER) ? "0123456789ABCDEF" : "0123456789abcdef";
+    int upper = (sp->flags & F_UPPER) != 0;
+    int prec = sp->prec;
+
+    if (hi == 0 && lo == 0)
+        exp = 0;
+    if (!(sp->flags & F_PREC))
+    {
+        // as many digits as it takes to be exact
+        prec = 13;
+        while (prec > 0 && hexDigit(hi, lo, prec) == 0)
+            prec--;
+    }
+    else if (prec < 13)
+    {
+        // round half-to-even at bit 52 - 4 * prec
+        int drop = 52 - 4 * prec;
+        int h = drop - 1;
+        int half = h < 32 ? (lo >> h) & 1 : (hi >> (h - 32)) & 1;
+        int below = h < 32 ? (lo & ((1u << h) - 1)) != 0
+                           : lo != 0 || (hi & ((1u << (h - 32)) - 1)) != 0;
+        int odd = drop < 32 ? (lo >> drop) & 1 : (hi >> (drop - 32)) & 1;
+        if (drop < 32)
+        {
+            lo &= ~((1u << drop) - 1);
+        }
+        else
+        {
+            lo = 0;
+            hi &= ~((1u << (drop - 32)) - 1);
+        }
+        if (half && (below || odd))
+        {
+            if (drop < 32)
+            {
+                uint32_t old = lo;
+                lo += 1u << drop;
+                hi += lo < old;
+            }
+            else
+            {
+                hi += 1u << (drop - 32);
+            }
+        }
+    }
+
+    prefix[prefixLen++] = '0';
+    prefix[prefixLen++] = upper ? 'X' : 'x';
+
+    char expBuf[8];
+    int expLen = 0;
+    expBuf[expLen++] = upper ? 'P' : 'p';
+    expBuf[expLen++] = exp < 0 ? '-' : '+';
+    unsigned e = exp < 0 ? -exp : exp;
+    char tmp[5];
+    int t = 0;
+    do
+    {
+        uint16_t d;
+        e = __udiv16(e, 10, &d);
+        tmp[t++] = '0' + d;
+    } while (e);
+    while (t)
+        expBuf[expLen++] = tmp[--t];
+
+    int point = prec > 0 || (sp->flags & F_ALT);
+    int pad = fieldStart(o, sp, prefix, prefixLen, 1 + point + prec + expLen);
+    char buf[32];
+    int len = 0;
+    buf[len++] = hex[hexDigit(hi, lo, 0)];
+    if (point)
+        buf[len++] = '.';
+    for (int i = 1; i <= prec; i++)
+    {
+        buf[len++] = hex[hexDigit(hi, lo, i)];
+        if (len == sizeof(buf))
+        {
+            o->put(o, buf, len);
+            len = 0;
+        }
+    }
+    o->put(o, buf, len);
+    o->put(o, expBuf, expLen);
+    __outPad(o, ' ', pad);
+}
+
+void __printf_float(struct Out* o, struct Spec* sp, struct Args* args)
+{
+    union Bits u;
+    if (sp->len == LEN_LD)
+        u.d = va_arg(args->ap, long double);
+    else
+        u.d = va_arg(args->ap, double);
+
+    int upper = (sp->flags & F_UPPER) != 0;
+    char prefix[3];
+    int prefixLen = 0;
+    if (u.w[W(0)] & 0x8000)
+        prefix[prefixLen++] = '-';
+    else if (sp->flags & F_PLUS)
+        prefix[prefixLen++] = '+';
+    else if (sp->flags & F_SPACE)
+        prefix[prefixLen++] = ' ';
+
+    int exp = (u.w[W(0)] >> 4) & 0x7ff;
+    uint16_t m[4] = { u.w[W(3)], u.w[W(2)], u.w[W(1)], u.w[W(0)] & 0xf };
+
+    if (exp == 0x7ff)
+    {
+        const char* s = (m[0] | m[1] | m[2] | m[3]) ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf");
+        sp->flags &= ~F_ZERO;
+        int pad = fieldStart(o, sp, prefix, prefixLen, 3);
+        o->put(o, s, 3);
+        __outPad(o, ' ', pad);
+        return;
+    }
+
+    int e2;
+    if (exp == 0)
+    {
+        e2 = -1074;
+    }
+    else
+    {
+        m[3] |= 0x10;
+        e2 = exp - 1075;
+    }
+
+    int conv = sp->conv | 0x20;
+    if (conv == 'a')
+    {
+        convHex(o, sp, prefix, prefixLen, ((uint32_t)m[3] << 16) | m[2], ((uint32_t)m[1] << 16) | m[0],
+                exp == 0 ? -1022 : exp - 1023);
+        return;
+    }
+
+    // N and k with value = N * 10^-k; trailing zero bits are shifted out
+    // of m first, since each costs a multiply by 5
+    struct Big b;
+    int k = 0;
+    b.n = 0;
+    if (m[0] | m[1] | m[2] | m[3])
+    {
+        while (e2 < 0 && !(m[0] & 1))
+        {
+            m[0] = (m[0] >> 1) | (m[1] << 15);
+            m[1] = (m[1] >> 1) | (m[2] << 15);
+            m[2] = (m[2] >> 1) | (m[3] << 15);
+            m[3] >>= 1;
+            e2++;
+        }
+        while (m[0] | m[1] | m[2] | m[3])
+            b.d[b.n++] = __bigDiv16(m, 4, 10000);
+        if (e2 > 0)
+        {
+            for (; e2 >= 13; e2 -= 13)
+                bigMul(&b, 8192);
+            if (e2 > 0)
+                bigMul(&b, 1 << e2);
+            e2 = 0;
+        }
+        static const uint16_t pow5[6] = { 1, 5, 25, 125, 625, 3125 };
+        for (k = -e2; e2 <= -6; e2 += 6)
+            bigMul(&b, 15625);
+        if (e2 < 0)
+            bigMul(&b, pow5[-e2]);
+    }
+
+    int prec = (sp->flags & F_PREC) ? sp->prec : 6;
+    int strip = 0;
+    int nd;
+    int x;
+
+    if (conv == 'g')
+    {
+        int sig = prec ? prec : 1;
+        bigRound(&b, bigDigits(&b) - sig);
+        x = b.n ? bigDigits(&b) - 1 - k : 0;
+        if (sig > x && x >= -4)
+        {
+            conv = 'f';
+            prec = sig - 1 - x;
+        }
+        else
+        {
+            conv = 'e';
+            prec = sig - 1;
+        }
+        strip = !(sp->flags & F_ALT);
+    }
+
+    if (conv == 'e')
+    {
+        bigRound(&b, bigDigits(&b) - (prec + 1));
+        nd = bigDigits(&b);
+        x = b.n ? nd - 1 - k : 0;
+        int top = b.n ? nd - 1 : 0;
+
+        // g without '#': no trailing zeros
+        if (strip)
+        {
+            while (prec > 0 && bigDigit(&b, top - prec) == 0)
+                prec--;
+        }
+
+        char expBuf[6];
+        int expLen = 0;
+        unsigned ex = x < 0 ? -x : x;
+        expBuf[expLen++] = upper ? 'E' : 'e';
+        expBuf[expLen++] = x < 0 ? '-' : '+';
+        if (ex >= 100)
+        {
+            uint16_t d;
+            expBuf[expLen++] = '0' + __udiv16(ex, 100, &d);
+            ex = d;
+        }
+        uint16_t d;
+        expBuf[expLen++] = '0' + __udiv16(ex, 10, &d);
+        expBuf[expLen++] = '0' + d;
+
+        int point = prec > 0 || (sp->flags & F_ALT);
+        int pad = fieldStart(o, sp, prefix, prefixLen, 1 + point + prec + expLen);
+        putDigits(o, &b, top, top);
+        if (point)
+            o->put(o, ".", 1);
+        if (prec > 0)
+            putDigits(o, &b, top - 1, top - prec);
+        o->put(o, expBuf, expLen);
+        __outPad(o, ' ', pad);
+        return;
+    }
+
+    // 'f'
+    bigRound(&b, k - prec);
+    nd = bigDigits(&b);
+    if (strip)
+    {
+        while (prec > 0 && bigDigit(&b, k - prec) == 0)
+            prec--;
+    }
+    int intLen = nd > k ? nd - k : 1;
+    int point = prec > 0 || (sp->flags & F_ALT);
+    int pad = fieldStart(o, sp, prefix, prefixLen, intLen + point + prec);
+    putDigits(o, &b, k + intLen - 1, k);
+    if (point)
+        o->put(o, ".", 1);
+    if (prec > 0)
+        putDigits(o, &b, k - 1, k - prec);
+    __outPad(o, ' ', pad);
+}
@@ -0,0 +1,148 @@
+// conv_int.c - %d %i %u %o %x %X %p
+
+#include "format.h"
+
+void __convInt(struct Out* o, struct Spec* sp, struct Args* args)
+{
+    static const char lower[16] = "0123456789abcdef";
+    static const char upper[16] = "0123456789ABCDEF";
+    const char* hex = (sp->flags & F_UPPER) ? upper : lower;
+
+    // The value as 16-bit words, least significant first
+    uint16_t w[5] = { 0, 0, 0, 0, 0 };
+    int neg = 0;
+    int base = 10;
+    char c = sp->conv;
+
+    if (c == 'p')
+    {
+        unsigned long v = (unsigned long)va_arg(args->ap, void*);
+        w[0] = v;
+        w[1] = v >> 16;
+        base = 16;
+        sp->flags |= F_ALT;
+    }
+    else if (c == 'd' || c == 'i')
+    {
+        long hi = 0;
+        long lo;
+        if (sp->len == LEN_LL)
+        {
+            long long v = va_arg(args->ap, long long);
+            if (v < 0)
+            {
+                neg = 1;
+                v = -(unsigned long long)v;
+            }
+            hi = (unsigned long long)v >> 32;
+            lo = v;
+        }
+        else
+        {
+            lo = sp->len == LEN_L ? va_arg(args->ap, long) : va_arg(args->ap, int);
+            if (sp->len == LEN_H)
+                lo = (short)lo;
+            else if (sp->len == LEN_HH)
+                lo = (signed char)lo;
+            if (lo < 0)
+            {
+                neg = 1;
+                lo = -(unsigned long)lo;
+            }
+        }
+        w[0] = lo;
+        w[1] = (unsigned long)lo >> 16;
+        w[2] = hi;
+        w[3] = (unsigned long)hi >> 16;
+    }
+    else
+    {
+        if (sp->len == LEN_LL)
+        {
+            unsigned long long v = va_arg(args->ap, unsigned long long);
+            unsigned long hi = v >> 32;
+            w[2] = hi;
+            w[3] = hi >> 16;
+            w[0] = v;
+            w[1] = (unsigned long)v >> 16;
+        }
+        else
+        {
+            unsigned long v = sp->len == LEN_L ? va_arg(args->ap, unsigned long)
+                                               : va_arg(args->ap, unsigned int);
+            if (sp->len == LEN_H)
+                v = (unsigned short)v;
+            else if (sp->len == LEN_HH)
+                v = (unsigned char)v;
+            w[0] = v;
+            w[1] = v >> 16;
+        }
+        if (c == 'o')
+            base = 8;
+        else if (c == 'x' || c == 'X')
+            base = 16;
+    }
+
+    int zero = (w[0] | w[1] | w[2] | w[3]) == 0;
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+
+    if (base == 10)
+    {
+        // Four digits per division by 10000
+        int n = 4;
+        while (n > 0)
+        {
+            uint16_t r = __bigDiv16(w, n, 10000);
+            while (n > 0 && w[n - 1] == 0)
+                n--;
+            for (int k = 0; k < 4 && (n > 0 || r != 0); k++)
+            {
+                uint16_t d;
+                r = __udiv16(r, 10, &d);
+                *--p = '0' + d;
+            }
+        }
+    }
+    else
+    {
+        int shift = base == 16 ? 4 : 3;
+        int mask = base - 1;
+        for (int bit = 0; bit < 64; bit += shift)
+        {
+            int i = bit >> 4;
+            uint32_t v = w[i] | ((uint32_t)w[i + 1] << 16);
+            *--p = hex[(v >> (bit & 15)) & mask];
+        }
+        while (p < end - 1 && *p == '0')
+            p++;
+        if (zero)
+            p = end;
+    }
+
+    int len = end - p;
+    int prec = (sp->flags & F_PREC) ? sp->prec : 1;
+    if (sp->flags & F_PREC)
+        sp->flags &= ~F_ZERO;
+
+    char prefix[2];
+    int prefixLen = 0;
+    if (neg)
+        prefix[prefixLen++] = '-';
+    else if ((c == 'd' || c == 'i') && (sp->flags & F_PLUS))
+        prefix[prefixLen++] = '+';
+    else if ((c == 'd' || c == 'i') && (sp->flags & F_SPACE))
+        prefix[prefixLen++] = ' ';
+    else if (base == 16 && (sp->flags & F_ALT) && (!zero || c == 'p'))
+    {
+        prefix[prefixLen++] = '0';
+        prefix[prefixLen++] = (sp->flags & F_UPPER) ? 'X' : 'x';
+    }
+
+    // '#' with octal: the first digit printed is a zero
+    if (base == 8 && (sp->flags & F_ALT) && prec <= len)
+        prec = len + 1;
+
+    __outField(o, sp, prefix, prefixLen, p, len, prec > len ? prec - len : 0);
+}
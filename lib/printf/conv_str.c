@@ -0,0 +1,48 @@
+// conv_str.c - %c %s
+
+#include <stddef.h>
+#include <wchar.h>
+#include "format.h"
+
+void __convStr(struct Out* o, struct Spec* sp, struct Args* args)
+{
+    sp->flags &= ~F_ZERO;
+
+    if (sp->conv == 'c')
+    {
+        // %lc: the wide character's low byte; there are no locales here
+        char ch = sp->len == LEN_L ? (char)va_arg(args->ap, wint_t) : (char)va_arg(args->ap, int);
+        __outField(o, sp, NULL, 0, &ch, 1, 0);
+        return;
+    }
+
+    int max = (sp->flags & F_PREC) ? sp->prec : 0x7fffffff;
+    if (sp->len == LEN_L)
+    {
+        const wchar_t* ws = va_arg(args->ap, const wchar_t*);
+        if (ws == NULL)
+            ws = L"(null)";
+        int len = 0;
+        while (len < max && ws[len])
+            len++;
+        int pad = sp->width - len;
+        if (pad > 0 && !(sp->flags & F_MINUS))
+            __outPad(o, ' ', pad);
+        for (int i = 0; i < len; i++)
+        {
+            char ch = ws[i];
+            o->put(o, &ch, 1);
+        }
+        if (pad > 0 && (sp->flags & F_MINUS))
+            __outPad(o, ' ', pad);
+        return;
+    }
+
+    const char* s = va_arg(args->ap, const char*);
+    if (s == NULL)
+        s = "(null)";
+    int len = 0;
+    while (len < max && s[len])
+        len++;
+    __outField(o, sp, NULL, 0, s, len, 0);
+}
@@ -0,0 +1,235 @@
+// format.c - printf engine: format parsing and the conversion table
+
+#include <stddef.h>
+#include "format.h"
+
+// Linked only with -u __printf_float; without it %e/%f/%g/%a print as is
+extern void __printf_float(struct Out* o, struct Spec* sp, struct Args* args) __attribute__((weak));
+
+// Handler per conversion letter, from 'A' to 'x'
+static ConvFn const convTable['x' - 'A' + 1] =
+{
+    ['A' - 'A'] = __printf_float,
+    ['E' - 'A'] = __printf_float,
+    ['F' - 'A'] = __printf_float,
+    ['G' - 'A'] = __printf_float,
+    ['X' - 'A'] = __convInt,
+    ['a' - 'A'] = __printf_float,
+    ['c' - 'A'] = __convStr,
+    ['d' - 'A'] = __convInt,
+    ['e' - 'A'] = __printf_float,
+    ['f' - 'A'] = __printf_float,
+    ['g' - 'A'] = __printf_float,
+    ['i' - 'A'] = __convInt,
+    ['o' - 'A'] = __convInt,
+    ['p' - 'A'] = __convInt,
+    ['s' - 'A'] = __convStr,
+    ['u' - 'A'] = __convInt,
+    ['x' - 'A'] = __convInt,
+};
+
+void __outPad(struct Out* o, char c, int n)
+{
+    static const char spaces[16] = "                ";
+    static const char zeros[16] = "0000000000000000";
+    const char* s = c == '0' ? zeros : spaces;
+    while (n > 0)
+    {
+        int k = n < 16 ? n : 16;
+        o->put(o, s, k);
+        n -= k;
+    }
+}
+
+// Write prefix (sign, "0x"), zeros more leading zeros, then body, padded
+// to the field width on the side and with the character the flags ask for
+void __outField(struct Out* o, const struct Spec* sp, const char* prefix, int prefixLen,
+                const char* body, int bodyLen, int zeros)
+{
+    int pad = sp->width - prefixLen - zeros - bodyLen;
+    if (pad > 0 && (sp->flags & (F_MINUS | F_ZERO)) == F_ZERO)
+    {
+        zeros += pad;
+        pad = 0;
+    }
+    if (pad > 0 && !(sp->flags & F_MINUS))
+        __outPad(o, ' ', pad);
+    if (prefixLen)
+        o->put(o, prefix, prefixLen);
+    __outPad(o, '0', zeros);
+    if (bodyLen)
+        o->put(o, body, bodyLen);
+    if (pad > 0 && (sp->flags & F_MINUS))
+        __outPad(o, ' ', pad);
+}
+
+static int parseNum(const char** p)
+{
+    int n = 0;
+    while (**p >= '0' && **p <= '9')
+    {
+        if (n < 100000000)
+            n = n * 10 + (**p - '0');
+        (*p)++;
+    }
+    return n;
+}
+
+int __vformat(struct Out* o, const char* fmt, va_list ap)
+{
+    struct Args args;
+    va_copy(args.ap, ap);
+
+    for (;;)
+    {
+        const char* start = fmt;
+        while (*fmt && *fmt != '%')
+            fmt++;
+        if (fmt != start)
+            o->put(o, start, fmt - start);
+        if (*fmt == '\0')
+            break;
+        start = fmt++;
+
+        struct Spec sp = { 0, 0, 0, LEN_NONE, 0 };
+        for (;; fmt++)
+        {
+            if (*fmt == '-')
+                sp.flags |= F_MINUS;
+            else if (*fmt == '+')
+                sp.flags |= F_PLUS;
+            else if (*fmt == ' ')
+                sp.flags |= F_SPACE;
+            else if (*fmt == '#')
+                sp.flags |= F_ALT;
+            else if (*fmt == '0')
+                sp.flags |= F_ZERO;
+            else
+                break;
+        }
+
+        if (*fmt == '*')
+        {
+            sp.width = va_arg(args.ap, int);
+            if (sp.width < 0)
+            {
+                sp.flags |= F_MINUS;
+                sp.width = -sp.width;
+            }
+            fmt++;
+        }
+        else
+        {
+            sp.width = parseNum(&fmt);
+        }
+
+        if (*fmt == '.')
+        {
+            fmt++;
+            if (*fmt == '*')
+            {
+                sp.prec = va_arg(args.ap, int);
+                fmt++;
+            }
+            else
+            {
+                sp.prec = parseNum(&fmt);
+            }
+            if (sp.prec >= 0)
+                sp.flags |= F_PREC;
+            else
+                sp.prec = 0;
+        }
+
+        switch (*fmt)
+        {
+        case 'h':
+            sp.len = LEN_H;
+            if (*++fmt == 'h')
+            {
+                sp.len = LEN_HH;
+                fmt++;
+            }
+            break;
+        case 'l':
+            sp.len = LEN_L;
+            if (*++fmt == 'l')
+            {
+                sp.len = LEN_LL;
+                fmt++;
+            }
+            break;
+        case 'q':
+            sp.len = LEN_LL;
+            fmt++;
+            break;
+        case 'L':
+            sp.len = LEN_LD;
+            fmt++;
+            break;
+        case 'j':
+            sp.len = LEN_LL;
+            fmt++;
+            break;
+        case 'z':
+        case 't':
+            sp.len = LEN_L;
+            fmt++;
+            break;
+        }
+
+        sp.conv = *fmt;
+        if (sp.conv == '\0')
+        {
+            o->put(o, start, fmt - start);
+            break;
+        }
+        fmt++;
+
+        if (sp.conv == '%')
+        {
+            o->put(o, "%", 1);
+            continue;
+        }
+        if (sp.conv == 'n')
+        {
+            void* p = va_arg(args.ap, void*);
+            if (sp.len == LEN_HH)
+                *(signed char*)p = o->count;
+            else if (sp.len == LEN_H)
+                *(short*)p = o->count;
+            else if (sp.len == LEN_LL)
+                *(long long*)p = o->count;
+            else if (sp.len == LEN_L)
+                *(long*)p = o->count;
+            else
+                *(int*)p = o->count;
+            continue;
+        }
+
+        ConvFn fn = NULL;
+        if (sp.conv >= 'A' && sp.conv <= 'x')
+            fn = convTable[sp.conv - 'A'];
+        if (fn == NULL)
+        {
+            // Unknown, or float support not linked: show the specification,
+            // and skip a float argument so the ones after it line up
+            int c = sp.conv | 0x20;
+            if (c == 'a' || c == 'e' || c == 'f' || c == 'g')
+            {
+                if (sp.len == LEN_LD)
+                    (void)va_arg(args.ap, long double);
+                else
+                    (void)va_arg(args.ap, double);
+            }
+            o->put(o, start, fmt - start);
+            continue;
+        }
+        if (sp.conv >= 'A' && sp.conv <= 'Z')
+            sp.flags |= F_UPPER;
+        fn(o, &sp, &args);
+    }
+
+    va_end(args.ap);
+    return o->count;
+}
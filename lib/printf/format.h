@@ -0,0 +1,131 @@
+// format.h - internals of the compact printf/scanf engine
+//
+// printf side: __vformat() parses the format and hands each conversion to
+// a handler looked up in a table by conversion letter. Handlers live in
+// separate objects; the floating-point one is only referenced weakly, so
+// it and its decimal conversion are linked only when the program asks for
+// them with -u __printf_float. The scanf side mirrors this with
+// __vscan() and __scanf_float.
+//
+// Arithmetic sticks to what the 68000 does in one instruction: 16x16
+// multiplies (mulu.w) and 32/16 divides (divu.w). Wider numbers are kept
+// as arrays of 16-bit words, so nothing here calls __udivdi3, __muldi3 or
+// the 32-bit division helpers.
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stdarg.h>
+#include <stdint.h>
+
+// The public entry points are weak: should another part of newlib pull in
+// its own object defining one of them (say for _snprintf_r), that copy
+// takes over instead of the link failing with a duplicate
+#define FORMAT_API __attribute__((weak))
+
+// Flags parsed from a conversion specification
+#define F_MINUS  0x01   // '-': left-justify
+#define F_PLUS   0x02   // '+': always a sign
+#define F_SPACE  0x04   // ' ': space for a plus sign
+#define F_ALT    0x08   // '#': alternate form
+#define F_ZERO   0x10   // '0': pad with zeros
+#define F_PREC   0x20   // a precision was given
+#define F_UPPER  0x40   // upper-case conversion letter
+
+// Length modifiers
+enum
+{
+    LEN_NONE,
+    LEN_HH,
+    LEN_H,
+    LEN_L,
+    LEN_LL,
+    LEN_LD      // 'L': long double
+};
+
+// Output: put() takes the characters, count totals what was produced
+// whether or not it all fit
+struct Out
+{
+    void (*put)(struct Out* o, const char* s, int len);
+    int count;
+    void* ctx;
+    char* buf;          // buffer sinks: next byte and bytes left
+    unsigned long room;
+};
+
+struct Spec
+{
+    int flags;
+    int width;
+    int prec;
+    int len;
+    char conv;
+};
+
+// The argument list travels by pointer so handlers can take their value
+// and leave the rest for the next conversion
+struct Args
+{
+    va_list ap;
+};
+
+typedef void (*ConvFn)(struct Out* o, struct Spec* sp, struct Args* args);
+
+int __vformat(struct Out* o, const char* fmt, va_list ap);
+
+void __outPad(struct Out* o, char c, int n);
+void __outField(struct Out* o, const struct Spec* sp, const char* prefix, int prefixLen,
+                const char* body, int bodyLen, int zeros);
+
+void __convInt(struct Out* o, struct Spec* sp, struct Args* args);
+void __convStr(struct Out* o, struct Spec* sp, struct Args* args);
+void __printf_float(struct Out* o, struct Spec* sp, struct Args* args);
+
+// x / d for a 16-bit d, with the remainder in *rem. Two divu.w on the
+// 68000, where C would call __udivsi3.
+static inline uint32_t __udiv16(uint32_t x, uint16_t d, uint16_t* rem)
+{
+#if defined(__mc68000__) && !defined(__mc68020__)
+    uint32_t a = x >> 16;
+    __asm__("divu.w %1,%0" : "+d"(a) : "dmi"(d) : "cc");
+    uint32_t qh = a << 16;
+    a = (a & 0xffff0000) | (x & 0xffff);
+    __asm__("divu.w %1,%0" : "+d"(a) : "dmi"(d) : "cc");
+    *rem = a >> 16;
+    return qh | (a & 0xffff);
+#else
+    *rem = x % d;
+    return x / d;
+#endif
+}
+
+// Divide the little-endian 16-bit word array w[0..n-1] by d in place and
+// return the remainder
+static inline uint16_t __bigDiv16(uint16_t* w, int n, uint16_t d)
+{
+    uint16_t r = 0;
+    for (int i = n - 1; i >= 0; i--)
+        w[i] = __udiv16(((uint32_t)r << 16) | w[i], d, &r);
+    return r;
+}
+
+// scanf side: get() returns the next character or -1 at the end, unget()
+// pushes one back; count is the characters consumed so far, for %n
+struct In
+{
+    int (*get)(struct In* in);
+    void (*unget)(struct In* in, int c);
+    int count;
+    void* ctx;
+    const char* str;
+};
+
+int __vscan(struct In* in, const char* fmt, va_list ap);
+
+// Reads a number for %e/%f/%g/%a into dst (float, double or long double by
+// len), taking at most width characters. Returns 1 if one was converted,
+// 0 on a matching failure, -1 at end of input.
+int __scanf_float(struct In* in, int width, int len, void* dst);
+
+#endif
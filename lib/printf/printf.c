@@ -0,0 +1,83 @@
+// printf.c - printf, fprintf, vprintf, vfprintf
+//
+// Output is gathered in a small buffer on the stack and handed to fwrite
+// in pieces, so the stream's own buffering sees a few large writes rather
+// than one per field.
+
+#include <stdio.h>
+#include <string.h>
+#include "format.h"
+
+#define FILE_CHUNK 128
+
+struct FileOut
+{
+    struct Out o;       // first, so the engine's pointer is ours too
+    FILE* fp;
+    int error;
+    char data[FILE_CHUNK];
+};
+
+static void flushFile(struct FileOut* f)
+{
+    size_t n = f->o.buf - f->data;
+    if (n && fwrite(f->data, 1, n, f->fp) != n)
+        f->error = 1;
+    f->o.buf = f->data;
+    f->o.room = FILE_CHUNK;
+}
+
+static void putFile(struct Out* o, const char* s, int len)
+{
+    struct FileOut* f = (struct FileOut*)o;
+    o->count += len;
+    while (len > 0)
+    {
+        if (o->room == 0)
+            flushFile(f);
+        int n = (unsigned long)len < o->room ? len : (int)o->room;
+        memcpy(o->buf, s, n);
+        o->buf += n;
+        o->room -= n;
+        s += n;
+        len -= n;
+    }
+}
+
+FORMAT_API int vfprintf(FILE* fp, const char* fmt, va_list ap)
+{
+    struct FileOut f;
+    f.o.put = putFile;
+    f.o.count = 0;
+    f.o.ctx = NULL;
+    f.o.buf = f.data;
+    f.o.room = FILE_CHUNK;
+    f.fp = fp;
+    f.error = 0;
+    __vformat(&f.o, fmt, ap);
+    flushFile(&f);
+    return f.error ? -1 : f.o.count;
+}
+
+FORMAT_API int vprintf(const char* fmt, va_list ap)
+{
+    return vfprintf(stdout, fmt, ap);
+}
+
+FORMAT_API int fprintf(FILE* fp, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfprintf(fp, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+FORMAT_API int printf(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfprintf(stdout, fmt, ap);
+    va_end(ap);
+    return n;
+}
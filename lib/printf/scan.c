@@ -0,0 +1,320 @@
+// scan.c - scanf engine
+
+#include <stddef.h>
+#include "format.h"
+
+// Linked only with -u __scanf_float; without it %e/%f/%g/%a fail to match
+extern int __scanf_float(struct In* in, int width, int len, void* dst) __attribute__((weak));
+
+static int isSpace(int c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static void skipSpace(struct In* in)
+{
+    int c;
+    while ((c = in->get(in)) >= 0 && isSpace(c))
+        ;
+    if (c >= 0)
+        in->unget(in, c);
+}
+
+static int digitVal(int c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 10;
+    return 99;
+}
+
+// Read an integer of at most width characters (0: no limit) in base (0:
+// by C prefix) into the 16-bit words w, least significant first. Returns 1
+// on success, 0 on a matching failure and -1 at end of input before any
+// character.
+static int scanInt(struct In* in, int width, int base, uint16_t w[4], int* neg)
+{
+    int left = width ? width : 0x7fffffff;
+    int digits = 0;
+    w[0] = w[1] = w[2] = w[3] = 0;
+    *neg = 0;
+
+    int c = in->get(in);
+    if (c < 0)
+        return -1;
+    if (c == '-' || c == '+')
+    {
+        *neg = c == '-';
+        if (--left == 0)
+            return 0;
+        c = in->get(in);
+    }
+
+    // "0x", or an octal leading zero; the zero is a digit either way
+    if ((base == 0 || base == 16) && c == '0' && left > 1)
+    {
+        digits = 1;
+        left--;
+        c = in->get(in);
+        if (c >= 0 && (c | 0x20) == 'x')
+        {
+            base = 16;
+            c = --left ? in->get(in) : -2;
+        }
+        else if (base == 0)
+        {
+            base = 8;
+        }
+    }
+    if (base == 0)
+        base = 10;
+
+    while (c >= 0 && digitVal(c) < base)
+    {
+        // w = w * base + digit
+        uint32_t carry = digitVal(c);
+        for (int i = 0; i < 4; i++)
+        {
+            carry += (uint32_t)w[i] * (uint16_t)base;
+            w[i] = carry;
+            carry >>= 16;
+        }
+        digits++;
+        c = --left ? in->get(in) : -2;
+    }
+    if (c >= 0)
+        in->unget(in, c);
+    // end of input after a sign is still a matching failure
+    return digits != 0;
+}
+
+// The set of a %[ conversion, as a 256-bit map
+static const char* scanSet(const char* fmt, uint8_t set[32])
+{
+    int invert = 0;
+    if (*fmt == '^')
+    {
+        invert = 1;
+        fmt++;
+    }
+    for (int i = 0; i < 32; i++)
+        set[i] = 0;
+    // ']' first is part of the set
+    if (*fmt == ']')
+    {
+        set[']' >> 3] |= 1 << (']' & 7);
+        fmt++;
+    }
+    while (*fmt && *fmt != ']')
+    {
+        unsigned char lo = *fmt++;
+        unsigned char hi = lo;
+        if (*fmt == '-' && fmt[1] && fmt[1] != ']')
+        {
+            hi = fmt[1];
+            fmt += 2;
+        }
+        for (unsigned c = lo; c <= hi; c++)
+            set[c >> 3] |= 1 << (c & 7);
+    }
+    if (invert)
+    {
+        for (int i = 0; i < 32; i++)
+            set[i] = ~set[i];
+    }
+    return *fmt ? fmt + 1 : fmt;
+}
+
+int __vscan(struct In* in, const char* fmt, va_list ap)
+{
+    int assigned = 0;
+    int converted = 0;
+    int eof = 0;
+
+    while (*fmt)
+    {
+        unsigned char f = *fmt++;
+        if (isSpace(f))
+        {
+            skipSpace(in);
+            continue;
+        }
+        if (f != '%' || *fmt == '%')
+        {
+            if (f == '%')
+            {
+                fmt++;
+                skipSpace(in);
+            }
+            int c = in->get(in);
+            if (c != f)
+            {
+                if (c < 0)
+                    eof = 1;
+                else
+                    in->unget(in, c);
+                break;
+            }
+            continue;
+        }
+
+        int suppress = 0;
+        if (*fmt == '*')
+        {
+            suppress = 1;
+            fmt++;
+        }
+        int width = 0;
+        while (*fmt >= '0' && *fmt <= '9')
+            width = width * 10 + (*fmt++ - '0');
+
+        int len = LEN_NONE;
+        switch (*fmt)
+        {
+        case 'h':
+            len = LEN_H;
+            if (*++fmt == 'h')
+            {
+                len = LEN_HH;
+                fmt++;
+            }
+            break;
+        case 'l':
+            len = LEN_L;
+            if (*++fmt == 'l')
+            {
+                len = LEN_LL;
+                fmt++;
+            }
+            break;
+        case 'q':
+        case 'j':
+            len = LEN_LL;
+            fmt++;
+            break;
+        case 'L':
+            len = LEN_LD;
+            fmt++;
+            break;
+        case 'z':
+        case 't':
+            len = LEN_L;
+            fmt++;
+            break;
+        }
+
+        char conv = *fmt++;
+        if (conv == '\0')
+            break;
+        void* dst = suppress || conv == 'n' ? NULL : va_arg(ap, void*);
+
+        if (conv == 'n')
+        {
+            if (!suppress)
+            {
+                void* p = va_arg(ap, void*);
+                if (len == LEN_HH)
+                    *(signed char*)p = in->count;
+                else if (len == LEN_H)
+                    *(short*)p = in->count;
+                else if (len == LEN_LL)
+                    *(long long*)p = in->count;
+                else if (len == LEN_L)
+                    *(long*)p = in->count;
+                else
+                    *(int*)p = in->count;
+            }
+            continue;
+        }
+
+        if (conv != 'c' && conv != '[')
+            skipSpace(in);
+
+        if (conv == 'c' || conv == 's' || conv == '[')
+        {
+            uint8_t set[32];
+            if (conv == '[')
+                fmt = scanSet(fmt, set);
+            if (width == 0)
+                width = conv == 'c' ? 1 : 0x7fffffff;
+
+            char* s = dst;
+            int n = 0;
+            int c = 0;
+            while (n < width && (c = in->get(in)) >= 0)
+            {
+                if ((conv == 's' && isSpace(c)) ||
+                    (conv == '[' && !(set[(unsigned char)c >> 3] & (1 << (c & 7)))))
+                {
+                    in->unget(in, c);
+                    break;
+                }
+                if (s)
+                    *s++ = c;
+                n++;
+            }
+            if (n == 0 || (conv == 'c' && n < width))
+            {
+                eof = c < 0;
+                break;
+            }
+            if (s && conv != 'c')
+                *s = '\0';
+        }
+        else if (conv == 'd' || conv == 'i' || conv == 'u' || conv == 'o' ||
+                 conv == 'x' || conv == 'X' || conv == 'p')
+        {
+            int base = conv == 'o' ? 8 : conv == 'i' ? 0 : conv == 'd' || conv == 'u' ? 10 : 16;
+            uint16_t w[4];
+            int neg;
+            int r = scanInt(in, width, base, w, &neg);
+            if (r <= 0)
+            {
+                eof = r < 0;
+                break;
+            }
+            uint32_t lo = w[0] | ((uint32_t)w[1] << 16);
+            uint32_t hi = w[2] | ((uint32_t)w[3] << 16);
+            if (neg)
+            {
+                hi = ~hi + (lo == 0);
+                lo = -lo;
+            }
+            if (dst)
+            {
+                if (conv == 'p')
+                    *(void**)dst = (void*)(unsigned long)lo;
+                else if (len == LEN_HH)
+                    *(char*)dst = lo;
+                else if (len == LEN_H)
+                    *(short*)dst = lo;
+                else if (len == LEN_LL)
+                    *(unsigned long long*)dst = ((unsigned long long)hi << 32) | lo;
+                else if (len == LEN_L)
+                    *(unsigned long*)dst = lo;
+                else
+                    *(unsigned int*)dst = lo;
+            }
+        }
+        else
+        {
+            int c = conv | 0x20;
+            if ((c != 'a' && c != 'e' && c != 'f' && c != 'g') || __scanf_float == NULL)
+                break;
+            int r = __scanf_float(in, width, len, dst);
+            if (r <= 0)
+            {
+                eof = r < 0;
+                break;
+            }
+        }
+
+        converted++;
+        if (dst)
+            assigned++;
+    }
+
+    return converted == 0 && eof ? -1 : assigned;
+}
@@ -0,0 +1,131 @@
+// scan_float.c - %e %f %g %a for scanf
+//
+// Linked only when the program asks for it with -u __scanf_float. The
+// number is checked against the strtod syntax here, then strtof/strtod
+// convert it, so scanf rounds exactly as they do.
+
+#include <stdlib.h>
+#include "format.h"
+
+#define FLOAT_CHARS 512     // longest number kept; more digits are dropped
+
+struct Lex
+{
+    struct In* in;
+    int left;               // characters the field width still allows
+    int c;                  // current character, -1 at end, -2 past width
+    char buf[FLOAT_CHARS + 1];
+    int n;
+};
+
+static void take(struct Lex* l)
+{
+    if (l->n < FLOAT_CHARS)
+        l->buf[l->n++] = l->c;
+    l->c = --l->left ? l->in->get(l->in) : -2;
+}
+
+// Take the letters of word (lower case) as long as they match
+static int takeWord(struct Lex* l, const char* word)
+{
+    for (; *word; word++)
+    {
+        if (l->c < 0 || (l->c | 0x20) != *word)
+            return 0;
+        take(l);
+    }
+    return 1;
+}
+
+static int takeDigits(struct Lex* l, int hex)
+{
+    int n = 0;
+    for (;;)
+    {
+        int c = l->c;
+        if (!((c >= '0' && c <= '9') || (hex && (c | 0x20) >= 'a' && (c | 0x20) <= 'f')))
+            return n;
+        take(l);
+        n++;
+    }
+}
+
+int __scanf_float(struct In* in, int width, int len, void* dst)
+{
+    struct Lex l;
+    l.in = in;
+    l.left = width ? width : 0x7fffffff;
+    l.n = 0;
+    l.c = in->get(in);
+    if (l.c < 0)
+        return -1;
+
+    if (l.c == '-' || l.c == '+')
+        take(&l);
+
+    int ok;
+    if (l.c >= 0 && (l.c | 0x20) == 'i')
+    {
+        ok = takeWord(&l, "inf");
+        if (ok && l.c >= 0 && (l.c | 0x20) == 'i')
+            takeWord(&l, "inity");
+    }
+    else if (l.c >= 0 && (l.c | 0x20) == 'n')
+    {
+        ok = takeWord(&l, "nan");
+        if (ok && l.c == '(')
+        {
+            do
+                take(&l);
+            while (l.c >= 0 && l.c != ')');
+            if (l.c == ')')
+                take(&l);
+        }
+    }
+    else
+    {
+        int hex = 0;
+        int digits = 0;
+        if (l.c == '0')
+        {
+            take(&l);
+            digits = 1;
+            if (l.c >= 0 && (l.c | 0x20) == 'x')
+            {
+                take(&l);
+                hex = 1;
+            }
+        }
+        digits += takeDigits(&l, hex);
+        if (l.c == '.')
+        {
+            take(&l);
+            digits += takeDigits(&l, hex);
+        }
+        ok = digits > 0;
+        if (ok && l.c >= 0 && (l.c | 0x20) == (hex ? 'p' : 'e'))
+        {
+            take(&l);
+            if (l.c == '-' || l.c == '+')
+                take(&l);
+            takeDigits(&l, 0);
+        }
+    }
+
+    if (l.c >= 0)
+        in->unget(in, l.c);
+    if (!ok)
+        return l.c == -1 && l.n == 0 ? -1 : 0;
+
+    l.buf[l.n] = '\0';
+    if (dst)
+    {
+        if (len == LEN_L)
+            *(double*)dst = strtod(l.buf, NULL);
+        else if (len == LEN_LD)
+            *(long double*)dst = strtod(l.buf, NULL);
+        else
+            *(float*)dst = strtof(l.buf, NULL);
+    }
+    return 1;
+}
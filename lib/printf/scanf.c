@@ -0,0 +1,48 @@
+// scanf.c - scanf, fscanf, vscanf, vfscanf
+
+#include <stdio.h>
+#include "format.h"
+
+static int getFile(struct In* in)
+{
+    int c = getc((FILE*)in->ctx);
+    if (c == EOF)
+        return -1;
+    in->count++;
+    return c;
+}
+
+static void ungetFile(struct In* in, int c)
+{
+    ungetc(c, (FILE*)in->ctx);
+    in->count--;
+}
+
+FORMAT_API int vfscanf(FILE* fp, const char* fmt, va_list ap)
+{
+    struct In in = { getFile, ungetFile, 0, fp, NULL };
+    return __vscan(&in, fmt, ap);
+}
+
+FORMAT_API int vscanf(const char* fmt, va_list ap)
+{
+    return vfscanf(stdin, fmt, ap);
+}
+
+FORMAT_API int fscanf(FILE* fp, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfscanf(fp, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+FORMAT_API int scanf(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfscanf(stdin, fmt, ap);
+    va_end(ap);
+    return n;
+}
@@ -0,0 +1,49 @@
+// sprintf.c - sprintf, snprintf, vsprintf, vsnprintf
+
+#include <stdio.h>
+#include <string.h>
+#include "format.h"
+
+static void putBuf(struct Out* o, const char* s, int len)
+{
+    unsigned long n = (unsigned long)len < o->room ? (unsigned long)len : o->room;
+    memcpy(o->buf, s, n);
+    o->buf += n;
+    o->room -= n;
+    o->count += len;
+}
+
+FORMAT_API int vsnprintf(char* buf, size_t size, const char* fmt, va_list ap)
+{
+    struct Out o = { putBuf, 0, NULL, buf, size ? size - 1 : 0 };
+    __vformat(&o, fmt, ap);
+    if (size)
+        *o.buf = '\0';
+    return o.count;
+}
+
+FORMAT_API int vsprintf(char* buf, const char* fmt, va_list ap)
+{
+    struct Out o = { putBuf, 0, NULL, buf, 0x7fffffff };
+    __vformat(&o, fmt, ap);
+    *o.buf = '\0';
+    return o.count;
+}
+
+FORMAT_API int snprintf(char* buf, size_t size, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+FORMAT_API int sprintf(char* buf, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsprintf(buf, fmt, ap);
+    va_end(ap);
+    return n;
+}
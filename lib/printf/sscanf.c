@@ -0,0 +1,36 @@
+// sscanf.c - sscanf, vsscanf
+
+#include <stdio.h>
+#include "format.h"
+
+static int getStr(struct In* in)
+{
+    unsigned char c = *in->str;
+    if (c == '\0')
+        return -1;
+    in->str++;
+    in->count++;
+    return c;
+}
+
+static void ungetStr(struct In* in, int c)
+{
+    (void)c;
+    in->str--;
+    in->count--;
+}
+
+FORMAT_API int vsscanf(const char* str, const char* fmt, va_list ap)
+{
+    struct In in = { getStr, ungetStr, 0, NULL, str };
+    return __vscan(&in, fmt, ap);
+}
+
+FORMAT_API int sscanf(const char* str, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsscanf(str, fmt, ap);
+    va_end(ap);
+    return n;
+}
@@ -0,0 +1,87 @@
+// adddf.c - __adddf3 __subdf3 __negdf2
+
+#include "softfloat.h"
+
+static double add(uint64_t a, uint64_t b)
+{
+    // |a| >= |b|; a NaN sorts above everything else
+    if ((a & ~make64(F_SIGN, 0)) < (b & ~make64(F_SIGN, 0)))
+    {
+        uint64_t t = a;
+        a = b;
+        b = t;
+    }
+    uint32_t sign = hi32(a) & F_SIGN;
+    int ea = (hi32(a) >> 20) & 0x7ff;
+    int eb = (hi32(b) >> 20) & 0x7ff;
+    uint64_t ma = shl64(a & make64(D_MAN, 0xffffffff), 10);
+    uint64_t mb = shl64(b & make64(D_MAN, 0xffffffff), 10);
+
+    if (ea == 0x7ff)
+    {
+        if (ma)
+            return nanD(a, b);
+        if (eb == 0x7ff && ((hi32(a) ^ hi32(b)) & F_SIGN))
+            return dvalue(make64(D_NAN, 0));    // inf - inf
+        return dvalue(a);
+    }
+    if (eb == 0)
+    {
+        if (mb == 0)
+            return dvalue(ea == 0 && ma == 0 ? a & b : a);  // -0 + -0 is -0
+        eb = 1;
+    }
+    else
+    {
+        mb |= D_HIDDEN;
+    }
+    if (ea == 0)
+        ea = 1;
+    else
+        ma |= D_HIDDEN;
+
+    mb = shrJam64(mb, ea - eb);
+    uint64_t m;
+    if ((hi32(a) ^ hi32(b)) & F_SIGN)
+    {
+        m = ma - mb;
+        if (m == 0)
+            return 0.0;
+        // whole words first: a near-cancellation can leave few bits
+        while (m < 0x40000000 && ea > 32)
+        {
+            m = make64((uint32_t)m, 0);
+            ea -= 32;
+        }
+        while (m < D_HIDDEN && ea > 1)
+        {
+            m <<= 1;
+            ea--;
+        }
+    }
+    else
+    {
+        m = ma + mb;
+        if (hi32(m) & F_SIGN)
+        {
+            m = shr64(m, 1) | (m & 1);
+            ea++;
+        }
+    }
+    return packD(sign, ea, m);
+}
+
+SF_API double __adddf3(double a, double b)
+{
+    return add(dbits(a), dbits(b));
+}
+
+SF_API double __subdf3(double a, double b)
+{
+    return add(dbits(a), dbits(b) ^ make64(F_SIGN, 0));
+}
+
+SF_API double __negdf2(double a)
+{
+    return dvalue(dbits(a) ^ make64(F_SIGN, 0));
+}
@@ -0,0 +1,80 @@
+// addsf.c - __addsf3 __subsf3 __negsf2
+
+#include "softfloat.h"
+
+static float add(uint32_t a, uint32_t b)
+{
+    // |a| >= |b|; a NaN sorts above everything else
+    if ((a & ~F_SIGN) < (b & ~F_SIGN))
+    {
+        uint32_t t = a;
+        a = b;
+        b = t;
+    }
+    int ea = (a >> 23) & 0xff;
+    int eb = (b >> 23) & 0xff;
+    uint32_t ma = (a & F_MAN) << 7;
+    uint32_t mb = (b & F_MAN) << 7;
+
+    if (ea == 0xff)
+    {
+        if (ma)
+            return nanF(a, b);
+        if (eb == 0xff && ((a ^ b) & F_SIGN))
+            return fvalue(F_NAN);   // inf - inf
+        return fvalue(a);
+    }
+    if (eb == 0)
+    {
+        if (mb == 0)
+            return fvalue(ea == 0 && ma == 0 ? a & b : a);  // -0 + -0 is -0
+        eb = 1;
+    }
+    else
+    {
+        mb |= F_HIDDEN;
+    }
+    if (ea == 0)
+        ea = 1;
+    else
+        ma |= F_HIDDEN;
+
+    mb = shrJam32(mb, ea - eb);
+    uint32_t m;
+    if ((a ^ b) & F_SIGN)
+    {
+        m = ma - mb;
+        if (m == 0)
+            return 0.0f;
+        while (m < F_HIDDEN && ea > 1)
+        {
+            m <<= 1;
+            ea--;
+        }
+    }
+    else
+    {
+        m = ma + mb;
+        if (m & F_SIGN)
+        {
+            m = (m >> 1) | (m & 1);
+            ea++;
+        }
+    }
+    return packF(a & F_SIGN, ea, m);
+}
+
+SF_API float __addsf3(float a, float b)
+{
+    return add(fbits(a), fbits(b));
+}
+
+SF_API float __subsf3(float a, float b)
+{
+    return add(fbits(a), fbits(b) ^ F_SIGN);
+}
+
+SF_API float __negsf2(float a)
+{
+    return fvalue(fbits(a) ^ F_SIGN);
+}
@@ -0,0 +1,66 @@
+// cmpdf.c - __cmpdf2 __eqdf2 __nedf2 __ltdf2 __ledf2 __gtdf2 __gedf2
+// __unorddf2
+//
+// Each comparison returns -1, 0 or 1 for less, equal or greater, and for
+// unordered operands (a NaN) the value that makes its test false.
+
+#include "softfloat.h"
+
+static int compare(uint64_t a, uint64_t b, int unordered)
+{
+    if (isNanD(a) || isNanD(b))
+        return unordered;
+    uint64_t mag = ~make64(F_SIGN, 0);
+    if (((a | b) & mag) == 0)
+        return 0;   // +0 == -0
+    uint32_t sa = hi32(a) & F_SIGN;
+    uint32_t sb = hi32(b) & F_SIGN;
+    if (sa != sb)
+        return sa ? -1 : 1;
+    a &= mag;
+    b &= mag;
+    if (a == b)
+        return 0;
+    // the larger magnitude is the smaller value when both are negative
+    return (a < b) != (sa != 0) ? -1 : 1;
+}
+
+SF_API int __cmpdf2(double a, double b)
+{
+    return compare(dbits(a), dbits(b), 1);
+}
+
+SF_API int __eqdf2(double a, double b)
+{
+    return compare(dbits(a), dbits(b), 1);
+}
+
+SF_API int __nedf2(double a, double b)
+{
+    return compare(dbits(a), dbits(b), 1);
+}
+
+SF_API int __ltdf2(double a, double b)
+{
+    return compare(dbits(a), dbits(b), 1);
+}
+
+SF_API int __ledf2(double a, double b)
+{
+    return compare(dbits(a), dbits(b), 1);
+}
+
+SF_API int __gtdf2(double a, double b)
+{
+    return compare(dbits(a), dbits(b), -1);
+}
+
+SF_API int __gedf2(double a, double b)
+{
+    return compare(dbits(a), dbits(b), -1);
+}
+
+SF_API int __unorddf2(double a, double b)
+{
+    return isNanD(dbits(a)) || isNanD(dbits(b));
+}
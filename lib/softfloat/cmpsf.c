@@ -0,0 +1,59 @@
+// cmpsf.c - __cmpsf2 __eqsf2 __nesf2 __ltsf2 __lesf2 __gtsf2 __gesf2
+// __unordsf2
+//
+// Each comparison returns -1, 0 or 1 for less, equal or greater, and for
+// unordered operands (a NaN) the value that makes its test false.
+
+#include "softfloat.h"
+
+static int compare(uint32_t a, uint32_t b, int unordered)
+{
+    if (isNanF(a) || isNanF(b))
+        return unordered;
+    if (((a | b) & ~F_SIGN) == 0)
+        return 0;   // +0 == -0
+    // sign-magnitude to two's complement orders like the values
+    int32_t ia = (a & F_SIGN) ? -(int32_t)(a & ~F_SIGN) : (int32_t)a;
+    int32_t ib = (b & F_SIGN) ? -(int32_t)(b & ~F_SIGN) : (int32_t)b;
+    return ia < ib ? -1 : ia > ib;
+}
+
+SF_API int __cmpsf2(float a, float b)
+{
+    return compare(fbits(a), fbits(b), 1);
+}
+
+SF_API int __eqsf2(float a, float b)
+{
+    return compare(fbits(a), fbits(b), 1);
+}
+
+SF_API int __nesf2(float a, float b)
+{
+    return compare(fbits(a), fbits(b), 1);
+}
+
+SF_API int __ltsf2(float a, float b)
+{
+    return compare(fbits(a), fbits(b), 1);
+}
+
+SF_API int __lesf2(float a, float b)
+{
+    return compare(fbits(a), fbits(b), 1);
+}
+
+SF_API int __gtsf2(float a, float b)
+{
+    return compare(fbits(a), fbits(b), -1);
+}
+
+SF_API int __gesf2(float a, float b)
+{
+    return compare(fbits(a), fbits(b), -1);
+}
+
+SF_API int __unordsf2(float a, float b)
+{
+    return isNanF(fbits(a)) || isNanF(fbits(b));
+}
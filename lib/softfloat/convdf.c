@@ -0,0 +1,111 @@
+// convdf.c - __floatsidf __floatunsidf __fixdfsi __fixunsdfsi
+// __extendsfdf2 __truncdfsf2
+//
+// Out-of-range conversions to integers saturate; a NaN gives the largest
+// value of its sign.
+
+#include "softfloat.h"
+
+// Exact: 32 bits always fit the significand
+static double fromUnsigned(uint32_t sign, uint32_t u)
+{
+    if (u == 0)
+        return 0.0;
+    int e = 1023 + 31;
+    while (!(u & F_SIGN))
+    {
+        u <<= 1;
+        e--;
+    }
+    // hidden bit from 31 to 20 of the high word
+    return dvalue(make64(sign | ((uint32_t)(e - 1) << 20), 0) + make64(u >> 11, u << 21));
+}
+
+SF_API double __floatsidf(int i)
+{
+    return i < 0 ? fromUnsigned(F_SIGN, -(uint32_t)i) : fromUnsigned(0, i);
+}
+
+SF_API double __floatunsidf(unsigned int u)
+{
+    return fromUnsigned(0, u);
+}
+
+// The integer part of a double of at most 32 bits, with its exponent e
+static uint32_t intPart(uint64_t a, int e)
+{
+    uint64_t m = (a & make64(D_MAN, 0xffffffff)) | make64(0x00100000, 0);
+    // e - 1023 integer bits of the 53
+    return shr64(m, 1075 - e);
+}
+
+SF_API int __fixdfsi(double d)
+{
+    uint64_t a = dbits(d);
+    int e = (hi32(a) >> 20) & 0x7ff;
+    if (e < 1023)
+        return 0;
+    if (e >= 1023 + 31)
+        return (hi32(a) & F_SIGN) ? -0x7fffffff - 1 : 0x7fffffff;
+    uint32_t m = intPart(a, e);
+    return (hi32(a) & F_SIGN) ? -(int)m : (int)m;
+}
+
+SF_API unsigned int __fixunsdfsi(double d)
+{
+    uint64_t a = dbits(d);
+    int e = (hi32(a) >> 20) & 0x7ff;
+    if (e < 1023 || (hi32(a) & F_SIGN))
+        return 0;
+    if (e >= 1023 + 32)
+        return 0xffffffffU;
+    return intPart(a, e);
+}
+
+// Exact, denormals included
+SF_API double __extendsfdf2(float f)
+{
+    uint32_t a = fbits(f);
+    uint32_t sign = a & F_SIGN;
+    int e = (a >> 23) & 0xff;
+    uint32_t m = a & F_MAN;
+
+    if (e == 0xff)
+    {
+        // infinity, or a NaN keeping its payload, made quiet
+        uint32_t hi = sign | D_INF | (m >> 3);
+        if (m)
+            hi |= D_QUIET;
+        return dvalue(make64(hi, m << 29));
+    }
+    if (e == 0)
+    {
+        if (m == 0)
+            return dvalue(make64(sign, 0));
+        e = 1;
+        m = normF(m, &e) & F_MAN;
+    }
+    return dvalue(make64(sign | ((uint32_t)(e - 127 + 1023) << 20) | (m >> 3), m << 29));
+}
+
+SF_API float __truncdfsf2(double d)
+{
+    uint64_t a = dbits(d);
+    uint32_t sign = hi32(a) & F_SIGN;
+    int e = (hi32(a) >> 20) & 0x7ff;
+    uint64_t m = a & make64(D_MAN, 0xffffffff);
+
+    if (e == 0x7ff)
+    {
+        if (m == 0)
+            return fvalue(sign | F_INF);
+        return fvalue(sign | F_NAN | (uint32_t)shr64(m, 29));
+    }
+    // a double denormal is far below the smallest float denormal
+    if (e == 0)
+        return fvalue(sign);
+
+    // hidden bit from 52 to 30
+    uint32_t m32 = (uint32_t)shrJam64(m | make64(0x00100000, 0), 22);
+    return packF(sign, e - 1023 + 127, m32);
+}
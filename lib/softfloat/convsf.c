@@ -0,0 +1,60 @@
+// convsf.c - __floatsisf __floatunsisf __fixsfsi __fixunssfsi
+//
+// Out-of-range conversions to integers saturate; a NaN gives the largest
+// value of its sign.
+
+#include "softfloat.h"
+
+static float fromUnsigned(uint32_t sign, uint32_t u)
+{
+    if (u == 0)
+        return 0.0f;
+    // hidden bit to 30, a bit shifted out of the top is kept sticky
+    int e = 127 + 30;
+    if (u & F_SIGN)
+    {
+        u = (u >> 1) | (u & 1);
+        e++;
+    }
+    while (!(u & F_HIDDEN))
+    {
+        u <<= 1;
+        e--;
+    }
+    return packF(sign, e, u);
+}
+
+SF_API float __floatsisf(int i)
+{
+    return i < 0 ? fromUnsigned(F_SIGN, -(uint32_t)i) : fromUnsigned(0, i);
+}
+
+SF_API float __floatunsisf(unsigned int u)
+{
+    return fromUnsigned(0, u);
+}
+
+SF_API int __fixsfsi(float f)
+{
+    uint32_t a = fbits(f);
+    int e = (a >> 23) & 0xff;
+    if (e < 127)
+        return 0;
+    if (e >= 127 + 31)
+        return (a & F_SIGN) ? -0x7fffffff - 1 : 0x7fffffff;
+    uint32_t m = (a & F_MAN) | 0x00800000;
+    m = e >= 150 ? m << (e - 150) : m >> (150 - e);
+    return (a & F_SIGN) ? -(int)m : (int)m;
+}
+
+SF_API unsigned int __fixunssfsi(float f)
+{
+    uint32_t a = fbits(f);
+    int e = (a >> 23) & 0xff;
+    if (e < 127 || (a & F_SIGN))
+        return 0;
+    if (e >= 127 + 32)
+        return 0xffffffffU;
+    uint32_t m = (a & F_MAN) | 0x00800000;
+    return e >= 150 ? m << (e - 150) : m >> (150 - e);
+}
@@ -0,0 +1,73 @@
+// divdf.c - __divdf3
+
+#include "softfloat.h"
+
+SF_API double __divdf3(double da, double db)
+{
+    uint64_t a = dbits(da);
+    uint64_t b = dbits(db);
+    uint32_t sign = (hi32(a) ^ hi32(b)) & F_SIGN;
+    int ea = (hi32(a) >> 20) & 0x7ff;
+    int eb = (hi32(b) >> 20) & 0x7ff;
+    uint64_t ma = a & make64(D_MAN, 0xffffffff);
+    uint64_t mb = b & make64(D_MAN, 0xffffffff);
+
+    if (ea == 0x7ff)
+    {
+        if (ma || isNanD(b))
+            return nanD(a, b);
+        if (eb == 0x7ff)
+            return dvalue(make64(D_NAN, 0));    // inf / inf
+        return dvalue(make64(sign | D_INF, 0));
+    }
+    if (eb == 0x7ff)
+    {
+        if (mb)
+            return nanD(a, b);
+        return dvalue(make64(sign, 0));
+    }
+    if (eb == 0)
+    {
+        if (mb == 0)
+        {
+            if (ea == 0 && ma == 0)
+                return dvalue(make64(D_NAN, 0));    // 0 / 0
+            return dvalue(make64(sign | D_INF, 0));
+        }
+        eb = 1;
+        mb = normD(mb, &eb);
+    }
+    if (ea == 0)
+    {
+        if (ma == 0)
+            return dvalue(make64(sign, 0));
+        ea = 1;
+        ma = normD(ma, &ea);
+    }
+    ma |= make64(0x00100000, 0);
+    mb |= make64(0x00100000, 0);
+
+    int e = ea - eb + 1023;
+    if (ma < mb)
+    {
+        ma <<= 1;
+        e--;
+    }
+
+    // 54 quotient bits (53 and a guard bit), one per step, collected in
+    // two words; the remainder stays below 2 * mb < 2^54
+    uint32_t qhi = 0;
+    uint32_t qlo = 0;
+    for (int i = 0; i < 54; i++)
+    {
+        qhi = (qhi << 1) | (qlo >> 31);
+        qlo <<= 1;
+        if (ma >= mb)
+        {
+            ma -= mb;
+            qlo |= 1;
+        }
+        ma <<= 1;
+    }
+    return packD(sign, e, shl64(make64(qhi, qlo), 9) | (ma != 0));
+}
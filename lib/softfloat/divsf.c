@@ -0,0 +1,71 @@
+// divsf.c - __divsf3
+
+#include "softfloat.h"
+
+SF_API float __divsf3(float fa, float fb)
+{
+    uint32_t a = fbits(fa);
+    uint32_t b = fbits(fb);
+    uint32_t sign = (a ^ b) & F_SIGN;
+    int ea = (a >> 23) & 0xff;
+    int eb = (b >> 23) & 0xff;
+    uint32_t ma = a & F_MAN;
+    uint32_t mb = b & F_MAN;
+
+    if (ea == 0xff)
+    {
+        if (ma || isNanF(b))
+            return nanF(a, b);
+        if (eb == 0xff)
+            return fvalue(F_NAN);   // inf / inf
+        return fvalue(sign | F_INF);
+    }
+    if (eb == 0xff)
+    {
+        if (mb)
+            return nanF(a, b);
+        return fvalue(sign);
+    }
+    if (eb == 0)
+    {
+        if (mb == 0)
+        {
+            if (ea == 0 && ma == 0)
+                return fvalue(F_NAN);   // 0 / 0
+            return fvalue(sign | F_INF);
+        }
+        eb = 1;
+        mb = normF(mb, &eb);
+    }
+    if (ea == 0)
+    {
+        if (ma == 0)
+            return fvalue(sign);
+        ea = 1;
+        ma = normF(ma, &ea);
+    }
+    ma |= 0x00800000;
+    mb |= 0x00800000;
+
+    int e = ea - eb + 127;
+    if (ma < mb)
+    {
+        ma <<= 1;
+        e--;
+    }
+
+    // 25 quotient bits (24 and a guard bit), one per step; the remainder
+    // stays below 2 * mb < 2^25
+    uint32_t q = 0;
+    for (int i = 0; i < 25; i++)
+    {
+        q <<= 1;
+        if (ma >= mb)
+        {
+            ma -= mb;
+            q |= 1;
+        }
+        ma <<= 1;
+    }
+    return packF(sign, e, (q << 6) | (ma != 0));
+}
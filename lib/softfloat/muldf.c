@@ -0,0 +1,69 @@
+// muldf.c - __muldf3
+
+#include "softfloat.h"
+
+SF_API double __muldf3(double da, double db)
+{
+    uint64_t a = dbits(da);
+    uint64_t b = dbits(db);
+    uint32_t sign = (hi32(a) ^ hi32(b)) & F_SIGN;
+    int ea = (hi32(a) >> 20) & 0x7ff;
+    int eb = (hi32(b) >> 20) & 0x7ff;
+    uint64_t ma = a & make64(D_MAN, 0xffffffff);
+    uint64_t mb = b & make64(D_MAN, 0xffffffff);
+
+    if (ea == 0x7ff || eb == 0x7ff)
+    {
+        if (isNanD(a) || isNanD(b))
+            return nanD(a, b);
+        // inf * 0
+        if ((ea == 0 && ma == 0) || (eb == 0 && mb == 0))
+            return dvalue(make64(D_NAN, 0));
+        return dvalue(make64(sign | D_INF, 0));
+    }
+    if (ea == 0)
+    {
+        if (ma == 0)
+            return dvalue(make64(sign, 0));
+        ea = 1;
+        ma = normD(ma, &ea);
+    }
+    if (eb == 0)
+    {
+        if (mb == 0)
+            return dvalue(make64(sign, 0));
+        eb = 1;
+        mb = normD(mb, &eb);
+    }
+
+    // Both significands with the hidden bit at 63, as 16-bit digits,
+    // least significant first; the 128-bit product's upper half has it
+    // at 62 or 63 and the lower half only matters as a sticky bit
+    uint64_t xa = shl64(ma | make64(0x00100000, 0), 11);
+    uint64_t xb = shl64(mb | make64(0x00100000, 0), 11);
+    uint16_t x[4] = { (uint16_t)xa, (uint16_t)((uint32_t)xa >> 16), (uint16_t)hi32(xa), (uint16_t)(hi32(xa) >> 16) };
+    uint16_t y[4] = { (uint16_t)xb, (uint16_t)((uint32_t)xb >> 16), (uint16_t)hi32(xb), (uint16_t)(hi32(xb) >> 16) };
+    uint16_t r[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    for (int i = 0; i < 4; i++)
+    {
+        uint32_t carry = 0;
+        for (int j = 0; j < 4; j++)
+        {
+            // at most 0xfffe0001 + 0xffff + 0xffff: no overflow
+            uint32_t t = mul16(x[i], y[j]) + r[i + j] + carry;
+            r[i + j] = t;
+            carry = t >> 16;
+        }
+        r[i + 4] = carry;
+    }
+
+    uint64_t m = make64(((uint32_t)r[7] << 16) | r[6], ((uint32_t)r[5] << 16) | r[4]);
+    m |= (r[3] | r[2] | r[1] | r[0]) != 0;
+    int e = ea + eb - 1023;
+    if (hi32(m) & F_SIGN)
+    {
+        m = shr64(m, 1) | (m & 1);
+        e++;
+    }
+    return packD(sign, e, m);
+}
@@ -0,0 +1,50 @@
+// mulsf.c - __mulsf3
+
+#include "softfloat.h"
+
+SF_API float __mulsf3(float fa, float fb)
+{
+    uint32_t a = fbits(fa);
+    uint32_t b = fbits(fb);
+    uint32_t sign = (a ^ b) & F_SIGN;
+    int ea = (a >> 23) & 0xff;
+    int eb = (b >> 23) & 0xff;
+    uint32_t ma = a & F_MAN;
+    uint32_t mb = b & F_MAN;
+
+    if (ea == 0xff || eb == 0xff)
+    {
+        if (isNanF(a) || isNanF(b))
+            return nanF(a, b);
+        // inf * 0
+        if ((ea == 0 && ma == 0) || (eb == 0 && mb == 0))
+            return fvalue(F_NAN);
+        return fvalue(sign | F_INF);
+    }
+    if (ea == 0)
+    {
+        if (ma == 0)
+            return fvalue(sign);
+        ea = 1;
+        ma = normF(ma, &ea);
+    }
+    if (eb == 0)
+    {
+        if (mb == 0)
+            return fvalue(sign);
+        eb = 1;
+        mb = normF(mb, &eb);
+    }
+
+    // both significands with the hidden bit at 31: the product's top
+    // word has it at 30 or 31
+    uint64_t p = mul32((ma | 0x00800000) << 8, (mb | 0x00800000) << 8);
+    uint32_t m = hi32(p) | ((uint32_t)p != 0);
+    int e = ea + eb - 127;
+    if (m & F_SIGN)
+    {
+        m = (m >> 1) | (m & 1);
+        e++;
+    }
+    return packF(sign, e, m);
+}
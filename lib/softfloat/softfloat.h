@@ -0,0 +1,246 @@
+// softfloat.h - internals of the IEEE 754 soft-float library
+//
+// Replaces lb1sf68.S's single and double routines with ones that round to
+// nearest-even and handle infinities, NaNs and denormals. Written in C for
+// the 68000: wide products are built from 16x16 multiplies (mulu.w), 64-bit
+// shifts are done on 32-bit halves so none becomes a __lshrdi3 call, and
+// nothing needs mulu.l or divu.l.
+//
+// Working format: a significand with its hidden bit at bit 30 (single,
+// in a uint32_t) or bit 62 (double, in a uint64_t), so the bits below are
+// guard bits for rounding and the bit above catches a carry. The exponent
+// is the biased one the hidden bit would have.
+//
+// SF_API marks the routines libgcc also defines. softfloat.specs forces
+// every one of them in (-u) ahead of libgcc, so none of lb1sf68.S's float
+// objects is ever needed; a symbol still clashing fails the link rather
+// than quietly replacing ours.
+
+#ifndef SOFTFLOAT_H
+#define SOFTFLOAT_H
+
+#include <stdint.h>
+
+#define SF_API
+
+#define F_SIGN      0x80000000UL
+#define F_INF       0x7f800000UL
+#define F_QUIET     0x00400000UL
+#define F_NAN       0x7fc00000UL    // the NaN invalid operations produce
+#define F_MAN       0x007fffffUL
+#define F_HIDDEN    0x40000000UL    // working format, bit 30
+
+#define D_INF       0x7ff00000UL    // high words
+#define D_QUIET     0x00080000UL
+#define D_NAN       0x7ff80000UL
+#define D_MAN       0x000fffffUL
+#define D_HIDDEN    0x4000000000000000ULL   // working format, bit 62
+
+union FloatBits
+{
+    float f;
+    uint32_t u;
+};
+
+union DoubleBits
+{
+    double d;
+    uint64_t u;
+};
+
+static inline uint32_t fbits(float f)
+{
+    union FloatBits b;
+    b.f = f;
+    return b.u;
+}
+
+static inline float fvalue(uint32_t u)
+{
+    union FloatBits b;
+    b.u = u;
+    return b.f;
+}
+
+static inline uint64_t dbits(double d)
+{
+    union DoubleBits b;
+    b.d = d;
+    return b.u;
+}
+
+static inline double dvalue(uint64_t u)
+{
+    union DoubleBits b;
+    b.u = u;
+    return b.d;
+}
+
+static inline uint32_t hi32(uint64_t x)
+{
+    return x >> 32;
+}
+
+static inline uint64_t make64(uint32_t hi, uint32_t lo)
+{
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// 16x16 -> 32: one mulu.w
+static inline uint32_t mul16(uint16_t a, uint16_t b)
+{
+    return (uint32_t)a * b;
+}
+
+// 32x32 -> 64 from four mulu.w
+static inline uint64_t mul32(uint32_t a, uint32_t b)
+{
+    uint32_t ll = mul16(a, b);
+    uint32_t lh = mul16(a, b >> 16);
+    uint32_t hl = mul16(a >> 16, b);
+    uint32_t hh = mul16(a >> 16, b >> 16);
+    uint32_t mid = lh + (ll >> 16);     // cannot carry
+    mid += hl;
+    if (mid < hl)
+        hh += 0x10000;
+    return make64(hh + (mid >> 16), (mid << 16) | (ll & 0xffff));
+}
+
+// x >> n for 0 < n < 64, on 32-bit halves
+static inline uint64_t shr64(uint64_t x, int n)
+{
+    uint32_t hi = hi32(x);
+    uint32_t lo = x;
+    if (n >= 32)
+        return hi >> (n - 32);
+    return make64(hi >> n, (lo >> n) | (hi << (32 - n)));
+}
+
+// x << n for 0 < n < 64
+static inline uint64_t shl64(uint64_t x, int n)
+{
+    uint32_t hi = hi32(x);
+    uint32_t lo = x;
+    if (n >= 32)
+        return make64(lo << (n - 32), 0);
+    return make64((hi << n) | (lo >> (32 - n)), lo << n);
+}
+
+// Right shifts that fold the bits shifted out into bit 0 ("sticky"), so
+// rounding still sees that the value was inexact
+static inline uint32_t shrJam32(uint32_t x, int n)
+{
+    if (n <= 0)
+        return x;
+    if (n >= 32)
+        return x != 0;
+    return (x >> n) | ((x << (32 - n)) != 0);
+}
+
+static inline uint64_t shrJam64(uint64_t x, int n)
+{
+    if (n <= 0)
+        return x;
+    if (n >= 64)
+        return x != 0;
+    uint32_t hi = hi32(x);
+    uint32_t lo = x;
+    if (n >= 32)
+    {
+        uint32_t sticky = lo != 0 || (n > 32 && (hi << (64 - n)) != 0);
+        return (n == 32 ? hi : hi >> (n - 32)) | sticky;
+    }
+    uint32_t sticky = (lo << (32 - n)) != 0;
+    return make64(hi >> n, (lo >> n) | (hi << (32 - n)) | sticky);
+}
+
+// Round a working-format single to nearest-even and encode it. e <= 0
+// gives a denormal (or zero); a result past the largest finite one gives
+// infinity. m may be below the hidden bit only when e is 1 (denormal).
+static inline float packF(uint32_t sign, int e, uint32_t m)
+{
+    if (e >= 0xff)
+        return fvalue(sign | F_INF);
+    if (e <= 0)
+    {
+        m = shrJam32(m, 1 - e);
+        e = 1;
+    }
+    uint32_t round = m & 0x7f;
+    m >>= 7;
+    if (round > 0x40 || (round == 0x40 && (m & 1)))
+        m++;
+    // the hidden bit adds itself to the exponent field, and a rounding
+    // carry out of the significand (or a denormal rounded up to the
+    // smallest normal) bumps it by one more
+    uint32_t r = ((uint32_t)(e - 1) << 23) + m;
+    if (r >= F_INF)
+        r = F_INF;
+    return fvalue(sign | r);
+}
+
+// The same for a working-format double
+static inline double packD(uint32_t sign, int e, uint64_t m)
+{
+    if (e >= 0x7ff)
+        return dvalue(make64(sign | D_INF, 0));
+    if (e <= 0)
+    {
+        m = shrJam64(m, 1 - e);
+        e = 1;
+    }
+    uint32_t round = (uint32_t)m & 0x3ff;
+    m = shr64(m, 10);
+    if (round > 0x200 || (round == 0x200 && (m & 1)))
+        m++;
+    uint32_t hi = hi32(m) + ((uint32_t)(e - 1) << 20);
+    if (hi >= D_INF)
+        return dvalue(make64(sign | D_INF, 0));
+    return dvalue(make64(sign | hi, (uint32_t)m));
+}
+
+// Shift a denormal's significand up to the hidden bit (23 or 52),
+// lowering the exponent to match; *e starts at 1
+static inline uint32_t normF(uint32_t m, int* e)
+{
+    while (!(m & 0x00800000))
+    {
+        m <<= 1;
+        (*e)--;
+    }
+    return m;
+}
+
+static inline uint64_t normD(uint64_t m, int* e)
+{
+    while (!(hi32(m) & 0x00100000))
+    {
+        m <<= 1;
+        (*e)--;
+    }
+    return m;
+}
+
+static inline int isNanF(uint32_t a)
+{
+    return (a & ~F_SIGN) > F_INF;
+}
+
+static inline int isNanD(uint64_t a)
+{
+    uint32_t hi = hi32(a) & ~F_SIGN;
+    return hi > D_INF || (hi == D_INF && (uint32_t)a != 0);
+}
+
+// The NaN an operation with a NaN operand returns: the first NaN, quiet
+static inline float nanF(uint32_t a, uint32_t b)
+{
+    return fvalue((isNanF(a) ? a : b) | F_QUIET);
+}
+
+static inline double nanD(uint64_t a, uint64_t b)
+{
+    return dvalue((isNanD(a) ? a : b) | make64(D_QUIET, 0));
+}
+
+#endif
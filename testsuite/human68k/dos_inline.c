@@ -0,0 +1,66 @@
+// Test the inline DOS calls (__DOS_INLINE__) against the libdos.a ones
+// Exercises: _dos_curdrv, _dos_create, _dos_write, _dos_seek, _dos_read,
+// _dos_fgetc, _dos_close, _dos_delete, _dos_exit2
+#define __DOS_INLINE__
+#include <stdio.h>
+#include <string.h>
+#include <sys/dos.h>
+
+// each call this test exercises must really be inlined; one left as a
+// library stub would only be compared with itself
+#if !defined(_dos_curdrv) || !defined(_dos_create) || !defined(_dos_write) \
+    || !defined(_dos_seek) || !defined(_dos_read) || !defined(_dos_fgetc) \
+    || !defined(_dos_close) || !defined(_dos_delete) || !defined(_dos_exit2)
+#error "not inlined"
+#endif
+
+static int failures = 0;
+
+static void check(const char* name, int condition)
+{
+    if (!condition)
+    {
+        printf("FAIL: %s\n", name);
+        failures++;
+    }
+}
+
+static const char name[] = "DOSINL.TMP";
+static const char msg[] = "inline DOS";
+
+int main(void)
+{
+    char buf[16];
+
+    check("curdrv", _dos_curdrv() == (_dos_curdrv)());
+
+    int fd = _dos_create(name, 0x20);
+    check("create", fd >= 0);
+    if (fd < 0)
+        _dos_exit2(1);
+
+    check("write", _dos_write(fd, msg, sizeof(msg) - 1) == (int)(sizeof(msg) - 1));
+    check("seek", _dos_seek(fd, 0, 0) == 0);
+
+    memset(buf, 0, sizeof(buf));
+    check("read", _dos_read(fd, buf, 6) == 6 && memcmp(buf, "inline", 6) == 0);
+    check("fgetc", _dos_fgetc(fd) == ' ' && (_dos_fgetc)(fd) == 'D');
+
+    // an argument with side effects is evaluated once
+    int pos = 1;
+    check("seek with side effects", _dos_seek(fd, pos++, 0) == 1 && pos == 2);
+    check("fgetc after seek", _dos_fgetc(fd) == 'n');
+    check("seek end", _dos_seek(fd, 0, 2) == (_dos_seek)(fd, 0, 2));
+
+    check("close", _dos_close(fd) == 0);
+    check("delete", _dos_delete(name) == 0);
+    check("open deleted", _dos_open(name, 0) < 0);
+
+    if (failures)
+    {
+        printf("FAILED: %d test(s)\n", failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
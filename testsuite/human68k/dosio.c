@@ -0,0 +1,144 @@
+// Test the Human68k stdio buffering layer (libdosio)
+// LDFLAGS: -specs=dosio.specs -Wl,--wrap=_dos_write
+#include <stdio.h>
+#include <string.h>
+#include <sys/dos.h>
+#include <dosio.h>
+
+static int failures = 0;
+
+static void check(const char* name, int condition)
+{
+    if (!condition)
+    {
+        printf("FAIL: %s\n", name);
+        failures++;
+    }
+}
+
+// count the writes newlib's syscall glue makes
+static long writes;
+
+int __real__dos_write(int fd, const void* buf, int n);
+
+int __wrap__dos_write(int fd, const void* buf, int n)
+{
+    writes++;
+    return __real__dos_write(fd, buf, n);
+}
+
+#define BUFFERING(fp) ((fp)->_flags & (__SLBF | __SNBF))
+
+static const char name[] = "DOSIO.TMP";
+
+static void files(void)
+{
+    char line[32];
+
+    FILE* fp = fopen(name, "w");
+    check("fopen", fp != NULL);
+    if (!fp)
+        return;
+    check("file classified", __dosio_class(fileno(fp)) == DOSIO_FILE);
+    check("file buffer", fp->_bf._size == DOSIO_FILE_BUFSIZE && BUFFERING(fp) == 0);
+
+    // 400 short lines fit the 8K buffer: one write, at fclose
+    long before = writes;
+    for (int i = 0; i < 400; i++)
+        fprintf(fp, "line %d\n", i);
+    check("no write while buffering", writes == before);
+    check("fclose", fclose(fp) == 0);
+    check("one write per buffer", writes == before + 1);
+
+    fp = fopen(name, "r");
+    check("reopen", fp != NULL);
+    if (fp)
+    {
+        int n = 0;
+        while (fgets(line, sizeof(line), fp))
+            n++;
+        check("read back", n == 400 && strcmp(line, "line 399\n") == 0);
+        fclose(fp);
+    }
+    check("remove", remove(name) == 0);
+}
+
+static void devices(void)
+{
+    // a console opened by name stays line buffered
+    FILE* fp = fopen("CON", "w");
+    check("fopen CON", fp != NULL);
+    if (fp)
+    {
+        check("CON classified", __dosio_class(fileno(fp)) == DOSIO_CONSOLE);
+        check("CON buffer", fp->_bf._size == DOSIO_CONSOLE_BUFSIZE && BUFFERING(fp) == __SLBF);
+        fclose(fp);
+    }
+
+    fp = fopen("NUL", "w");
+    check("fopen NUL", fp != NULL);
+    if (fp)
+    {
+        check("NUL classified", __dosio_class(fileno(fp)) == DOSIO_DEVICE);
+        check("NUL buffer", fp->_bf._size == DOSIO_DEVICE_BUFSIZE && BUFFERING(fp) == 0);
+        long before = writes;
+        for (int i = 0; i < 20; i++)
+            fprintf(fp, "%d\n", i);
+        check("NUL batched", writes == before);
+        fclose(fp);
+        check("NUL flushed once", writes == before + 1);
+    }
+}
+
+// stdout on the console, whatever run68 connected it to
+static void console(void)
+{
+    fflush(stdout);
+    int saved = _dos_dup(1);
+    int con = _dos_open("CON", 1);
+    check("open CON", saved >= 0 && con >= 0);
+    if (saved < 0 || con < 0)
+        return;
+    _dos_dup2(con, 1);
+    _dos_close(con);
+    __dosio_init();
+
+    check("stdout is the console", __dosio_class(fileno(stdout)) == DOSIO_CONSOLE);
+    check("stdout buffer", stdout->_bf._size == DOSIO_CONSOLE_BUFSIZE && BUFFERING(stdout) == 0);
+    check("buffered putchar", !__dosio_direct);
+
+    // several lines go out in one write, and not before they have to
+    long before = writes;
+    printf("console line 1\n");
+    printf("console line 2\n");
+    check("console lines batched", writes == before);
+
+    // putchar stores straight into the buffer
+    unsigned char* p = stdout->_p;
+    (putchar)('>');
+    check("putchar fast path", stdout->_p == p + 1 && *p == '>' && writes == before);
+
+    // a stderr write flushes stdout first, keeping the two in order
+    fprintf(stderr, "\n");
+    check("stderr flushes stdout", stdout->_p == stdout->_bf._base && writes == before + 2);
+
+    fflush(stdout);
+    _dos_dup2(saved, 1);
+    _dos_close(saved);
+    __dosio_init();
+}
+
+int main(void)
+{
+    files();
+    devices();
+    console();
+
+    if (failures)
+    {
+        printf("FAILED: %d test(s)\n", failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
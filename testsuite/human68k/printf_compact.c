@@ -0,0 +1,113 @@
+// Test the compact printf/scanf library (libprintf) with float support
+// LDFLAGS: -lprintf -u __printf_float -u __scanf_float
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void check(const char* name, int condition)
+{
+    if (!condition)
+    {
+        printf("FAIL: %s\n", name);
+        failures++;
+    }
+}
+
+static int same(const char* buf, const char* want)
+{
+    if (strcmp(buf, want) == 0)
+        return 1;
+    printf("  got \"%s\", want \"%s\"\n", buf, want);
+    return 0;
+}
+
+int main(void)
+{
+    char buf[128];
+    int n;
+
+    sprintf(buf, "%d", 12345);
+    check("sprintf decimal", same(buf, "12345"));
+
+    sprintf(buf, "%x", 0xCAFE);
+    check("sprintf hex", same(buf, "cafe"));
+
+    sprintf(buf, "%-10s|", "left");
+    check("sprintf left-align", same(buf, "left      |"));
+
+    sprintf(buf, "%05d", 42);
+    check("sprintf zero-pad", same(buf, "00042"));
+
+    n = snprintf(buf, 8, "truncated string");
+    check("snprintf truncates", strlen(buf) == 7 && n == 16);
+
+    sprintf(buf, "%ld %lu", -2147483647L - 1, 4294967295UL);
+    check("sprintf long", same(buf, "-2147483648 4294967295"));
+
+    sprintf(buf, "%lld %llx", -1234567890123456789LL, 0xdeadbeefcafeULL);
+    check("sprintf long long", same(buf, "-1234567890123456789 deadbeefcafe"));
+
+    sprintf(buf, "%#x %#o %+d % d %.3d %hhu", 255, 8, 5, 5, 7, 300);
+    check("sprintf flags", same(buf, "0xff 010 +5  5 007 44"));
+
+    sprintf(buf, "%*d|%-*s|%.*s", 4, 1, 3, "a", 2, "xyz");
+    check("sprintf star", same(buf, "   1|a  |xy"));
+
+    sprintf(buf, "%f %e %g", 3.14159, 3.14159, 3.14159);
+    check("sprintf float", same(buf, "3.141590 3.141590e+00 3.14159"));
+
+    sprintf(buf, "%.0f %.0f %.0f %.2f", 0.5, 1.5, 2.5, 1.005);
+    check("sprintf float rounding", same(buf, "0 2 2 1.00"));
+
+    sprintf(buf, "%g %g %g %G", 100000.0, 1000000.0, 0.0001, 1e-5);
+    check("sprintf %g", same(buf, "100000 1e+06 0.0001 1E-05"));
+
+    sprintf(buf, "%.17g %.3e", 0.1, 1e308);
+    check("sprintf float precision", same(buf, "0.10000000000000001 1.000e+308"));
+
+    sprintf(buf, "%e", 5e-324);
+    check("sprintf denormal", same(buf, "4.940656e-324"));
+
+    sprintf(buf, "%010.3f|%-8.2f|%+.1e", -3.14159, 2.0, 12345.0);
+    check("sprintf float field", same(buf, "-00003.142|2.00    |+1.2e+04"));
+
+    sprintf(buf, "%a %A %.1a", 1.0, -2.5, 1.96875);
+    check("sprintf hex float", same(buf, "0x1p+0 -0X1.4P+1 0x2.0p+0"));
+
+    double inf = 1e308 * 10;
+    sprintf(buf, "%f %E %5f", inf, -inf, inf - inf);
+    check("sprintf inf/nan", strncmp(buf, "inf -INF ", 9) == 0 && strstr(buf, "nan") != NULL);
+
+    int a, b;
+    unsigned u;
+    char s[16];
+    n = sscanf("  42 -0x1f 0777 word", "%d %i %o %15s", &a, &b, &u, s);
+    check("sscanf integers", n == 4 && a == 42 && b == -31 && u == 0777 && strcmp(s, "word") == 0);
+
+    long long ll;
+    n = sscanf("-9223372036854775808", "%lld", &ll);
+    check("sscanf long long", n == 1 && ll == -9223372036854775807LL - 1);
+
+    n = sscanf("abc]def xyz", "%[]a-c]%[^ ]%n", buf, s, &a);
+    check("sscanf sets", n == 2 && strcmp(buf, "abc]") == 0 && strcmp(s, "def") == 0 && a == 7);
+
+    float f;
+    double d;
+    n = sscanf("3.25 -1e-3 0x1.8p1", "%f %lf %*f", &f, &d);
+    check("sscanf float", n == 2 && f == 3.25f && d == -1e-3);
+
+    n = sscanf("", "%d", &a);
+    check("sscanf eof", n == EOF);
+
+    n = sscanf("x", "%d", &a);
+    check("sscanf mismatch", n == 0);
+
+    if (failures)
+    {
+        printf("FAILED: %d test(s)\n", failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
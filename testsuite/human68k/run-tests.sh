@@ -1,7 +1,14 @@
 #!/bin/sh
 # Run human68k-specific tests
-# Usage: run-tests.sh [test.c|test.cc ...]
+# Usage: run-tests.sh [-j N] [--tap FILE] [--junit FILE] [test.c|test.cc ...]
 # If no arguments, runs all .c and .cc files in this directory.
+# Extra elf2x68k options (e.g. --compress) can be passed in ELF2X68K_FLAGS.
+# A test can ask for link options with a "// LDFLAGS: ..." line.
+#
+# Tests run in parallel, each in its own temporary directory. Without -j the
+# job count follows make's -j when run from make (1 if none), otherwise the
+# CPU count. Compile, convert and run wall times are reported per test;
+# --tap and --junit also write the results as TAP or JUnit XML.
 
 PREFIX="${HUMAN68K_PREFIX:-/opt/human68k}"
 CC="${PREFIX}/bin/m68k-human68k-gcc"
@@ -11,18 +18,38 @@ RUN68="${PREFIX}/bin/run68"
 DIR="$(cd "$(dirname "$0")" && pwd)"
 TMPDIR="${TMPDIR:-/tmp}"
 
-pass=0
-fail=0
-error=0
+# wall clock in milliseconds (whole seconds where date has no %N)
+now_ms()
+{
+    t=$(date +%s%N 2>/dev/null)
+    case "$t" in
+        ''|*N*) echo $(($(date +%s) * 1000)) ;;
+        *) echo $((t / 1000000)) ;;
+    esac
+}
 
+# milliseconds as seconds with three decimals
+fmt_s()
+{
+    printf "%d.%03d" $(($1 / 1000)) $(($1 % 1000))
+}
+
+# Worker: run-tests.sh --run-one RESULTDIR SRC
+# Compiles, converts and runs one test inside RESULTDIR, leaving behind
+# "status" (PASS, FAIL, COMPILE or CONVERT), "rc", "times" (compile,
+# convert and run milliseconds) and "log".
 run_one()
 {
-    src="$1"
+    out="$1"
+    src="$2"
     ext="${src##*.}"
     name="$(basename "$src")"
     name="${name%.*}"
-    elf="${TMPDIR}/${name}.elf"
-    xfile="${TMPDIR}/${name}.x"
+    elf="${out}/${name}.elf"
+    xfile="${out}/${name}.x"
+    t_cc=0
+    t_conv=0
+    t_run=0
 
     # pick compiler
     if [ "$ext" = "cc" ] || [ "$ext" = "cpp" ]; then
@@ -31,52 +58,204 @@ run_one()
         compiler="$CC"
     fi
 
-    printf "%-30s " "${name}..."
+    # per-test link options
+    ldflags=$(sed -n 's|^// LDFLAGS: *||p' "$src")
 
     # compile
-    if ! "$compiler" -O2 "$src" -o "$elf" 2>"${TMPDIR}/${name}.err"; then
-        printf "COMPILE ERROR\n"
-        cat "${TMPDIR}/${name}.err"
-        error=$((error + 1))
-        rm -f "$elf" "${TMPDIR}/${name}.err"
-        return
-    fi
+    t0=$(now_ms)
+    if ! "$compiler" -O2 "$src" -o "$elf" $ldflags >"${out}/log" 2>&1; then
+        status=COMPILE
+        rc=1
+        t_cc=$(($(now_ms) - t0))
+    else
+        t_cc=$(($(now_ms) - t0))
 
-    # convert
-    if ! "$ELF2X68K" "$elf" "$xfile" 2>/dev/null; then
-        printf "ELF2X68K ERROR\n"
-        error=$((error + 1))
-        rm -f "$elf" "$xfile" "${TMPDIR}/${name}.err"
-        return
+        # convert
+        t0=$(now_ms)
+        if ! "$ELF2X68K" -q $ELF2X68K_FLAGS "$elf" "$xfile" >"${out}/log" 2>&1; then
+            status=CONVERT
+            rc=1
+            t_conv=$(($(now_ms) - t0))
+        else
+            t_conv=$(($(now_ms) - t0))
+
+            # run
+            t0=$(now_ms)
+            "$RUN68" "$xfile" >"${out}/log" 2>&1
+            rc=$?
+            t_run=$(($(now_ms) - t0))
+            if [ $rc -eq 0 ]; then
+                status=PASS
+            else
+                status=FAIL
+            fi
+        fi
     fi
+    rm -f "$elf" "$xfile"
 
-    # run
-    output=$("$RUN68" "$xfile" 2>&1)
-    rc=$?
-    rm -f "$elf" "$xfile" "${TMPDIR}/${name}.err"
+    echo "$name" >"${out}/name"
+    echo "$rc" >"${out}/rc"
+    echo "$t_cc $t_conv $t_run" >"${out}/times"
+    echo "$status" >"${out}/status"
 
-    if [ $rc -eq 0 ]; then
-        printf "PASS\n"
-        pass=$((pass + 1))
-    else
-        printf "FAIL (exit %d)\n" "$rc"
-        echo "$output" | sed 's/^/  /'
-        fail=$((fail + 1))
-    fi
+    case "$status" in
+        PASS) msg="PASS" ;;
+        FAIL) msg="FAIL (exit $rc)" ;;
+        COMPILE) msg="COMPILE ERROR" ;;
+        CONVERT) msg="ELF2X68K ERROR" ;;
+    esac
+    # one printf per line, so parallel workers do not interleave
+    printf "%-30s %-16s cc %ss  elf2x68k %ss  run %ss\n" "${name}..." "$msg" \
+        "$(fmt_s $t_cc)" "$(fmt_s $t_conv)" "$(fmt_s $t_run)"
 }
 
-# collect test files
+if [ "$1" = "--run-one" ]; then
+    run_one "$2" "$3"
+    exit 0
+fi
+
+# job count: -j, else make's -j (when called from make), else CPU count
+jobs=
+tap=
+junit=
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -j) jobs="$2"; shift 2 ;;
+        -j*) jobs="${1#-j}"; shift ;;
+        --tap) tap="$2"; shift 2 ;;
+        --junit) junit="$2"; shift 2 ;;
+        --) shift; break ;;
+        -*) echo "Unknown option: $1" >&2; exit 2 ;;
+        *) break ;;
+    esac
+done
+
+ncpu=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+if [ -z "$jobs" ] && [ -n "$MAKELEVEL" ]; then
+    jobs=1
+    for w in $MAKEFLAGS; do
+        case "$w" in
+            -j) jobs=$ncpu ;;
+            -j[0-9]*) jobs="${w#-j}" ;;
+            --jobs=*) jobs="${w#--jobs=}" ;;
+        esac
+    done
+fi
+[ -n "$jobs" ] || jobs=$ncpu
+
+root=$(mktemp -d "${TMPDIR}/human68k-tests.XXXXXX") || exit 1
+trap 'rm -rf "$root"' EXIT
+trap 'exit 130' INT TERM
+
+# collect test files, one per line
 if [ $# -gt 0 ]; then
-    tests="$@"
+    printf "%s\n" "$@"
 else
-    tests=$(ls "${DIR}"/*.c "${DIR}"/*.cc 2>/dev/null | sort)
-fi
+    ls "${DIR}"/*.c "${DIR}"/*.cc 2>/dev/null | sort
+fi >"${root}/tests"
+
+# one numbered result directory per test, in test order; the worker list
+# is NUL-separated so paths with spaces stay whole
+n=0
+while IFS= read -r src; do
+    [ -f "$src" ] || continue
+    n=$((n + 1))
+    mkdir "${root}/${n}"
+    printf "%s\n" "$src" >"${root}/${n}/src"
+    printf "%s\0%s\0" "${root}/${n}" "$src"
+done <"${root}/tests" >"${root}/list"
+
+start=$(now_ms)
+xargs -0 -n 2 -P "$jobs" sh "${DIR}/$(basename "$0")" --run-one <"${root}/list"
+elapsed=$(($(now_ms) - start))
+
+pass=0
+fail=0
+error=0
+t_cc=0
+t_conv=0
+t_run=0
+
+[ -n "$tap" ] && printf "TAP version 13\n1..%d\n" "$n" >"$tap"
 
-for src in $tests; do
-    [ -f "$src" ] && run_one "$src"
+i=0
+while [ $i -lt $n ]; do
+    i=$((i + 1))
+    out="${root}/${i}"
+    if [ -f "${out}/status" ]; then
+        status=$(cat "${out}/status")
+        name=$(cat "${out}/name")
+        rc=$(cat "${out}/rc")
+        read c v r <"${out}/times"
+    else
+        # worker never finished (killed, or sh failed to start)
+        status=MISSING
+        name=$(cat "${out}/src")
+        name=$(basename "${name%.*}")
+        rc=1
+        c=0; v=0; r=0
+        : >"${out}/log"
+    fi
+    t_cc=$((t_cc + c))
+    t_conv=$((t_conv + v))
+    t_run=$((t_run + r))
+
+    case "$status" in
+        PASS) pass=$((pass + 1)) ;;
+        FAIL) fail=$((fail + 1)) ;;
+        *) error=$((error + 1)) ;;
+    esac
+
+    if [ "$status" != PASS ]; then
+        printf "\n%s: %s\n" "$name" "$status"
+        sed 's/^/  /' "${out}/log"
+    fi
+
+    if [ -n "$tap" ]; then
+        if [ "$status" = PASS ]; then
+            printf "ok %d - %s\n" "$i" "$name"
+        else
+            printf "not ok %d - %s\n" "$i" "$name"
+        fi
+        printf "  ---\n  status: %s\n  exit: %d\n" "$status" "$rc"
+        printf "  compile_ms: %d\n  convert_ms: %d\n  run_ms: %d\n" "$c" "$v" "$r"
+        if [ "$status" != PASS ] && [ -s "${out}/log" ]; then
+            printf "  output: |\n"
+            sed 's/^/    /' "${out}/log"
+        fi
+        printf "  ...\n"
+    fi >>"${tap:-/dev/null}"
+
+    if [ -n "$junit" ]; then
+        printf '  <testcase classname="human68k" name="%s" time="%s">\n' \
+            "$name" "$(fmt_s $((c + v + r)))"
+        case "$status" in
+            PASS) ;;
+            FAIL) printf '    <failure message="exit %d"/>\n' "$rc" ;;
+            COMPILE) printf '    <error message="compile error"/>\n' ;;
+            CONVERT) printf '    <error message="elf2x68k error"/>\n' ;;
+            *) printf '    <error message="no result"/>\n' ;;
+        esac
+        printf '    <system-out><![CDATA[compile %ss, convert %ss, run %ss\n' \
+            "$(fmt_s $c)" "$(fmt_s $v)" "$(fmt_s $r)"
+        sed 's/]]>/]]]]><![CDATA[>/g' "${out}/log"
+        printf ']]></system-out>\n  </testcase>\n'
+    fi >>"${root}/junit"
 done
 
 total=$((pass + fail + error))
 printf "\n%d tests: %d pass, %d fail, %d error\n" "$total" "$pass" "$fail" "$error"
+printf "%ss wall with %d jobs (cc %ss, elf2x68k %ss, run %ss total)\n" "$(fmt_s $elapsed)" \
+    "$jobs" "$(fmt_s $t_cc)" "$(fmt_s $t_conv)" "$(fmt_s $t_run)"
+
+if [ -n "$junit" ]; then
+    {
+        printf '<?xml version="1.0" encoding="UTF-8"?>\n'
+        printf '<testsuite name="human68k" tests="%d" failures="%d" errors="%d" time="%s">\n' \
+            "$total" "$fail" "$error" "$(fmt_s $elapsed)"
+        [ -f "${root}/junit" ] && cat "${root}/junit"
+        printf '</testsuite>\n'
+    } >"$junit"
+fi
 
 [ $fail -eq 0 ] && [ $error -eq 0 ]
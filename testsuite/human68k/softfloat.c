@@ -0,0 +1,123 @@
+// Test the IEEE 754 soft-float library (libsoftfloat): infinities, NaNs,
+// denormals and round-to-nearest-even, which lb1sf68.S does not provide
+// LDFLAGS: -specs=softfloat.specs
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void check(const char* name, int condition)
+{
+    if (!condition)
+    {
+        printf("FAIL: %s\n", name);
+        failures++;
+    }
+}
+
+static uint32_t fbits(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static uint32_t dhigh(double d)
+{
+    uint64_t u;
+    memcpy(&u, &d, sizeof(u));
+    return u >> 32;
+}
+
+static uint32_t dlow(double d)
+{
+    uint64_t u;
+    memcpy(&u, &d, sizeof(u));
+    return u;
+}
+
+// prevent constant folding
+volatile double dzero = 0.0;
+volatile double done = 1.0;
+volatile double dbig = 1e308;
+volatile double dtiny = 2.2250738585072014e-308;   // smallest normal
+volatile float fzero = 0.0f;
+volatile float fone = 1.0f;
+volatile float fbig = 3e38f;
+volatile float ftiny = 1.17549435e-38f;
+volatile int imin = -2147483647 - 1;
+
+int main(void)
+{
+    // infinities
+    double dinf = dbig * 10.0;
+    check("double overflow is inf", dhigh(dinf) == 0x7ff00000 && dlow(dinf) == 0);
+    check("double inf compares", dinf > dbig && -dinf < -dbig);
+    check("double 1/0 is inf", done / dzero == dinf);
+    check("double -1/0 is -inf", -done / dzero == -dinf);
+    check("double inf + 1", dinf + done == dinf);
+    float finf = fbig * 10.0f;
+    check("float overflow is inf", fbits(finf) == 0x7f800000);
+    check("float 1/0 is inf", fone / fzero == finf);
+
+    // NaNs
+    double dnan = dzero / dzero;
+    check("double 0/0 is nan", (dhigh(dnan) & 0x7ff00000) == 0x7ff00000 && (dhigh(dnan) & 0xfffff) != 0);
+    check("double nan != nan", dnan != dnan && !(dnan == dnan));
+    check("double nan unordered", !(dnan < done) && !(dnan > done) && !(dnan <= done) && !(dnan >= done));
+    check("double inf - inf is nan", (dinf - dinf) != (dinf - dinf));
+    check("double inf * 0 is nan", (dinf * dzero) != (dinf * dzero));
+    check("double nan propagates", (dnan + done) != (dnan + done));
+    float fnan = fzero / fzero;
+    check("float 0/0 is nan", fnan != fnan && (fbits(fnan) & 0x7f800000) == 0x7f800000);
+    check("float nan unordered", !(fnan < fone) && !(fnan >= fone));
+    check("nan converts", (float)dnan != (float)dnan && (double)fnan != (double)fnan);
+
+    // signed zeros
+    check("-0 == +0", -dzero == dzero);
+    check("1 - 1 is +0", dhigh(done - done) == 0);
+    check("-0 + -0 is -0", dhigh(-dzero + -dzero) == 0x80000000);
+    check("1 / -inf is -0", dhigh(done / -dinf) == 0x80000000);
+
+    // denormals
+    double dden = dtiny / 4.0;
+    check("double denormal", dhigh(dden) == 0x00040000 && dlow(dden) == 0);
+    check("double denormal back", dden * 4.0 == dtiny);
+    check("double smallest denormal", dhigh(dtiny * 0x1p-52) == 0 && dlow(dtiny * 0x1p-52) == 1);
+    check("double underflow to 0", dtiny * 0x1p-54 == 0.0);
+    check("double denormal rounds to even", dlow(dtiny * 0x1p-53) == 0);
+    check("double denormal rounds up", dlow(dtiny * 0x1.8p-53) == 1);
+    float fden = ftiny / 8.0f;
+    check("float denormal", fbits(fden) == 0x00100000);
+    check("float denormal to double and back", (float)(double)fden == fden);
+    check("float subtraction to denormal", fbits(ftiny * 1.5f - ftiny) == 0x00400000);
+
+    // round to nearest, ties to even
+    check("1 + 2^-53 ties down", done + 0x1p-53 == 1.0);
+    check("1 + 3*2^-53 ties up", done + 0x1.8p-52 == 1.0 + 0x1p-51);
+    check("1 + 2^-53 + 2^-60 rounds up", done + (0x1p-53 + 0x1p-60) == 1.0 + 0x1p-52);
+    check("float 1 + 2^-24 ties down", fone + 0x1p-24f == 1.0f);
+    check("float 1 + 3*2^-24 ties up", fone + 0x1.8p-23f == 1.0f + 0x1p-22f);
+    check("1/3", dhigh(done / 3.0) == 0x3fd55555 && dlow(done / 3.0) == 0x55555555);
+    check("2/3", dhigh(2.0 * done / 3.0) == 0x3fe55555 && dlow(2.0 * done / 3.0) == 0x55555555);
+    check("0.1 * 3", 0.1 * (3.0 * done) == 0.30000000000000004);
+    check("double to float rounds", fbits((float)(done + 0x1p-24)) == 0x3f800000 &&
+                                    fbits((float)(done + 0x1.000001p-24)) == 0x3f800001);
+
+    // conversions
+    check("int min to double", (double)imin == -2147483648.0);
+    check("int min to float", (float)imin == -2147483648.0f);
+    check("float from large int rounds", (float)(imin + 1) == -2147483648.0f);
+    check("double to int truncates", (int)(-2.75 * done) == -2 && (int)(2.75 * done) == 2);
+    check("double to unsigned", (unsigned)(4294967295.0 * done) == 4294967295U);
+    check("float to int", (int)(-3.5f * fone) == -3);
+
+    if (failures)
+    {
+        printf("FAILED: %d test(s)\n", failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
@@ -1,6 +1,7 @@
 // elf2x68k - Convert m68k ELF (with relocations) to Human68k X-file format
 //
 // Usage: elf2x68k input.elf output.x
+//        elf2x68k --batch manifest.txt   (many files, one process)
 //
 // The input ELF must have been linked with -q (--emit-relocs) to preserve
 // R_68K_32 relocations. The linker script should place .text at 0x0 with
@@ -10,6 +11,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 
 // ELF structures (big-endian 32-bit m68k)
@@ -83,6 +92,10 @@ typedef struct
 #define R_68K_32 1
 #define STB_LOCAL 0
 #define STB_GLOBAL 1
+#define STB_WEAK 2
+#define STT_SECTION 3
+#define STT_FILE 4
+#define SHN_UNDEF 0
 #define SHN_ABS 0xFFF1
 
 #define ELF32_R_TYPE(i) ((i) & 0xff)
@@ -117,30 +130,1430 @@ static uint32_t read_be32(const void* p)
     return (b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
 }
 
+// Input ELF image. Regular files are mapped read-only so section contents
+// can be handed to writev() without copying; anything that cannot be mapped
+// (pipes, character devices) is read into a heap buffer instead.
+struct InputFile
+{
+    const uint8_t* data;
+    size_t size;
+    int mapped;
+};
+
+static int inputOpen(const char* path, struct InputFile* in, FILE* log)
+{
+    in->data = NULL;
+    in->size = 0;
+    in->mapped = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(log, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            close(fd);
+            in->data = p;
+            in->size = st.st_size;
+            in->mapped = 1;
+            return 0;
+        }
+    }
+
+    // Fallback: slurp the stream
+    size_t cap = 65536;
+    uint8_t* buf = malloc(cap);
+    for (;;)
+    {
+        if (in->size == cap)
+        {
+            cap *= 2;
+            buf = realloc(buf, cap);
+        }
+        ssize_t n = read(fd, buf + in->size, cap - in->size);
+        if (n < 0)
+        {
+            fprintf(log, "%s: %s\n", path, strerror(errno));
+            free(buf);
+            close(fd);
+            return -1;
+        }
+        if (n == 0)
+            break;
+        in->size += n;
+    }
+    close(fd);
+    in->data = buf;
+    return 0;
+}
+
+static void inputClose(struct InputFile* in)
+{
+    if (in->mapped)
+        munmap((void*)in->data, in->size);
+    else
+        free((void*)in->data);
+    in->data = NULL;
+}
+
+// Output writer: one aligned buffer that small records (header, relocation
+// entries, symbols, zero fill) are encoded into. Large blocks such as
+// section contents are not copied: they are written straight from the input
+// mapping together with the buffered bytes in a single writev(). With
+// fd < 0 the buffer is a fixed memory target that is never flushed.
+#define OUT_BUF_SIZE (64 * 1024)
+
+struct OutBuf
+{
+    int fd;
+    uint8_t* buf;
+    size_t len;
+    size_t size;
+};
+
+static int outOpen(struct OutBuf* ob, int fd)
+{
+    void* p;
+    if (posix_memalign(&p, 4096, OUT_BUF_SIZE) != 0)
+        return -1;
+    ob->fd = fd;
+    ob->buf = p;
+    ob->len = 0;
+    ob->size = OUT_BUF_SIZE;
+    return 0;
+}
+
+// Write the buffered bytes followed by extra, retrying short writes
+static int outFlush(struct OutBuf* ob, const void* extra, size_t extraLen)
+{
+    struct iovec iov[2];
+    int count = 0;
+
+    if (ob->len > 0)
+    {
+        iov[count].iov_base = ob->buf;
+        iov[count].iov_len = ob->len;
+        count++;
+    }
+    if (extraLen > 0)
+    {
+        iov[count].iov_base = (void*)extra;
+        iov[count].iov_len = extraLen;
+        count++;
+    }
+
+    struct iovec* v = iov;
+    while (count > 0)
+    {
+        ssize_t n = writev(ob->fd, v, count);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+
+        // Skip fully written entries, trim a partially written one
+        while (count > 0 && (size_t)n >= v->iov_len)
+        {
+            n -= v->iov_len;
+            v++;
+            count--;
+        }
+        if (count > 0)
+        {
+            v->iov_base = (uint8_t*)v->iov_base + n;
+            v->iov_len -= n;
+        }
+    }
+
+    ob->len = 0;
+    return 0;
+}
+
+static int outPut(struct OutBuf* ob, const void* data, size_t len)
+{
+    if (ob->fd >= 0)
+    {
+        if (len >= ob->size / 2)
+            return outFlush(ob, data, len);
+        if (ob->len + len > ob->size && outFlush(ob, NULL, 0) < 0)
+            return -1;
+    }
+    memcpy(ob->buf + ob->len, data, len);
+    ob->len += len;
+    return 0;
+}
+
+static int outZeros(struct OutBuf* ob, size_t len)
+{
+    while (len > 0)
+    {
+        if (ob->len == ob->size && outFlush(ob, NULL, 0) < 0)
+            return -1;
+        size_t n = ob->size - ob->len;
+        if (n > len)
+            n = len;
+        memset(ob->buf + ob->len, 0, n);
+        ob->len += n;
+        len -= n;
+    }
+    return 0;
+}
+
 // Section info collected from ELF
 struct SectionInfo
 {
-    uint32_t offset;    // file offset
-    uint32_t addr;      // virtual address
-    uint32_t size;      // section size
-    int shndx;          // section header index
+    uint32_t offset;    // file offset
+    uint32_t addr;      // virtual address
+    uint32_t size;      // section size
+    int shndx;          // section header index
+    uint32_t imgOffset; // offset in text+data image
+};
+
+static int sectionCmp(const void* a, const void* b)
+{
+    const struct SectionInfo* sa = a;
+    const struct SectionInfo* sb = b;
+    if (sa->imgOffset < sb->imgOffset)
+        return -1;
+    if (sa->imgOffset > sb->imgOffset)
+        return 1;
+    return 0;
+}
+
+// Relocation entry
+struct Reloc
+{
+    uint32_t offset;    // absolute offset in image (text_base=0)
+    uint8_t drop;       // RELOC_KEEP, or why the loader does not need it
+};
+
+// Relocations that --optimize-relocs removes from the table
+#define RELOC_KEEP       0
+#define RELOC_NO_SYMBOL  1  // no symbol: the value is a plain constant
+#define RELOC_WEAK_UNDEF 2  // undefined weak symbol, must stay 0
+#define RELOC_NOT_LOADED 3  // symbol in a section that is not loaded
+
+// Symbol classes, one byte per entry of a symbol table
+#define SYM_ADDR         0  // address in the image, needs relocation
+#define SYM_ABS          1  // SHN_ABS constant (e.g. __stack_size)
+#define SYM_WEAK_UNDEF   2
+#define SYM_NOT_LOADED   3
+
+// Per-category counts for the --optimize-relocs report
+struct RelocStats
+{
+    int total;          // R_68K_32 relocations in text and data
+    int abs;            // against SHN_ABS symbols, never emitted
+    int dropped[4];     // indexed by RELOC_*
+    int dups;
+    int pcrelJump;      // jsr/jmp abs.l within 16-bit PC reach
+    int pcrelAddr;      // lea/pea abs.l within 16-bit PC reach
+    int fixupsBefore;   // entries in the table without / with the pass
+    int fixupsAfter;
+    int sizeBefore;
+    int sizeAfter;
+    int longBefore;
+    int longAfter;
+};
+
+// Sort relocations by offset: LSD radix sort, one pass per byte of the
+// offset. Passes where every entry has the same byte value (typically the
+// upper bytes of small programs) are skipped. Returns -1 if out of memory.
+static int relocSort(struct Reloc* relocs, int n)
+{
+    if (n < 2)
+        return 0;
+
+    struct Reloc* tmp = malloc(n * sizeof(struct Reloc));
+    if (!tmp)
+        return -1;
+
+    struct Reloc* src = relocs;
+    struct Reloc* dst = tmp;
+
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        uint32_t count[256];
+        memset(count, 0, sizeof(count));
+        for (int i = 0; i < n; i++)
+            count[(src[i].offset >> shift) & 0xff]++;
+
+        if (count[(src[0].offset >> shift) & 0xff] == (uint32_t)n)
+            continue;
+
+        uint32_t pos = 0;
+        for (int d = 0; d < 256; d++)
+        {
+            uint32_t c = count[d];
+            count[d] = pos;
+            pos += c;
+        }
+
+        for (int i = 0; i < n; i++)
+            dst[count[(src[i].offset >> shift) & 0xff]++] = src[i];
+
+        struct Reloc* t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != relocs)
+        memcpy(relocs, src, n * sizeof(struct Reloc));
+    free(tmp);
+    return 0;
+}
+
+// Number of entries in a symbol table section, clamped to the file size
+static uint32_t symCount(const Elf32_Shdr* symtabSh, size_t fileSize)
+{
+    uint32_t symOffset = read_be32(&symtabSh->sh_offset);
+    uint32_t symSize = read_be32(&symtabSh->sh_size);
+    uint32_t symEntSize = read_be32(&symtabSh->sh_entsize);
+    if (symEntSize == 0)
+        symEntSize = sizeof(Elf32_Sym);
+
+    if (symOffset > fileSize)
+        return 0;
+    if (symSize > fileSize - symOffset)
+        symSize = fileSize - symOffset;
+    return symSize / symEntSize;
+}
+
+// Classify every symbol of a symbol table (SYM_*)
+static uint8_t* buildSymClass(const uint8_t* elf, const uint8_t* shdrs, uint16_t shentsize,
+                              uint16_t shnum, const Elf32_Shdr* symtabSh, uint32_t numSyms)
+{
+    uint32_t symEntSize = read_be32(&symtabSh->sh_entsize);
+    if (symEntSize == 0)
+        symEntSize = sizeof(Elf32_Sym);
+
+    uint8_t* cls = calloc(numSyms + 1, 1);
+    const uint8_t* sp = elf + read_be32(&symtabSh->sh_offset);
+    for (uint32_t i = 0; i < numSyms; i++, sp += symEntSize)
+    {
+        const Elf32_Sym* sym = (const Elf32_Sym*)sp;
+        uint16_t shndx = read_be16(&sym->st_shndx);
+
+        if (shndx == SHN_ABS)
+            cls[i] = SYM_ABS;
+        else if (shndx == SHN_UNDEF && ELF32_ST_BIND(sym->st_info) == STB_WEAK)
+            cls[i] = SYM_WEAK_UNDEF;
+        else if (shndx != SHN_UNDEF && shndx < shnum)
+        {
+            const Elf32_Shdr* sh = (const Elf32_Shdr*)(shdrs + shndx * shentsize);
+            if (!(read_be32(&sh->sh_flags) & SHF_ALLOC))
+                cls[i] = SYM_NOT_LOADED;
+        }
+    }
+    return cls;
+}
+
+// Copy len bytes at image offset imgOff out of the input file. Bytes in
+// gaps between sections read as zero. secs must be sorted by imgOffset.
+static void imageRead(const struct SectionInfo* secs, int numSecs, const uint8_t* elf,
+                      uint32_t imgOff, uint8_t* dst, int len)
+{
+    memset(dst, 0, len);
+
+    int lo = 0, hi = numSecs - 1, found = -1;
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (secs[mid].imgOffset <= imgOff)
+        {
+            found = mid;
+            lo = mid + 1;
+        }
+        else
+            hi = mid - 1;
+    }
+
+    if (found >= 0 && imgOff + len <= secs[found].imgOffset + secs[found].size)
+        memcpy(dst, elf + secs[found].offset + (imgOff - secs[found].imgOffset), len);
+}
+
+// Encode sorted relocations in the X-file format: a 16-bit delta from the
+// previous relocation, or for deltas above 0xFFFF a 0x0001 marker followed
+// by the 32-bit delta. Duplicates are skipped, and so are dropped entries
+// when skipDropped is set. With out == NULL only the size is computed.
+// Returns the table size in bytes, or -1 if writing to out failed.
+static int relocEncode(const struct Reloc* relocs, int n, int skipDropped, struct OutBuf* out,
+                       int* numDups, int* numLong, FILE* log)
+{
+    int size = 0;
+    int dups = 0;
+    int longs = 0;
+    int first = 1;
+    uint32_t lastOffset = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (skipDropped && relocs[i].drop != RELOC_KEEP)
+            continue;
+
+        uint32_t delta = relocs[i].offset - lastOffset;
+
+        if (delta == 0 && !first)
+        {
+            if (log)
+                fprintf(log, "Warning: duplicate relocation at offset 0x%x\n", relocs[i].offset);
+            dups++;
+            continue;
+        }
+
+        if (delta > 0xFFFF)
+        {
+            if (out)
+            {
+                uint8_t entry[6];
+                uint16_t marker = be16(0x0001);
+                uint32_t d = be32(delta);
+                memcpy(entry, &marker, 2);
+                memcpy(entry + 2, &d, 4);
+                if (outPut(out, entry, 6) < 0)
+                    return -1;
+            }
+            size += 6;
+            longs++;
+        }
+        else
+        {
+            // Short form: 16-bit delta (even, so never mistaken for the marker)
+            if (out)
+            {
+                uint16_t d = be16((uint16_t)delta);
+                if (outPut(out, &d, 2) < 0)
+                    return -1;
+            }
+            size += 2;
+        }
+
+        lastOffset = relocs[i].offset;
+        first = 0;
+    }
+
+    if (numDups)
+        *numDups = dups;
+    if (numLong)
+        *numLong = longs;
+    return size;
+}
+
+// Look for "jsr/jmp/lea/pea abs.l" whose target is within reach of a
+// 16-bit PC displacement. These are only reported: rewriting them would
+// change instruction sizes, which has to happen at compile/link time.
+static void relocFindPcrel(const struct Reloc* relocs, int n, const struct SectionInfo* secs,
+                           int numSecs, const uint8_t* elf, uint32_t textSize,
+                           uint32_t loadSize, struct RelocStats* st)
+{
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t off = relocs[i].offset;
+        if (relocs[i].drop != RELOC_KEEP || off < 2 || off + 4 > textSize)
+            continue;
+
+        uint8_t b[6];
+        imageRead(secs, numSecs, elf, off - 2, b, 6);
+        uint16_t op = read_be16(b);
+        uint32_t target = read_be32(b + 2);
+        int32_t disp = (int32_t)(target - off);
+
+        if (target >= loadSize || disp < -32768 || disp > 32767)
+            continue;
+
+        if (op == 0x4EB9 || op == 0x4EF9)           // jsr/jmp (xxx).l
+            st->pcrelJump++;
+        else if ((op & 0xF1FF) == 0x41F9 || op == 0x4879)  // lea (xxx).l,An / pea (xxx).l
+            st->pcrelAddr++;
+    }
+}
+
+static void relocReport(FILE* log, const struct RelocStats* st)
+{
+    fprintf(log, "Relocation summary:\n");
+    fprintf(log, "  R_68K_32 in text/data:        %6d\n", st->total);
+    fprintf(log, "  against SHN_ABS (skipped):    %6d\n", st->abs);
+    fprintf(log, "  duplicate offsets (skipped):  %6d\n", st->dups);
+    fprintf(log, "  no symbol, constant value:    %6d removed\n", st->dropped[RELOC_NO_SYMBOL]);
+    fprintf(log, "  undefined weak symbol:        %6d removed\n", st->dropped[RELOC_WEAK_UNDEF]);
+    fprintf(log, "  symbol in unloaded section:   %6d removed\n", st->dropped[RELOC_NOT_LOADED]);
+    fprintf(log, "  PC-relative candidates:       %6d (jsr/jmp %d, lea/pea %d, %d bytes of code)\n",
+            st->pcrelJump + st->pcrelAddr, st->pcrelJump, st->pcrelAddr,
+            2 * (st->pcrelJump + st->pcrelAddr));
+    fprintf(log, "  loader fixups:          %6d -> %6d\n", st->fixupsBefore, st->fixupsAfter);
+    fprintf(log, "  table size:             %6d -> %6d bytes (long entries %d -> %d)\n",
+            st->sizeBefore, st->sizeAfter, st->longBefore, st->longAfter);
+}
+
+// ---------------------------------------------------------------------------
+// Size report: attribute every byte of text/data/bss to a symbol and to the
+// object (archive member) it came from
+// ---------------------------------------------------------------------------
+//
+// Symbols cover [st_value, st_value + st_size), or up to the next symbol
+// when st_size is 0. Bytes no symbol covers are reported as "(fill)".
+// Objects come from the input sections of an ld map file (-Wl,-Map) when
+// one is given with --map. Otherwise STT_FILE names are used for local
+// symbols, and each global symbol takes the object of the symbol before it
+// in address order, which is approximate.
+
+#define SIZE_TEXT 0
+#define SIZE_DATA 1
+#define SIZE_BSS  2
+
+static const char* const sizeRegionName[3] = { "text", "data", "bss" };
+
+struct SizeSym
+{
+    const char* name;
+    uint32_t addr;
+    uint32_t size;          // st_size, 0 if unknown
+    uint32_t bytes;         // bytes attributed
+    int region;             // SIZE_TEXT, SIZE_DATA, SIZE_BSS
+    int object;             // index into objects, -1 if unknown
+};
+
+struct SizeObj
+{
+    char* name;             // "libc.a(lib_a-vfprintf.o)", "main.o", ...
+    uint32_t bytes[3];
+    int index;              // position before sorting
+};
+
+struct MapRange
+{
+    uint32_t addr;
+    uint32_t size;
+    int object;
+};
+
+struct SizeReport
+{
+    struct SizeSym* syms;
+    int numSyms;
+    struct SizeObj* objs;
+    int numObjs;
+    int maxObjs;
+    struct MapRange* ranges;
+    int numRanges;
+    int maxRanges;
+    uint32_t regionSize[3];
+    uint32_t fill[3];
+    int lastObj;            // lookup cache: objects repeat in runs
+};
+
+static int sizeObject(struct SizeReport* rep, const char* name, size_t len)
+{
+    if (rep->lastObj >= 0 && strlen(rep->objs[rep->lastObj].name) == len &&
+        memcmp(rep->objs[rep->lastObj].name, name, len) == 0)
+        return rep->lastObj;
+
+    for (int i = 0; i < rep->numObjs; i++)
+    {
+        if (strlen(rep->objs[i].name) == len && memcmp(rep->objs[i].name, name, len) == 0)
+            return rep->lastObj = i;
+    }
+
+    if (rep->numObjs == rep->maxObjs)
+    {
+        rep->maxObjs = rep->maxObjs ? rep->maxObjs * 2 : 64;
+        rep->objs = realloc(rep->objs, rep->maxObjs * sizeof(struct SizeObj));
+    }
+    struct SizeObj* o = &rep->objs[rep->numObjs];
+    o->name = malloc(len + 1);
+    memcpy(o->name, name, len);
+    o->name[len] = '\0';
+    memset(o->bytes, 0, sizeof(o->bytes));
+    return rep->lastObj = rep->numObjs++;
+}
+
+static int mapRangeCmp(const void* a, const void* b)
+{
+    const struct MapRange* ra = a;
+    const struct MapRange* rb = b;
+    if (ra->addr != rb->addr)
+        return ra->addr < rb->addr ? -1 : 1;
+    return 0;
+}
+
+// Read the input section lines of a GNU ld map file:
+//   " .text.foo      0x00001234      0x56 /path/libc.a(lib_a-foo.o)"
+// Long section names put address, size and file on the following line.
+// Object names are reduced to the basename of the archive or object.
+static int sizeReadMap(struct SizeReport* rep, const char* path, FILE* log)
+{
+    FILE* f = fopen(path, "r");
+    if (!f)
+    {
+        fprintf(log, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    char line[4096];
+    int pending = 0;    // previous line held only a section name
+    int inMap = 0;
+    while (fgets(line, sizeof(line), f))
+    {
+        if (!inMap)
+        {
+            inMap = strncmp(line, "Linker script and memory map", 28) == 0;
+            continue;
+        }
+
+        const char* p = line;
+        if (!pending)
+        {
+            // Input sections are indented by exactly one space
+            if (line[0] != ' ' || (line[1] != '.' && strncmp(line + 1, "COMMON", 6) != 0))
+                continue;
+            p = line + 1;
+            while (*p && *p != ' ' && *p != '\n')
+                p++;
+            if (*p != ' ')
+            {
+                pending = 1;
+                continue;
+            }
+        }
+        pending = 0;
+
+        char* end;
+        uint32_t addr = strtoul(p, &end, 16);
+        if (end == p)
+            continue;
+        p = end;
+        uint32_t size = strtoul(p, &end, 16);
+        if (end == p)
+            continue;
+        p = end;
+        while (*p == ' ' || *p == '\t')
+            p++;
+        size_t len = strcspn(p, "\r\n");
+        if (size == 0 || len == 0)
+            continue;
+
+        // basename of the archive (or object) path, keeping "(member)"
+        const char* paren = memchr(p, '(', len);
+        const char* base = p;
+        for (const char* q = p; q < (paren ? paren : p + len); q++)
+        {
+            if (*q == '/')
+                base = q + 1;
+        }
+        len -= base - p;
+
+        if (rep->numRanges == rep->maxRanges)
+        {
+            rep->maxRanges = rep->maxRanges ? rep->maxRanges * 2 : 256;
+            rep->ranges = realloc(rep->ranges, rep->maxRanges * sizeof(struct MapRange));
+        }
+        rep->ranges[rep->numRanges].addr = addr;
+        rep->ranges[rep->numRanges].size = size;
+        rep->ranges[rep->numRanges].object = sizeObject(rep, base, len);
+        rep->numRanges++;
+    }
+    fclose(f);
+
+    qsort(rep->ranges, rep->numRanges, sizeof(struct MapRange), mapRangeCmp);
+    return 0;
+}
+
+// Object of the map input section containing addr, or -1
+static int sizeMapLookup(const struct SizeReport* rep, uint32_t addr)
+{
+    int lo = 0;
+    int hi = rep->numRanges;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (rep->ranges[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo > 0 && addr - rep->ranges[lo - 1].addr < rep->ranges[lo - 1].size)
+        return rep->ranges[lo - 1].object;
+    return -1;
+}
+
+static int sizeSymAddrCmp(const void* a, const void* b)
+{
+    const struct SizeSym* sa = a;
+    const struct SizeSym* sb = b;
+    if (sa->region != sb->region)
+        return sa->region - sb->region;
+    if (sa->addr != sb->addr)
+        return sa->addr < sb->addr ? -1 : 1;
+    // larger first, so aliases and labels inside a sized symbol come after it
+    if (sa->size != sb->size)
+        return sa->size > sb->size ? -1 : 1;
+    return 0;
+}
+
+static int sizeSymBytesCmp(const void* a, const void* b)
+{
+    const struct SizeSym* sa = a;
+    const struct SizeSym* sb = b;
+    if (sa->bytes != sb->bytes)
+        return sa->bytes > sb->bytes ? -1 : 1;
+    return strcmp(sa->name, sb->name);
+}
+
+static uint32_t sizeObjTotal(const struct SizeObj* o)
+{
+    return o->bytes[0] + o->bytes[1] + o->bytes[2];
+}
+
+static int sizeObjCmp(const void* a, const void* b)
+{
+    uint32_t ta = sizeObjTotal(a);
+    uint32_t tb = sizeObjTotal(b);
+    if (ta != tb)
+        return ta > tb ? -1 : 1;
+    return strcmp(((const struct SizeObj*)a)->name, ((const struct SizeObj*)b)->name);
+}
+
+static void jsonString(FILE* f, const char* s)
+{
+    fputc('"', f);
+    for (; *s; s++)
+    {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static int sizeWriteJson(const struct SizeReport* rep, const char* inFile, const char* path,
+                         FILE* log)
+{
+    FILE* f = fopen(path, "w");
+    if (!f)
+    {
+        fprintf(log, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    fprintf(f, "{\n  \"file\": ");
+    jsonString(f, inFile);
+    fprintf(f, ",\n  \"objectSource\": \"%s\",\n", rep->numRanges ? "map" : "symtab");
+    fprintf(f, "  \"sections\": { \"text\": %u, \"data\": %u, \"bss\": %u },\n",
+            rep->regionSize[0], rep->regionSize[1], rep->regionSize[2]);
+    fprintf(f, "  \"fill\": { \"text\": %u, \"data\": %u, \"bss\": %u },\n",
+            rep->fill[0], rep->fill[1], rep->fill[2]);
+
+    fprintf(f, "  \"objects\": [\n");
+    for (int i = 0; i < rep->numObjs; i++)
+    {
+        const struct SizeObj* o = &rep->objs[i];
+        fprintf(f, "    { \"name\": ");
+        jsonString(f, o->name);
+        fprintf(f, ", \"text\": %u, \"data\": %u, \"bss\": %u }%s\n",
+                o->bytes[0], o->bytes[1], o->bytes[2], i + 1 < rep->numObjs ? "," : "");
+    }
+    fprintf(f, "  ],\n");
+
+    fprintf(f, "  \"symbols\": [\n");
+    for (int i = 0; i < rep->numSyms; i++)
+    {
+        const struct SizeSym* s = &rep->syms[i];
+        fprintf(f, "    { \"name\": ");
+        jsonString(f, s->name);
+        fprintf(f, ", \"section\": \"%s\", \"addr\": %u, \"size\": %u, \"object\": ",
+                sizeRegionName[s->region], s->addr, s->bytes);
+        if (s->object >= 0)
+            jsonString(f, rep->objs[s->object].name);
+        else
+            fprintf(f, "null");
+        fprintf(f, " }%s\n", i + 1 < rep->numSyms ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+
+    if (fclose(f) != 0)
+    {
+        fprintf(log, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static void sizePrint(const struct SizeReport* rep, FILE* log)
+{
+    fprintf(log, "Size report: text %u, data %u, bss %u bytes (objects from %s)\n",
+            rep->regionSize[0], rep->regionSize[1], rep->regionSize[2],
+            rep->numRanges ? "ld map" : "symbol table, approximate");
+
+    fprintf(log, "    text    data     bss   total  object\n");
+    for (int i = 0; i < rep->numObjs; i++)
+    {
+        const struct SizeObj* o = &rep->objs[i];
+        fprintf(log, "  %6u  %6u  %6u  %6u  %s\n", o->bytes[0], o->bytes[1], o->bytes[2],
+                sizeObjTotal(o), o->name);
+    }
+    fprintf(log, "  %6u  %6u  %6u  %6u  (fill)\n", rep->fill[0], rep->fill[1], rep->fill[2],
+            rep->fill[0] + rep->fill[1] + rep->fill[2]);
+
+    fprintf(log, "    size  sec   address  symbol\n");
+    for (int i = 0; i < rep->numSyms; i++)
+    {
+        const struct SizeSym* s = &rep->syms[i];
+        fprintf(log, "  %6u  %-4s  %08x  %s", s->bytes, sizeRegionName[s->region], s->addr, s->name);
+        if (s->object >= 0)
+            fprintf(log, "  [%s]", rep->objs[s->object].name);
+        fprintf(log, "\n");
+    }
+}
+
+// Build the report from the ELF symbol table; regionStart/regionEnd are the
+// text, data and bss address ranges. Writes JSON to jsonPath and the table
+// to log.
+static int sizeReport(const uint8_t* elf, size_t fileSize, const uint8_t* shdrs,
+                      uint16_t shentsize, uint16_t shnum, const int* sectionType,
+                      const uint32_t* regionStart, const uint32_t* regionEnd,
+                      const char* mapFile, const char* inFile, const char* jsonPath, FILE* log)
+{
+    struct SizeReport rep;
+    memset(&rep, 0, sizeof(rep));
+    rep.lastObj = -1;
+    int rc = -1;
+
+    if (mapFile && sizeReadMap(&rep, mapFile, log) < 0)
+        goto out;
+
+    for (int r = 0; r < 3; r++)
+        rep.regionSize[r] = regionEnd[r] > regionStart[r] ? regionEnd[r] - regionStart[r] : 0;
+
+    const Elf32_Shdr* symtabSh = NULL;
+    for (int i = 0; i < shnum; i++)
+    {
+        const Elf32_Shdr* sh = (const Elf32_Shdr*)(shdrs + i * shentsize);
+        if (read_be32(&sh->sh_type) == SHT_SYMTAB)
+        {
+            symtabSh = sh;
+            break;
+        }
+    }
+
+    if (symtabSh)
+    {
+        uint32_t numElfSyms = symCount(symtabSh, fileSize);
+        uint32_t symEntSize = read_be32(&symtabSh->sh_entsize);
+        if (symEntSize == 0)
+            symEntSize = sizeof(Elf32_Sym);
+        uint32_t firstGlobal = read_be32(&symtabSh->sh_info);
+        uint32_t strLink = read_be32(&symtabSh->sh_link);
+        const char* strtab = NULL;
+        uint32_t strSize = 0;
+        if (strLink >= shnum)
+            numElfSyms = 0;
+        else
+        {
+            const Elf32_Shdr* strSh = (const Elf32_Shdr*)(shdrs + strLink * shentsize);
+            strtab = (const char*)(elf + read_be32(&strSh->sh_offset));
+            strSize = read_be32(&strSh->sh_size);
+            if ((size_t)read_be32(&strSh->sh_offset) + strSize > fileSize)
+                strSize = 0;
+        }
+
+        rep.syms = malloc((numElfSyms ? numElfSyms : 1) * sizeof(struct SizeSym));
+        int fileObj = -1;
+        const uint8_t* sp = elf + read_be32(&symtabSh->sh_offset);
+        for (uint32_t i = 0; i < numElfSyms; i++, sp += symEntSize)
+        {
+            const Elf32_Sym* sym = (const Elf32_Sym*)sp;
+            uint32_t nameIdx = read_be32(&sym->st_name);
+            uint16_t shndx = read_be16(&sym->st_shndx);
+            int type = ELF32_ST_TYPE(sym->st_info);
+            const char* name = nameIdx < strSize ? strtab + nameIdx : "";
+
+            if (type == STT_FILE)
+            {
+                fileObj = name[0] ? sizeObject(&rep, name, strlen(name)) : -1;
+                continue;
+            }
+            if (type == STT_SECTION || name[0] == '\0' || shndx == SHN_UNDEF ||
+                shndx >= shnum || sectionType[shndx] == 0)
+                continue;
+
+            struct SizeSym* s = &rep.syms[rep.numSyms++];
+            s->name = name;
+            s->addr = read_be32(&sym->st_value);
+            s->size = read_be32(&sym->st_size);
+            s->bytes = 0;
+            s->region = sectionType[shndx] - 1;
+            if (rep.numRanges)
+                s->object = sizeMapLookup(&rep, s->addr);
+            else
+                s->object = i < firstGlobal ? fileObj : -1;
+        }
+    }
+
+    // Walk each region in address order, handing out bytes to symbols
+    qsort(rep.syms, rep.numSyms, sizeof(struct SizeSym), sizeSymAddrCmp);
+    for (int i = 0; i < rep.numSyms; )
+    {
+        int r = rep.syms[i].region;
+        uint32_t cursor = regionStart[r];
+        int prevObj = -1;
+
+        for (; i < rep.numSyms && rep.syms[i].region == r; i++)
+        {
+            struct SizeSym* s = &rep.syms[i];
+            uint32_t end;
+            if (s->size)
+                end = s->addr + s->size;
+            else
+            {
+                // up to the next symbol at a higher address
+                int j = i + 1;
+                while (j < rep.numSyms && rep.syms[j].region == r && rep.syms[j].addr == s->addr)
+                    j++;
+                end = (j < rep.numSyms && rep.syms[j].region == r) ? rep.syms[j].addr : regionEnd[r];
+            }
+            if (end > regionEnd[r])
+                end = regionEnd[r];
+
+            uint32_t start = s->addr > cursor ? s->addr : cursor;
+            if (start > cursor)
+                rep.fill[r] += start - cursor;
+            if (end > start)
+            {
+                s->bytes = end - start;
+                cursor = end;
+            }
+
+            if (s->object < 0 && !rep.numRanges)
+                s->object = prevObj >= 0 ? prevObj : sizeObject(&rep, "(unknown)", 9);
+            prevObj = s->object;
+        }
+        if (regionEnd[r] > cursor)
+            rep.fill[r] += regionEnd[r] - cursor;
+    }
+
+    // Regions without any symbol are fill as a whole
+    for (int r = 0; r < 3; r++)
+    {
+        int any = 0;
+        for (int i = 0; i < rep.numSyms && !any; i++)
+            any = rep.syms[i].region == r;
+        if (!any)
+            rep.fill[r] = rep.regionSize[r];
+    }
+
+    // Object totals: straight from the map's input sections when available,
+    // otherwise the sum of their symbols
+    if (rep.numRanges)
+    {
+        uint32_t covered[3] = { 0, 0, 0 };
+        for (int i = 0; i < rep.numRanges; i++)
+        {
+            const struct MapRange* m = &rep.ranges[i];
+            for (int r = 0; r < 3; r++)
+            {
+                if (m->addr >= regionStart[r] && m->addr < regionEnd[r])
+                {
+                    uint32_t n = m->size;
+                    if (n > regionEnd[r] - m->addr)
+                        n = regionEnd[r] - m->addr;
+                    rep.objs[m->object].bytes[r] += n;
+                    covered[r] += n;
+                    break;
+                }
+            }
+        }
+        for (int r = 0; r < 3; r++)
+            rep.fill[r] = rep.regionSize[r] > covered[r] ? rep.regionSize[r] - covered[r] : 0;
+    }
+    else
+    {
+        for (int i = 0; i < rep.numSyms; i++)
+        {
+            rep.objs[rep.syms[i].object].bytes[rep.syms[i].region] += rep.syms[i].bytes;
+        }
+    }
+
+    // Sort for output: objects and symbols by size, dropping empty entries.
+    // Symbols refer to objects by index, so renumber them after the sort.
+    for (int i = 0; i < rep.numObjs; i++)
+        rep.objs[i].index = i;
+    qsort(rep.objs, rep.numObjs, sizeof(struct SizeObj), sizeObjCmp);
+    int* objMap = calloc(rep.numObjs + 1, sizeof(int));
+    for (int i = 0; i < rep.numObjs; i++)
+        objMap[rep.objs[i].index] = i;
+    for (int i = 0; i < rep.numSyms; i++)
+    {
+        if (rep.syms[i].object >= 0)
+            rep.syms[i].object = objMap[rep.syms[i].object];
+    }
+    free(objMap);
+    while (rep.numObjs > 0 && sizeObjTotal(&rep.objs[rep.numObjs - 1]) == 0)
+        free(rep.objs[--rep.numObjs].name);
+
+    qsort(rep.syms, rep.numSyms, sizeof(struct SizeSym), sizeSymBytesCmp);
+    while (rep.numSyms > 0 && rep.syms[rep.numSyms - 1].bytes == 0)
+        rep.numSyms--;
+
+    sizePrint(&rep, log);
+    rc = sizeWriteJson(&rep, inFile, jsonPath, log);
+
+out:
+    for (int i = 0; i < rep.numObjs; i++)
+        free(rep.objs[i].name);
+    free(rep.objs);
+    free(rep.ranges);
+    free(rep.syms);
+    return rc;
+}
+
+// ---------------------------------------------------------------------------
+// Compressed output: self-unpacking X-file
+// ---------------------------------------------------------------------------
+//
+// With --compress the X-file holds a small position-independent unpacker
+// followed by an LZ-packed copy of text+data and the relocation table. The
+// outer header declares the unpacker as text (entry 0) and enough bss to
+// unpack in place. At run time the unpacker
+//
+//   1. saves the registers Human68k passes to the program (a0-a4, ...),
+//   2. copies its tail to the top of the block and continues there,
+//   3. moves the packed data up so that unpacking never overtakes it,
+//   4. unpacks image and relocation table to the load address,
+//   5. applies the relocations and clears bss,
+//   6. flushes the caches on 68020 and later (IOCS _SYS_STAT),
+//   7. restores the registers with a1 = real program end and jumps to
+//      the real entry point.
+//
+// Packed format: a flag byte before every 8 items, MSB first. Flag 0 is a
+// literal byte, flag 1 a match copied from the already unpacked data:
+//   0LLLOOOO OOOOOOOO           length L+2 (3..9), offset O+1 (1..4096)
+//   1LLLLLLL OOOOOOOO OOOOOOOO  length L+3 (3..130), offset O+1 (1..65536)
+//
+// Unpacker source (offsets from the start of the stub):
+//
+// head:   movem.l d0-d7/a0-a6,-(sp)
+//         lea     head(pc),a6             ; a6 = load address
+//         lea     tail(pc),a0
+//         move.l  pTail(pc),d0
+//         lea     0(a6,d0.l),a1
+//         move.w  #(end-tail)/2-1,d1
+// .copy:  move.w  (a0)+,(a1)+
+//         dbra    d1,.copy
+//         bsr.w   flush
+//         move.l  pTail(pc),d0
+//         jmp     0(a6,d0.l)
+// tail:   movea.l a6,a0
+//         adda.l  pSrcEnd(pc),a0
+//         movea.l a6,a1
+//         adda.l  pDstEnd(pc),a1
+//         move.l  pPacked(pc),d0          ; in longs
+// .move:  move.l  -(a0),-(a1)
+//         subq.l  #1,d0
+//         bne.s   .move
+//         movea.l a1,a0                   ; a0 = packed data
+//         movea.l a6,a1                   ; a1 = output
+//         movea.l a6,a2
+//         adda.l  pUnpacked(pc),a2        ; a2 = output end
+//         moveq   #0,d6
+// .next:  cmpa.l  a2,a1
+//         bcc.s   .relocs
+//         subq.w  #1,d6
+//         bpl.s   .bit
+//         move.b  (a0)+,d7
+//         moveq   #7,d6
+// .bit:   add.b   d7,d7
+//         bcs.s   .match
+//         move.b  (a0)+,(a1)+
+//         bra.s   .next
+// .match: moveq   #0,d0
+//         move.b  (a0)+,d0
+//         bmi.s   .long
+//         move.w  d0,d1
+//         lsr.w   #4,d1
+//         addq.w  #1,d1
+//         andi.w  #$0f,d0
+//         lsl.w   #8,d0
+//         move.b  (a0)+,d0
+//         bra.s   .copy
+// .long:  moveq   #$7f,d1
+//         and.w   d0,d1
+//         addq.w  #2,d1
+//         moveq   #0,d0
+//         move.b  (a0)+,d0
+//         lsl.w   #8,d0
+//         move.b  (a0)+,d0
+// .copy:  movea.l a1,a3
+//         suba.l  d0,a3
+//         subq.l  #1,a3
+// .cp:    move.b  (a3)+,(a1)+
+//         dbra    d1,.cp
+//         bra.s   .next
+// .relocs:movea.l a6,a0
+//         adda.l  pRelocs(pc),a0
+//         movea.l a6,a1
+//         move.l  a6,d2
+// .rnext: cmpa.l  a2,a0
+//         bcc.s   .bss
+//         moveq   #0,d0
+//         move.w  (a0)+,d0
+//         cmpi.w  #1,d0
+//         bne.s   .rfix
+//         move.l  (a0)+,d0
+// .rfix:  adda.l  d0,a1
+//         add.l   d2,(a1)
+//         bra.s   .rnext
+// .bss:   movea.l a6,a1
+//         adda.l  pImage(pc),a1
+//         move.l  a1,d0
+//         btst    #0,d0
+//         beq.s   .even
+//         clr.b   (a1)+
+// .even:  move.l  pBss(pc),d0             ; in longs
+//         beq.s   .done
+// .zero:  clr.l   (a1)+
+//         subq.l  #1,d0
+//         bne.s   .zero
+// .done:  bsr.s   flush
+//         movea.l a6,a0
+//         adda.l  pEnd(pc),a0
+//         move.l  a0,36(sp)               ; saved a1
+//         movea.l a6,a0
+//         adda.l  pEntry(pc),a0
+//         move.l  a0,48(sp)               ; saved a4
+//         movem.l (sp)+,d0-d7/a0-a6
+//         jmp     (a4)
+// flush:  movem.l d0-d1/a0-a1,-(sp)
+//         moveq   #1,d0
+//         lea     0(pc,d0.w*2),a0         ; the 68000 ignores the scale
+//         lea     -3(pc),a1
+//         cmpa.l  a0,a1
+//         beq.s   .ret                    ; 68000/68010: no caches
+//         move.l  #_SYS_STAT,d0
+//         moveq   #3,d1                   ; flush caches
+//         trap    #15
+// .ret:   movem.l (sp)+,d0-d1/a0-a1
+//         rts
+// pTail ... pEntry:  10 longs patched by elf2x68k
+// end:
+#define STUB_SIZE        308
+#define STUB_TAIL        42      // offset of tail
+#define STUB_P_TAIL      268     // where the tail runs, from the load address
+#define STUB_P_SRC_END   272     // end of the packed data as loaded
+#define STUB_P_DST_END   276     // end of the packed data after the move
+#define STUB_P_PACKED    280     // packed size in longs
+#define STUB_P_UNPACKED  284     // unpacked size (image + relocation table)
+#define STUB_P_RELOCS    288     // offset of the relocation table
+#define STUB_P_IMAGE     292     // text+data size, start of bss
+#define STUB_P_BSS       296     // longs to clear from the even start of bss
+#define STUB_P_END       300     // end of bss, passed on in a1
+#define STUB_P_ENTRY     304     // real entry point
+
+static const uint8_t unpackStub[STUB_SIZE] =
+{
+    0x48, 0xe7, 0xff, 0xfe, 0x4d, 0xfa, 0xff, 0xfa, 0x41, 0xfa, 0x00, 0x20, 0x20, 0x3a, 0x00, 0xfe,
+    0x43, 0xf6, 0x08, 0x00, 0x32, 0x3c, 0x00, 0x84, 0x32, 0xd8, 0x51, 0xc9, 0xff, 0xfc, 0x61, 0x00,
+    0x00, 0xca, 0x20, 0x3a, 0x00, 0xe8, 0x4e, 0xf6, 0x08, 0x00, 0x20, 0x4e, 0xd1, 0xfa, 0x00, 0xe2,
+    0x22, 0x4e, 0xd3, 0xfa, 0x00, 0xe0, 0x20, 0x3a, 0x00, 0xe0, 0x23, 0x20, 0x53, 0x80, 0x66, 0xfa,
+    0x20, 0x49, 0x22, 0x4e, 0x24, 0x4e, 0xd5, 0xfa, 0x00, 0xd4, 0x7c, 0x00, 0xb3, 0xca, 0x64, 0x42,
+    0x53, 0x46, 0x6a, 0x04, 0x1e, 0x18, 0x7c, 0x07, 0xde, 0x07, 0x65, 0x04, 0x12, 0xd8, 0x60, 0xec,
+    0x70, 0x00, 0x10, 0x18, 0x6b, 0x10, 0x32, 0x00, 0xe8, 0x49, 0x52, 0x41, 0x02, 0x40, 0x00, 0x0f,
+    0xe1, 0x48, 0x10, 0x18, 0x60, 0x0e, 0x72, 0x7f, 0xc2, 0x40, 0x54, 0x41, 0x70, 0x00, 0x10, 0x18,
+    0xe1, 0x48, 0x10, 0x18, 0x26, 0x49, 0x97, 0xc0, 0x53, 0x8b, 0x12, 0xdb, 0x51, 0xc9, 0xff, 0xfc,
+    0x60, 0xba, 0x20, 0x4e, 0xd1, 0xfa, 0x00, 0x8a, 0x22, 0x4e, 0x24, 0x0e, 0xb1, 0xca, 0x64, 0x12,
+    0x70, 0x00, 0x30, 0x18, 0x0c, 0x40, 0x00, 0x01, 0x66, 0x02, 0x20, 0x18, 0xd3, 0xc0, 0xd5, 0x91,
+    0x60, 0xea, 0x22, 0x4e, 0xd3, 0xfa, 0x00, 0x6e, 0x20, 0x09, 0x08, 0x00, 0x00, 0x00, 0x67, 0x02,
+    0x42, 0x19, 0x20, 0x3a, 0x00, 0x64, 0x67, 0x06, 0x42, 0x99, 0x53, 0x80, 0x66, 0xfa, 0x61, 0x1a,
+    0x20, 0x4e, 0xd1, 0xfa, 0x00, 0x58, 0x2f, 0x48, 0x00, 0x24, 0x20, 0x4e, 0xd1, 0xfa, 0x00, 0x52,
+    0x2f, 0x48, 0x00, 0x30, 0x4c, 0xdf, 0x7f, 0xff, 0x4e, 0xd4, 0x48, 0xe7, 0xc0, 0xc0, 0x70, 0x01,
+    0x41, 0xfb, 0x02, 0x00, 0x43, 0xfa, 0xff, 0xfd, 0xb3, 0xc8, 0x67, 0x0a, 0x20, 0x3c, 0x00, 0x00,
+    0x00, 0xac, 0x72, 0x03, 0x4e, 0x4f, 0x4c, 0xdf, 0x03, 0x03, 0x4e, 0x75,
+};
+
+#define LZ_WINDOW       65536
+#define LZ_SHORT_WINDOW 4096
+#define LZ_MIN          3
+#define LZ_SHORT_MAX    9
+#define LZ_MAX          130
+#define LZ_HASH_BITS    15
+#define LZ_CHAIN        256     // candidates tried per position
+
+struct LzStats
+{
+    uint32_t literals;
+    uint32_t matches;
+    uint32_t matchBytes;
+    uint32_t flags;
+    uint32_t margin;    // unpacked minus packed position, worst case
+};
+
+static uint32_t lzHash(const uint8_t* p)
+{
+    uint32_t v = (p[0] << 16) | (p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Bytes saved by encoding a match instead of literals
+static int lzGain(uint32_t len, uint32_t off)
+{
+    int gain = (int)len - 3;
+    if (off <= LZ_SHORT_WINDOW)
+    {
+        int shortLen = len < LZ_SHORT_MAX ? (int)len : LZ_SHORT_MAX;
+        if (shortLen - 2 > gain)
+            gain = shortLen - 2;
+    }
+    return gain;
+}
+
+// Longest useful match for src[pos] within the window, via hash chains
+static int lzFind(const uint8_t* src, uint32_t len, uint32_t pos, const int32_t* head,
+                  const int32_t* prev, uint32_t* bestLen, uint32_t* bestOff)
+{
+    uint32_t maxLen = len - pos < LZ_MAX ? len - pos : LZ_MAX;
+    int bestGain = 0;
+
+    *bestLen = 0;
+    if (maxLen < LZ_MIN)
+        return 0;
+
+    int32_t cand = head[lzHash(src + pos)];
+    for (int depth = 0; cand >= 0 && pos - cand <= LZ_WINDOW && depth < LZ_CHAIN; depth++)
+    {
+        uint32_t n = 0;
+        while (n < maxLen && src[cand + n] == src[pos + n])
+            n++;
+
+        int gain = lzGain(n, pos - cand);
+        if (n >= LZ_MIN && gain > bestGain)
+        {
+            bestGain = gain;
+            *bestLen = n;
+            *bestOff = pos - cand;
+            if (n == maxLen)
+                break;
+        }
+        cand = prev[cand];
+    }
+    return bestGain;
+}
+
+// Pack src into dst (at least len + len / 8 + 1 bytes). Returns the packed
+// size, or 0 when out of memory.
+static uint32_t lzPack(const uint8_t* src, uint32_t len, uint8_t* dst, struct LzStats* st)
+{
+    int32_t* head = malloc((1 << LZ_HASH_BITS) * sizeof(int32_t));
+    int32_t* prev = malloc((len ? len : 1) * sizeof(int32_t));
+    if (!head || !prev)
+    {
+        free(head);
+        free(prev);
+        return 0;
+    }
+    memset(head, 0xff, (1 << LZ_HASH_BITS) * sizeof(int32_t));
+    memset(st, 0, sizeof(*st));
+
+    uint32_t out = 0;
+    uint32_t flagPos = 0;
+    int flagBits = 8;
+    uint32_t pos = 0;
+    uint32_t hashed = 0;
+
+    while (pos < len)
+    {
+        // Keep the hash chains up to date for every position before pos
+        for (; hashed < pos && hashed + LZ_MIN <= len; hashed++)
+        {
+            uint32_t h = lzHash(src + hashed);
+            prev[hashed] = head[h];
+            head[h] = hashed;
+        }
+
+        uint32_t mlen, moff;
+        int gain = lzFind(src, len, pos, head, prev, &mlen, &moff);
+
+        // Lazy evaluation: prefer a literal if the next position does better
+        if (gain > 0 && pos + 1 < len)
+        {
+            if (hashed == pos && hashed + LZ_MIN <= len)
+            {
+                uint32_t h = lzHash(src + hashed);
+                prev[hashed] = head[h];
+                head[h] = hashed;
+                hashed++;
+            }
+            uint32_t nlen, noff;
+            if (lzFind(src, len, pos + 1, head, prev, &nlen, &noff) > gain)
+                gain = 0;
+        }
+
+        if (flagBits == 8)
+        {
+            flagPos = out++;
+            dst[flagPos] = 0;
+            flagBits = 0;
+            st->flags++;
+        }
+
+        if (gain > 0)
+        {
+            dst[flagPos] |= 0x80 >> flagBits;
+            if (moff <= LZ_SHORT_WINDOW && mlen <= LZ_SHORT_MAX)
+            {
+                dst[out++] = ((mlen - 2) << 4) | ((moff - 1) >> 8);
+                dst[out++] = (moff - 1) & 0xff;
+            }
+            else
+            {
+                dst[out++] = 0x80 | (mlen - 3);
+                dst[out++] = ((moff - 1) >> 8) & 0xff;
+                dst[out++] = (moff - 1) & 0xff;
+            }
+            st->matches++;
+            st->matchBytes += mlen;
+            pos += mlen;
+        }
+        else
+        {
+            dst[out++] = src[pos++];
+            st->literals++;
+        }
+        flagBits++;
+
+        if (pos > out && pos - out > st->margin)
+            st->margin = pos - out;
+    }
+
+    free(head);
+    free(prev);
+    return out;
+}
+
+// Approximate 68000 clock cycles of the unpacker loops
+#define CYC_LITERAL     62
+#define CYC_FLAG        10
+#define CYC_MATCH       176
+#define CYC_MATCH_BYTE  22
+#define CYC_RELOC       82
+#define CYC_MOVE_LONG   40
+#define CYC_CLEAR_LONG  38
+
+struct PackInfo
+{
+    uint32_t unpacked;      // image + relocation table
+    uint32_t packed;
+    uint32_t textSize;      // unpacker + packed data, as declared in the header
+    uint32_t bssSize;       // bss of the outer header
+    uint32_t cycles;        // estimated unpack time
+    struct LzStats lz;
 };
 
-// Relocation entry
-struct Reloc
+static void putBe32(uint8_t* p, uint32_t v)
 {
-    uint32_t offset;    // absolute offset in image (text_base=0)
-};
+    v = be32(v);
+    memcpy(p, &v, 4);
+}
 
-static int relocCmp(const void* a, const void* b)
+// Build the text segment of a self-unpacking X-file: unpacker, then the
+// packed image and relocation table. Returns the buffer (info->textSize
+// bytes), or NULL when out of memory.
+static uint8_t* packImage(const struct SectionInfo* secs, int numSecs, const uint8_t* elf,
+                          uint32_t imageSize, uint32_t bssSize, uint32_t entryPoint,
+                          const struct Reloc* relocs, int numRelocs, int skipDropped,
+                          uint32_t relBufSize, struct PackInfo* info)
 {
-    const struct Reloc* ra = a;
-    const struct Reloc* rb = b;
-    if (ra->offset < rb->offset)
-        return -1;
-    if (ra->offset > rb->offset)
-        return 1;
-    return 0;
+    // The relocation table is read by words, so it starts at an even offset
+    uint32_t relStart = (imageSize + 1) & ~1u;
+    uint32_t unpackedSize = relStart + relBufSize;
+    uint8_t* unpacked = calloc(unpackedSize ? unpackedSize : 1, 1);
+    uint8_t* buf = malloc(STUB_SIZE + unpackedSize + unpackedSize / 8 + 4);
+    if (!unpacked || !buf)
+        goto fail;
+
+    for (int i = 0; i < numSecs; i++)
+        memcpy(unpacked + secs[i].imgOffset, elf + secs[i].offset, secs[i].size);
+    struct OutBuf relOut = { -1, unpacked + relStart, 0, relBufSize };
+    relocEncode(relocs, numRelocs, skipDropped, &relOut, NULL, NULL, NULL);
+
+    uint32_t packed = lzPack(unpacked, unpackedSize, buf + STUB_SIZE, &info->lz);
+    if (packed == 0)
+        goto fail;
+    free(unpacked);
+    unpacked = NULL;
+
+    // Memory layout from the load address: the packed data (padded to
+    // longs for the move) goes up far enough that unpacking never
+    // overwrites unread input, and the tail of the unpacker runs above
+    // everything it writes. bss is cleared in longs from an even address,
+    // which may run up to 3 bytes past its end.
+    uint32_t packedLongs = (packed + 3) / 4;
+    memset(buf + STUB_SIZE + packed, 0, packedLongs * 4 - packed);
+    uint32_t srcEnd = STUB_SIZE + packedLongs * 4;
+    uint32_t dst = info->lz.margin > STUB_SIZE ? info->lz.margin : STUB_SIZE;
+    dst = (dst + 1) & ~1u;
+    uint32_t bssStart = (imageSize + 1) & ~1u;
+    uint32_t bssLongs = imageSize + bssSize > bssStart ? (imageSize + bssSize - bssStart + 3) / 4 : 0;
+
+    uint32_t tail = dst + packedLongs * 4;
+    if (tail < unpackedSize)
+        tail = unpackedSize;
+    if (tail < bssStart + bssLongs * 4)
+        tail = bssStart + bssLongs * 4;
+
+    memcpy(buf, unpackStub, STUB_SIZE);
+    putBe32(buf + STUB_P_TAIL, tail);
+    putBe32(buf + STUB_P_SRC_END, srcEnd);
+    putBe32(buf + STUB_P_DST_END, dst + packedLongs * 4);
+    putBe32(buf + STUB_P_PACKED, packedLongs);
+    putBe32(buf + STUB_P_UNPACKED, unpackedSize);
+    putBe32(buf + STUB_P_RELOCS, relStart);
+    putBe32(buf + STUB_P_IMAGE, imageSize);
+    putBe32(buf + STUB_P_BSS, bssLongs);
+    putBe32(buf + STUB_P_END, imageSize + bssSize);
+    putBe32(buf + STUB_P_ENTRY, entryPoint);
+
+    uint32_t textSize = srcEnd;
+    uint32_t memSize = tail + STUB_SIZE - STUB_TAIL;
+
+    info->unpacked = unpackedSize;
+    info->packed = packed;
+    info->textSize = textSize;
+    info->bssSize = memSize > textSize ? memSize - textSize : 0;
+    info->cycles = info->lz.literals * CYC_LITERAL + info->lz.flags * CYC_FLAG +
+                   info->lz.matches * CYC_MATCH + info->lz.matchBytes * CYC_MATCH_BYTE +
+                   relBufSize / 2 * CYC_RELOC + packedLongs * CYC_MOVE_LONG +
+                   bssLongs * CYC_CLEAR_LONG;
+    return buf;
+
+fail:
+    free(unpacked);
+    free(buf);
+    return NULL;
+}
+
+static void packReport(FILE* log, const struct PackInfo* info, uint32_t plainSize)
+{
+    fprintf(log, "Compression summary:\n");
+    fprintf(log, "  text+data+relocs:       %6u -> %6u bytes (%u%%)\n",
+            info->unpacked, info->packed,
+            info->unpacked ? (unsigned)((uint64_t)info->packed * 100 / info->unpacked) : 0);
+    fprintf(log, "  literals/matches:       %6u / %u (%u bytes matched)\n",
+            info->lz.literals, info->lz.matches, info->lz.matchBytes);
+    fprintf(log, "  unpacker:               %6d bytes\n", STUB_SIZE);
+    fprintf(log, "  loaded from file:       %6u -> %6u bytes\n", plainSize, info->textSize);
+    fprintf(log, "  estimated unpack time:  %6u ms at 10 MHz\n", (info->cycles + 9999) / 10000);
 }
 
 // Symbol entry for X-file
@@ -150,6 +1563,7 @@ struct XSym
     uint8_t section;    // X_SEC_TEXT, X_SEC_DATA, X_SEC_BSS
     uint32_t value;     // absolute position
     const char* name;
+    uint32_t nameLen;
 };
 
 static int xsymCmp(const void* a, const void* b)
@@ -166,80 +1580,67 @@ static int xsymCmp(const void* a, const void* b)
     return 0;
 }
 
-int main(int argc, char* argv[])
+// Conversion options shared by every file of a run
+struct Options
 {
-    if (argc < 3)
-    {
-        fprintf(stderr, "Usage: %s [-s] input.elf output.x\n", argv[0]);
-        fprintf(stderr, "  -s  Include symbol table\n");
-        return 1;
-    }
-
-    int includeSymbols = 0;
-    int argIdx = 1;
-
-    while (argIdx < argc && argv[argIdx][0] == '-')
-    {
-        if (strcmp(argv[argIdx], "-s") == 0)
-            includeSymbols = 1;
-        else
-        {
-            fprintf(stderr, "Unknown option: %s\n", argv[argIdx]);
-            return 1;
-        }
-        argIdx++;
-    }
-
-    if (argc - argIdx < 2)
-    {
-        fprintf(stderr, "Usage: %s [-s] input.elf output.x\n", argv[0]);
-        return 1;
-    }
-
-    const char* inFile = argv[argIdx];
-    const char* outFile = argv[argIdx + 1];
+    int includeSymbols;
+    int verbose;
+    int optimizeRelocs;     // drop relocations the loader does not need
+    int compress;           // write a self-unpacking X-file
+    const char* sizeReport; // JSON size attribution output, or NULL
+    const char* mapFile;    // ld map file for object attribution, or NULL
+};
 
-    // Read entire input file
-    FILE* fin = fopen(inFile, "rb");
-    if (!fin)
-    {
-        perror(inFile);
+// Convert one ELF file to an X-file. Diagnostics go to log, progress
+// information only when opt->verbose is set. Returns 0 on success.
+static int convertFile(const struct Options* opt, const char* inFile, const char* outFile, FILE* log)
+{
+    struct InputFile in = { NULL, 0, 0 };
+    int* sectionType = NULL;
+    struct SectionInfo* loadSecs = NULL;
+    struct Reloc* relocs = NULL;
+    uint8_t** symClasses = NULL;
+    int numSymClasses = 0;
+    struct XSym* xsyms = NULL;
+    uint8_t* packBuf = NULL;
+    struct OutBuf ob = { -1, NULL, 0, 0 };
+    int fd = -1;
+    int created = 0;
+    int rc = 1;
+
+    // Map input file
+    if (inputOpen(inFile, &in, log) < 0)
         return 1;
-    }
 
-    fseek(fin, 0, SEEK_END);
-    long fileSize = ftell(fin);
-    fseek(fin, 0, SEEK_SET);
+    const uint8_t* elf = in.data;
+    size_t fileSize = in.size;
 
-    uint8_t* elf = malloc(fileSize);
-    if (fread(elf, 1, fileSize, fin) != (size_t)fileSize)
+    if (fileSize < sizeof(Elf32_Ehdr))
     {
-        fprintf(stderr, "Failed to read %s\n", inFile);
-        fclose(fin);
-        return 1;
+        fprintf(log, "Not an ELF file\n");
+        goto out;
     }
-    fclose(fin);
 
     // Validate ELF header
-    Elf32_Ehdr* ehdr = (Elf32_Ehdr*)elf;
+    const Elf32_Ehdr* ehdr = (const Elf32_Ehdr*)elf;
     if (ehdr->e_ident[0] != ELFMAG0 || ehdr->e_ident[1] != ELFMAG1 ||
         ehdr->e_ident[2] != ELFMAG2 || ehdr->e_ident[3] != ELFMAG3)
     {
-        fprintf(stderr, "Not an ELF file\n");
-        return 1;
+        fprintf(log, "Not an ELF file\n");
+        goto out;
     }
 
     if (ehdr->e_ident[4] != ELFCLASS32 || ehdr->e_ident[5] != ELFDATA2MSB)
     {
-        fprintf(stderr, "Not a 32-bit big-endian ELF\n");
-        return 1;
+        fprintf(log, "Not a 32-bit big-endian ELF\n");
+        goto out;
     }
 
     uint16_t machine = read_be16(&ehdr->e_machine);
     if (machine != EM_68K)
     {
-        fprintf(stderr, "Not an m68k ELF (machine=%u)\n", machine);
-        return 1;
+        fprintf(log, "Not an m68k ELF (machine=%u)\n", machine);
+        goto out;
     }
 
     uint32_t entryPoint = read_be32(&ehdr->e_entry);
@@ -250,13 +1651,19 @@ int main(int argc, char* argv[])
 
     if (shoff == 0 || shnum == 0)
     {
-        fprintf(stderr, "No section headers\n");
-        return 1;
+        fprintf(log, "No section headers\n");
+        goto out;
+    }
+
+    if (shoff + (size_t)shnum * shentsize > fileSize)
+    {
+        fprintf(log, "Section headers exceed file size\n");
+        goto out;
     }
 
     // Get section header string table
-    Elf32_Shdr* shdrs = (Elf32_Shdr*)(elf + shoff);
-    Elf32_Shdr* shstrtab_hdr = (Elf32_Shdr*)((uint8_t*)shdrs + shstrndx * shentsize);
+    const uint8_t* shdrs = elf + shoff;
+    const Elf32_Shdr* shstrtab_hdr = (const Elf32_Shdr*)(shdrs + shstrndx * shentsize);
     const char* shstrtab = (const char*)(elf + read_be32(&shstrtab_hdr->sh_offset));
 
     // We need to find the combined text and data regions.
@@ -273,11 +1680,11 @@ int main(int argc, char* argv[])
     uint32_t bssStart = 0xFFFFFFFF, bssEnd = 0;
 
     // Track which section indices belong to text vs data vs bss
-    int* sectionType = calloc(shnum, sizeof(int));  // 0=none, 1=text, 2=data, 3=bss
+    sectionType = calloc(shnum, sizeof(int));  // 0=none, 1=text, 2=data, 3=bss
 
     for (int i = 0; i < shnum; i++)
     {
-        Elf32_Shdr* sh = (Elf32_Shdr*)((uint8_t*)shdrs + i * shentsize);
+        const Elf32_Shdr* sh = (const Elf32_Shdr*)(shdrs + i * shentsize);
         uint32_t flags = read_be32(&sh->sh_flags);
         uint32_t type = read_be32(&sh->sh_type);
         uint32_t addr = read_be32(&sh->sh_addr);
@@ -317,28 +1724,43 @@ int main(int argc, char* argv[])
 
     if (textStart == 0xFFFFFFFF)
     {
-        fprintf(stderr, "No text section found\n");
-        return 1;
+        fprintf(log, "No text section found\n");
+        goto out;
     }
 
     uint32_t textSize = textEnd - textStart;
     uint32_t dataSize = (dataStart != 0xFFFFFFFF) ? (dataEnd - dataStart) : 0;
     uint32_t bssSize = (bssStart != 0xFFFFFFFF) ? (bssEnd - bssStart) : 0;
 
-    fprintf(stderr, "Text: 0x%08x - 0x%08x (%u bytes)\n", textStart, textEnd, textSize);
-    if (dataSize > 0)
-        fprintf(stderr, "Data: 0x%08x - 0x%08x (%u bytes)\n", dataStart, dataEnd, dataSize);
-    if (bssSize > 0)
-        fprintf(stderr, "BSS:  0x%08x - 0x%08x (%u bytes)\n", bssStart, bssEnd, bssSize);
-    fprintf(stderr, "Entry: 0x%08x\n", entryPoint);
+    if (opt->verbose)
+    {
+        fprintf(log, "Text: 0x%08x - 0x%08x (%u bytes)\n", textStart, textEnd, textSize);
+        if (dataSize > 0)
+            fprintf(log, "Data: 0x%08x - 0x%08x (%u bytes)\n", dataStart, dataEnd, dataSize);
+        if (bssSize > 0)
+            fprintf(log, "BSS:  0x%08x - 0x%08x (%u bytes)\n", bssStart, bssEnd, bssSize);
+        fprintf(log, "Entry: 0x%08x\n", entryPoint);
+    }
+
+    if (opt->sizeReport)
+    {
+        const uint32_t regionStart[3] = { textStart, dataStart, bssStart };
+        const uint32_t regionEnd[3] = { textEnd, dataEnd, bssEnd };
+        if (sizeReport(elf, fileSize, shdrs, shentsize, shnum, sectionType, regionStart,
+                       regionEnd, opt->mapFile, inFile, opt->sizeReport, log) < 0)
+            goto out;
+    }
 
-    // Build combined text+data image
+    // Lay out the combined text+data image. Section contents are not copied;
+    // the output is gathered straight from the input file, with zero fill
+    // for any alignment gaps between sections.
     uint32_t imageSize = textSize + dataSize;
-    uint8_t* image = calloc(1, imageSize);
+    loadSecs = malloc(shnum * sizeof(struct SectionInfo));
+    int numLoadSecs = 0;
 
     for (int i = 0; i < shnum; i++)
     {
-        Elf32_Shdr* sh = (Elf32_Shdr*)((uint8_t*)shdrs + i * shentsize);
+        const Elf32_Shdr* sh = (const Elf32_Shdr*)(shdrs + i * shentsize);
         uint32_t type = read_be32(&sh->sh_type);
 
         if (sectionType[i] == 0 || type == SHT_NOBITS)
@@ -357,21 +1779,56 @@ int main(int argc, char* argv[])
 
         if (imgOffset + size > imageSize)
         {
-            fprintf(stderr, "Section at 0x%x size 0x%x exceeds image\n", addr, size);
-            return 1;
+            fprintf(log, "Section at 0x%x size 0x%x exceeds image\n", addr, size);
+            goto out;
+        }
+
+        if ((size_t)offset + size > fileSize)
+        {
+            fprintf(log, "Section at 0x%x size 0x%x exceeds file size\n", addr, size);
+            goto out;
         }
 
-        memcpy(image + imgOffset, elf + offset, size);
+        loadSecs[numLoadSecs].offset = offset;
+        loadSecs[numLoadSecs].addr = addr;
+        loadSecs[numLoadSecs].size = size;
+        loadSecs[numLoadSecs].shndx = i;
+        loadSecs[numLoadSecs].imgOffset = imgOffset;
+        numLoadSecs++;
+    }
+
+    qsort(loadSecs, numLoadSecs, sizeof(struct SectionInfo), sectionCmp);
+
+    // Collect R_68K_32 relocations from all RELA sections. The array is
+    // sized up front from the RELA section sizes; symbols are classified
+    // (SHN_ABS, undefined weak, ...) once per symbol table on first use.
+    size_t maxRelocs = 0;
+    for (int i = 0; i < shnum; i++)
+    {
+        const Elf32_Shdr* sh = (const Elf32_Shdr*)(shdrs + i * shentsize);
+        if (read_be32(&sh->sh_type) != SHT_RELA)
+            continue;
+
+        uint32_t info = read_be32(&sh->sh_info);
+        if (info >= shnum || (sectionType[info] != 1 && sectionType[info] != 2))
+            continue;
+
+        uint32_t relaEntSize = read_be32(&sh->sh_entsize);
+        if (relaEntSize == 0)
+            relaEntSize = sizeof(Elf32_Rela);
+        maxRelocs += read_be32(&sh->sh_size) / relaEntSize;
     }
 
-    // Collect R_68K_32 relocations from all RELA sections
     int numRelocs = 0;
-    int maxRelocs = 1024;
-    struct Reloc* relocs = malloc(maxRelocs * sizeof(struct Reloc));
+    relocs = malloc((maxRelocs ? maxRelocs : 1) * sizeof(struct Reloc));
+    symClasses = calloc(shnum, sizeof(uint8_t*));
+    numSymClasses = shnum;
+    struct RelocStats stats;
+    memset(&stats, 0, sizeof(stats));
 
     for (int i = 0; i < shnum; i++)
     {
-        Elf32_Shdr* sh = (Elf32_Shdr*)((uint8_t*)shdrs + i * shentsize);
+        const Elf32_Shdr* sh = (const Elf32_Shdr*)(shdrs + i * shentsize);
         uint32_t type = read_be32(&sh->sh_type);
 
         if (type != SHT_RELA)
@@ -393,41 +1850,56 @@ int main(int argc, char* argv[])
         if (relaEntSize == 0)
             relaEntSize = sizeof(Elf32_Rela);
 
-        // Get linked symbol table for this RELA section
+        if ((size_t)relaOffset + relaSize > fileSize)
+        {
+            fprintf(log, "Relocation section %d exceeds file size\n", i);
+            goto out;
+        }
+
+        // Get symbol classes of the linked symbol table for this RELA section
         uint32_t symtabIdx = read_be32(&sh->sh_link);
-        Elf32_Shdr* symtabSh = NULL;
-        uint32_t symOffset = 0;
-        uint32_t symEntSize = sizeof(Elf32_Sym);
+        const uint8_t* symClass = NULL;
+        uint32_t numSyms = 0;
         if (symtabIdx < shnum)
         {
-            symtabSh = (Elf32_Shdr*)((uint8_t*)shdrs + symtabIdx * shentsize);
-            symOffset = read_be32(&symtabSh->sh_offset);
-            uint32_t ent = read_be32(&symtabSh->sh_entsize);
-            if (ent != 0)
-                symEntSize = ent;
+            const Elf32_Shdr* symtabSh = (const Elf32_Shdr*)(shdrs + symtabIdx * shentsize);
+            numSyms = symCount(symtabSh, fileSize);
+            if (!symClasses[symtabIdx])
+                symClasses[symtabIdx] = buildSymClass(elf, shdrs, shentsize, shnum, symtabSh, numSyms);
+            symClass = symClasses[symtabIdx];
         }
 
         int numEntries = relaSize / relaEntSize;
+        const uint8_t* rp = elf + relaOffset;
 
-        for (int j = 0; j < numEntries; j++)
+        for (int j = 0; j < numEntries; j++, rp += relaEntSize)
         {
-            Elf32_Rela* rela = (Elf32_Rela*)(elf + relaOffset + j * relaEntSize);
+            const Elf32_Rela* rela = (const Elf32_Rela*)rp;
             uint32_t rInfo = read_be32(&rela->r_info);
             uint32_t rOffset = read_be32(&rela->r_offset);
 
             if (ELF32_R_TYPE(rInfo) != R_68K_32)
                 continue;
 
+            stats.total++;
+
             // Skip relocations referencing absolute symbols (e.g. __stack_size)
-            if (symtabSh)
+            uint32_t symIdx = ELF32_R_SYM(rInfo);
+            int cls = (symClass && symIdx < numSyms) ? symClass[symIdx] : SYM_ADDR;
+            if (cls == SYM_ABS)
             {
-                uint32_t symIdx = ELF32_R_SYM(rInfo);
-                Elf32_Sym* sym = (Elf32_Sym*)(elf + symOffset + symIdx * symEntSize);
-                uint16_t symShndx = read_be16(&sym->st_shndx);
-                if (symShndx == SHN_ABS)
-                    continue;
+                stats.abs++;
+                continue;
             }
 
+            uint8_t drop = RELOC_KEEP;
+            if (symIdx == 0)
+                drop = RELOC_NO_SYMBOL;
+            else if (cls == SYM_WEAK_UNDEF)
+                drop = RELOC_WEAK_UNDEF;
+            else if (cls == SYM_NOT_LOADED)
+                drop = RELOC_NOT_LOADED;
+
             // Calculate absolute offset in the image
             uint32_t absOffset;
             if (targetType == 1)
@@ -435,104 +1907,63 @@ int main(int argc, char* argv[])
             else
                 absOffset = textSize + (rOffset - dataStart);
 
-            if (numRelocs >= maxRelocs)
-            {
-                maxRelocs *= 2;
-                relocs = realloc(relocs, maxRelocs * sizeof(struct Reloc));
-            }
             relocs[numRelocs].offset = absOffset;
+            relocs[numRelocs].drop = drop;
             numRelocs++;
         }
     }
 
     // Sort relocations by offset
-    qsort(relocs, numRelocs, sizeof(struct Reloc), relocCmp);
+    if (relocSort(relocs, numRelocs) < 0)
+    {
+        fprintf(log, "Out of memory sorting relocations\n");
+        goto out;
+    }
 
-    fprintf(stderr, "Relocations: %d\n", numRelocs);
+    if (opt->verbose)
+        fprintf(log, "Relocations: %d\n", numRelocs);
 
-    // Build delta-encoded relocation table
-    // Max size: each reloc could be 4 bytes (long form)
-    uint8_t* relBuf = malloc(numRelocs * 4 + 4);
-    int relBufSize = 0;
+    // Size the delta-encoded relocation table; it is encoded again straight
+    // into the output buffer when the file is written
+    int relBufSize = relocEncode(relocs, numRelocs, opt->optimizeRelocs, NULL,
+                                 &stats.dups, &stats.longAfter, log);
 
-    uint32_t lastOffset = 0;
-    for (int i = 0; i < numRelocs; i++)
+    if (opt->optimizeRelocs)
     {
-        uint32_t delta = relocs[i].offset - lastOffset;
-
-        if (delta == 0 && i > 0)
-        {
-            fprintf(stderr, "Warning: duplicate relocation at offset 0x%x\n", relocs[i].offset);
-            continue;
-        }
-
-        if (delta > 0xFFFF || (delta & 0x10000))
-        {
-            // Long form: write as big-endian 32-bit
-            // The high word will have bit 0 set (since delta > 0xFFFF,
-            // the high word is >= 1, and we need bit 0 of high word set)
-            // Actually: if delta fits in 32 bits and high word has bit 0 set,
-            // it signals long form. We need to ensure the high word is odd.
-            // Since deltas should be even (4-byte aligned relocations),
-            // a delta >= 0x10000 will have the high word >= 1.
-            // The original code just checks delta & 0x10000 and writes 32 bits.
-            // The reader checks bit 0 of the 16-bit word to decide long/short.
-            // For a 32-bit big-endian write of delta, the first 16 bits are delta>>16.
-            // If delta >= 0x10000, delta>>16 >= 1. But is bit 0 of (delta>>16) set?
-            // Not necessarily. E.g., delta = 0x20000 -> high word = 0x0002 (bit 0 = 0).
-            // This looks like a bug in the original code. Let me re-examine...
-            //
-            // Actually, looking at the original more carefully:
-            // Write: if (delta & 0x10000) -> PUT_LONG(delta)
-            // Read:  read 16-bit word, if (word & 1) -> it's long, read another 16 bits
-            //
-            // For delta = 0x10000: high word = 0x0001, bit 0 = 1. OK.
-            // For delta = 0x10002: high word = 0x0001, bit 0 = 1. OK.
-            // For delta = 0x20000: high word = 0x0002, bit 0 = 0. BUG!
-            //
-            // But wait - the original code checks (delta & 0x10000), not (delta >= 0x10000).
-            // If delta = 0x20000, (0x20000 & 0x10000) = 0, so it writes SHORT.
-            // But 0x20000 doesn't fit in 16 bits! This would silently truncate.
-            //
-            // In practice, relocation deltas are rarely > 64K apart for small programs.
-            // For correctness, we should use long form for any delta > 0xFFFE.
-            // We'll use the 0x0001 prefix marker explicitly.
-
-            // Use explicit long form: write 0x0001 marker + 32-bit absolute offset
-            uint16_t marker = be16(0x0001);
-            uint32_t absOff = be32(relocs[i].offset);
-            memcpy(relBuf + relBufSize, &marker, 2);
-            relBufSize += 2;
-            memcpy(relBuf + relBufSize, &absOff, 4);
-            relBufSize += 4;
-        }
-        else
+        int dupsBefore = 0;
+        stats.sizeBefore = relocEncode(relocs, numRelocs, 0, NULL, &dupsBefore, &stats.longBefore, NULL);
+        stats.sizeAfter = relBufSize;
+        stats.fixupsBefore = numRelocs - dupsBefore;
+        stats.fixupsAfter = numRelocs - stats.dups;
+        for (int i = 0; i < numRelocs; i++)
         {
-            // Short form: 16-bit delta (must be even, bit 0 = 0)
-            uint16_t d = be16((uint16_t)delta);
-            memcpy(relBuf + relBufSize, &d, 2);
-            relBufSize += 2;
+            stats.dropped[relocs[i].drop]++;
+            if (relocs[i].drop != RELOC_KEEP)
+                stats.fixupsAfter--;
         }
 
-        lastOffset = relocs[i].offset;
+        relocFindPcrel(relocs, numRelocs, loadSecs, numLoadSecs, elf, textSize,
+                       imageSize + bssSize, &stats);
+        if (opt->verbose)
+            relocReport(log, &stats);
     }
 
-    fprintf(stderr, "Relocation table: %d bytes\n", relBufSize);
+    if (opt->verbose)
+        fprintf(log, "Relocation table: %d bytes\n", relBufSize);
 
     // Collect symbols if requested
-    struct XSym* xsyms = NULL;
     int numXSyms = 0;
     int symBufSize = 0;
 
-    if (includeSymbols)
+    if (opt->includeSymbols)
     {
         // Find symbol table and string table
-        Elf32_Shdr* symtabHdr = NULL;
+        const Elf32_Shdr* symtabHdr = NULL;
         const char* strtab = NULL;
 
         for (int i = 0; i < shnum; i++)
         {
-            Elf32_Shdr* sh = (Elf32_Shdr*)((uint8_t*)shdrs + i * shentsize);
+            const Elf32_Shdr* sh = (const Elf32_Shdr*)(shdrs + i * shentsize);
             uint32_t type = read_be32(&sh->sh_type);
 
             if (type == SHT_SYMTAB)
@@ -540,7 +1971,7 @@ int main(int argc, char* argv[])
                 symtabHdr = sh;
                 // sh_link points to the string table
                 uint32_t link = read_be32(&sh->sh_link);
-                Elf32_Shdr* strHdr = (Elf32_Shdr*)((uint8_t*)shdrs + link * shentsize);
+                const Elf32_Shdr* strHdr = (const Elf32_Shdr*)(shdrs + link * shentsize);
                 strtab = (const char*)(elf + read_be32(&strHdr->sh_offset));
                 break;
             }
@@ -558,7 +1989,7 @@ int main(int argc, char* argv[])
 
             for (int i = 0; i < numElfSyms; i++)
             {
-                Elf32_Sym* sym = (Elf32_Sym*)(elf + symOffset + i * symEntSize);
+                const Elf32_Sym* sym = (const Elf32_Sym*)(elf + symOffset + i * symEntSize);
                 uint32_t nameIdx = read_be32(&sym->st_name);
                 uint32_t value = read_be32(&sym->st_value);
                 uint16_t shndx = read_be16(&sym->st_shndx);
@@ -584,13 +2015,14 @@ int main(int argc, char* argv[])
                 uint8_t type = ELF32_ST_TYPE(info);
 
                 // Skip file and section symbols
-                if (type == 4 || type == 3)  // STT_FILE, STT_SECTION
+                if (type == STT_FILE || type == STT_SECTION)
                     continue;
 
                 xsyms[numXSyms].location = (bind == STB_GLOBAL) ? X_SYM_EXTERNAL : X_SYM_LOCAL;
                 xsyms[numXSyms].section = secType;  // 1=text, 2=data, 3=bss maps directly
                 xsyms[numXSyms].value = value;
                 xsyms[numXSyms].name = name;
+                xsyms[numXSyms].nameLen = strlen(name);
                 numXSyms++;
             }
 
@@ -601,21 +2033,50 @@ int main(int argc, char* argv[])
             for (int i = 0; i < numXSyms; i++)
             {
                 // 2 bytes (location + section) + 4 bytes (value) + name + padding
-                int nameLen = strlen(xsyms[i].name);
-                int paddedLen = (nameLen + 2) & ~1;  // round up to even, with NUL
+                int paddedLen = (xsyms[i].nameLen + 2) & ~1;  // round up to even, with NUL
                 symBufSize += 6 + paddedLen;
             }
 
-            fprintf(stderr, "Symbols: %d (%d bytes)\n", numXSyms, symBufSize);
+            if (opt->verbose)
+                fprintf(log, "Symbols: %d (%d bytes)\n", numXSyms, symBufSize);
         }
     }
 
-    // Write X-file
-    FILE* fout = fopen(outFile, "wb");
-    if (!fout)
+    // With --compress, text+data and relocations are replaced by the
+    // unpacker and packed data, unless that does not make the file smaller
+    uint32_t hdrEntry = entryPoint;
+    uint32_t hdrText = textSize;
+    uint32_t hdrData = dataSize;
+    uint32_t hdrBss = bssSize;
+    uint32_t hdrRel = relBufSize;
+    struct PackInfo pack;
+
+    if (opt->compress)
     {
-        perror(outFile);
-        return 1;
+        packBuf = packImage(loadSecs, numLoadSecs, elf, imageSize, bssSize, entryPoint,
+                            relocs, numRelocs, opt->optimizeRelocs, relBufSize, &pack);
+        if (!packBuf)
+        {
+            fprintf(log, "Out of memory compressing image\n");
+            goto out;
+        }
+        if (opt->verbose)
+            packReport(log, &pack, imageSize + relBufSize);
+
+        if (pack.textSize < imageSize + relBufSize)
+        {
+            hdrEntry = 0;
+            hdrText = pack.textSize;
+            hdrData = 0;
+            hdrBss = pack.bssSize;
+            hdrRel = 0;
+        }
+        else
+        {
+            fprintf(log, "Compressed image is not smaller, writing it uncompressed\n");
+            free(packBuf);
+            packBuf = NULL;
+        }
     }
 
     // Write header (0x40 bytes)
@@ -630,72 +2091,436 @@ int main(int argc, char* argv[])
     // base = 0
     // entry point
     uint32_t tmp;
-    tmp = be32(entryPoint);
+    tmp = be32(hdrEntry);
     memcpy(header + 8, &tmp, 4);
     // text size
-    tmp = be32(textSize);
+    tmp = be32(hdrText);
     memcpy(header + 12, &tmp, 4);
     // data size
-    tmp = be32(dataSize);
+    tmp = be32(hdrData);
     memcpy(header + 16, &tmp, 4);
     // bss size
-    tmp = be32(bssSize);
+    tmp = be32(hdrBss);
     memcpy(header + 20, &tmp, 4);
     // relocation table size
-    tmp = be32(relBufSize);
+    tmp = be32(hdrRel);
     memcpy(header + 24, &tmp, 4);
     // symbol table size
     tmp = be32(symBufSize);
     memcpy(header + 28, &tmp, 4);
 
-    fwrite(header, 1, X_HEADER_SIZE, fout);
-
-    // Write text segment
-    fwrite(image, 1, textSize, fout);
+    fd = open(outFile, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+    {
+        fprintf(log, "%s: %s\n", outFile, strerror(errno));
+        goto out;
+    }
+    created = 1;
 
-    // Write data segment
-    if (dataSize > 0)
-        fwrite(image + textSize, 1, dataSize, fout);
+    if (outOpen(&ob, fd) < 0)
+    {
+        fprintf(log, "Out of memory allocating output buffer\n");
+        goto out;
+    }
 
-    // Write relocation table
-    if (relBufSize > 0)
-        fwrite(relBuf, 1, relBufSize, fout);
+    // Write header, text+data, relocation table and symbols in file order.
+    // Section contents go out straight from the input mapping.
+    int writeErr = outPut(&ob, header, X_HEADER_SIZE);
 
-    // Write symbol table
-    if (includeSymbols && numXSyms > 0)
+    uint32_t imgPos = 0;
+    for (int i = 0; i < numLoadSecs && writeErr == 0; i++)
     {
-        for (int i = 0; i < numXSyms; i++)
+        if (loadSecs[i].imgOffset < imgPos)
         {
-            uint8_t symEntry[6];
-            symEntry[0] = xsyms[i].location;
-            symEntry[1] = xsyms[i].section;
-            uint32_t val = be32(xsyms[i].value);
-            memcpy(symEntry + 2, &val, 4);
-            fwrite(symEntry, 1, 6, fout);
-
-            int nameLen = strlen(xsyms[i].name);
-            fwrite(xsyms[i].name, 1, nameLen, fout);
+            fprintf(log, "Section at 0x%x overlaps previous section\n", loadSecs[i].addr);
+            goto out;
+        }
+        if (!packBuf)
+        {
+            writeErr = outZeros(&ob, loadSecs[i].imgOffset - imgPos);
+            if (writeErr == 0)
+                writeErr = outPut(&ob, elf + loadSecs[i].offset, loadSecs[i].size);
+        }
+        imgPos = loadSecs[i].imgOffset + loadSecs[i].size;
+    }
 
-            // Pad to even boundary with NUL bytes
-            int paddedLen = (nameLen + 2) & ~1;
-            int padding = paddedLen - nameLen;
-            uint8_t zeros[2] = {0, 0};
-            fwrite(zeros, 1, padding, fout);
+    if (writeErr == 0)
+    {
+        if (packBuf)
+        {
+            writeErr = outPut(&ob, packBuf, hdrText);
+        }
+        else
+        {
+            writeErr = outZeros(&ob, imageSize - imgPos);
+            if (writeErr == 0 && relocEncode(relocs, numRelocs, opt->optimizeRelocs, &ob,
+                                             NULL, NULL, NULL) < 0)
+                writeErr = -1;
         }
     }
 
-    fclose(fout);
+    // Write symbol table
+    for (int i = 0; i < numXSyms && writeErr == 0; i++)
+    {
+        uint8_t symEntry[6];
+        symEntry[0] = xsyms[i].location;
+        symEntry[1] = xsyms[i].section;
+        uint32_t val = be32(xsyms[i].value);
+        memcpy(symEntry + 2, &val, 4);
+
+        // Name padded to an even length with NUL bytes
+        writeErr = outPut(&ob, symEntry, 6);
+        if (writeErr == 0)
+            writeErr = outPut(&ob, xsyms[i].name, xsyms[i].nameLen);
+        if (writeErr == 0)
+            writeErr = outZeros(&ob, ((xsyms[i].nameLen + 2) & ~1) - xsyms[i].nameLen);
+    }
 
-    long outSize = X_HEADER_SIZE + imageSize + relBufSize + symBufSize;
-    fprintf(stderr, "Written %s: %ld bytes (header=%d text=%u data=%u relocs=%d syms=%d)\n",
-            outFile, outSize, X_HEADER_SIZE, textSize, dataSize, relBufSize, symBufSize);
+    if (writeErr == 0)
+        writeErr = outFlush(&ob, NULL, 0);
+    if (writeErr == 0)
+    {
+        writeErr = close(fd);
+        fd = -1;
+    }
+    if (writeErr != 0)
+    {
+        fprintf(log, "%s: %s\n", outFile, strerror(errno));
+        goto out;
+    }
 
-    free(elf);
-    free(image);
+    long outSize = X_HEADER_SIZE + hdrText + hdrData + hdrRel + symBufSize;
+    if (opt->verbose)
+        fprintf(log, "Written %s: %ld bytes (header=%d text=%u data=%u relocs=%u syms=%d)\n",
+                outFile, outSize, X_HEADER_SIZE, hdrText, hdrData, hdrRel, symBufSize);
+
+    rc = 0;
+
+out:
+    if (fd >= 0)
+        close(fd);
+    if (rc != 0 && created)
+        unlink(outFile);
+    if (in.data)
+        inputClose(&in);
+    free(loadSecs);
+    free(ob.buf);
     free(relocs);
-    free(relBuf);
+    for (int i = 0; i < numSymClasses; i++)
+        free(symClasses[i]);
+    free(symClasses);
+    free(packBuf);
     free(xsyms);
     free(sectionType);
+    return rc;
+}
 
-    return 0;
+// run68-pool.c includes this file for convertFile() and brings its own main
+#ifndef ELF2X68K_NO_MAIN
+
+// ---------------------------------------------------------------------------
+// Batch mode: convert many files in one process on a pool of worker threads
+// ---------------------------------------------------------------------------
+
+struct BatchJob
+{
+    char* inFile;
+    char* outFile;
+    int rc;
+};
+
+struct Batch
+{
+    const struct Options* opt;
+    struct BatchJob* jobs;
+    int numJobs;
+    int next;               // next job to hand out
+    pthread_mutex_t lock;   // protects next and stderr
+};
+
+// Read "input output" or "input:output" pairs, one per line.
+// Blank lines and lines starting with '#' are ignored.
+static int batchRead(const char* manifest, struct BatchJob** jobsOut)
+{
+    FILE* f = strcmp(manifest, "-") == 0 ? stdin : fopen(manifest, "r");
+    if (!f)
+    {
+        perror(manifest);
+        return -1;
+    }
+
+    struct BatchJob* jobs = NULL;
+    int numJobs = 0;
+    int maxJobs = 0;
+    char* line = NULL;
+    size_t lineCap = 0;
+    int lineNo = 0;
+    int err = 0;
+
+    while (getline(&line, &lineCap, f) >= 0)
+    {
+        lineNo++;
+
+        char* p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        p[strcspn(p, "\r\n")] = '\0';
+        if (*p == '\0' || *p == '#')
+            continue;
+
+        // Whitespace separates the pair if present, otherwise the last ':'
+        char* in = p;
+        char* out = NULL;
+        char* sep = p + strcspn(p, " \t");
+        if (*sep)
+        {
+            *sep++ = '\0';
+            while (*sep == ' ' || *sep == '\t') sep++;
+            out = sep;
+            out[strcspn(out, " \t")] = '\0';
+        }
+        else if ((sep = strrchr(p, ':')) != NULL && sep != p)
+        {
+            *sep = '\0';
+            out = sep + 1;
+        }
+
+        if (!out || *out == '\0')
+        {
+            fprintf(stderr, "%s:%d: expected 'input output' or 'input:output'\n",
+                    manifest, lineNo);
+            err = 1;
+            continue;
+        }
+
+        if (numJobs == maxJobs)
+        {
+            maxJobs = maxJobs ? maxJobs * 2 : 64;
+            jobs = realloc(jobs, maxJobs * sizeof(struct BatchJob));
+        }
+        jobs[numJobs].inFile = strdup(in);
+        jobs[numJobs].outFile = strdup(out);
+        jobs[numJobs].rc = -1;
+        numJobs++;
+    }
+
+    free(line);
+    if (f != stdin)
+        fclose(f);
+
+    *jobsOut = jobs;
+    return err ? -1 : numJobs;
+}
+
+static void* batchWorker(void* arg)
+{
+    struct Batch* b = arg;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&b->lock);
+        int idx = b->next++;
+        pthread_mutex_unlock(&b->lock);
+        if (idx >= b->numJobs)
+            break;
+
+        struct BatchJob* job = &b->jobs[idx];
+
+        // Buffer diagnostics so each file's messages come out in one piece
+        char* text = NULL;
+        size_t textLen = 0;
+        FILE* log = open_memstream(&text, &textLen);
+        if (!log)
+        {
+            job->rc = convertFile(b->opt, job->inFile, job->outFile, stderr);
+            continue;
+        }
+
+        job->rc = convertFile(b->opt, job->inFile, job->outFile, log);
+        fclose(log);
+
+        if (textLen > 0)
+        {
+            pthread_mutex_lock(&b->lock);
+            size_t inLen = strlen(job->inFile);
+            char* save = NULL;
+            for (char* l = strtok_r(text, "\n", &save); l; l = strtok_r(NULL, "\n", &save))
+            {
+                // Messages that already name the input (open errors) go as-is
+                if (strncmp(l, job->inFile, inLen) == 0 && l[inLen] == ':')
+                    fprintf(stderr, "%s\n", l);
+                else
+                    fprintf(stderr, "%s: %s\n", job->inFile, l);
+            }
+            pthread_mutex_unlock(&b->lock);
+        }
+        free(text);
+    }
+    return NULL;
 }
+
+static int runBatch(const struct Options* opt, const char* manifest, int numThreads)
+{
+    struct Batch b;
+    memset(&b, 0, sizeof(b));
+    b.opt = opt;
+
+    b.numJobs = batchRead(manifest, &b.jobs);
+    if (b.numJobs < 0)
+        return 1;
+
+    if (numThreads <= 0)
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = n > 0 ? (int)n : 1;
+    }
+    if (numThreads > b.numJobs)
+        numThreads = b.numJobs;
+
+    pthread_mutex_init(&b.lock, NULL);
+
+    pthread_t* threads = malloc(numThreads * sizeof(pthread_t));
+    int started = 0;
+    for (int i = 0; i < numThreads; i++)
+    {
+        if (pthread_create(&threads[i], NULL, batchWorker, &b) != 0)
+            break;
+        started++;
+    }
+
+    // No threads at all: do the work on the main thread
+    if (started == 0)
+        batchWorker(&b);
+
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    int failed = 0;
+    for (int i = 0; i < b.numJobs; i++)
+    {
+        if (b.jobs[i].rc != 0)
+        {
+            fprintf(stderr, "FAILED: %s\n", b.jobs[i].inFile);
+            failed++;
+        }
+    }
+
+    if (opt->verbose || failed)
+        fprintf(stderr, "Converted %d of %d files (%d failed)\n",
+                b.numJobs - failed, b.numJobs, failed);
+
+    for (int i = 0; i < b.numJobs; i++)
+    {
+        free(b.jobs[i].inFile);
+        free(b.jobs[i].outFile);
+    }
+    free(b.jobs);
+    free(threads);
+    pthread_mutex_destroy(&b.lock);
+
+    return failed ? 1 : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Usage and main
+// ---------------------------------------------------------------------------
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [options] input.elf output.x\n", prog);
+    fprintf(stderr, "       %s [options] --batch MANIFEST\n", prog);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -s              Include symbol table\n");
+    fprintf(stderr, "  -q              Quiet (only report errors)\n");
+    fprintf(stderr, "  -v              Verbose (per-file details in batch mode)\n");
+    fprintf(stderr, "  --optimize-relocs\n");
+    fprintf(stderr, "                  Drop relocations the loader does not need and print\n");
+    fprintf(stderr, "                  a before/after relocation summary\n");
+    fprintf(stderr, "  --compress      Write a self-unpacking X-file (LZ-packed text, data\n");
+    fprintf(stderr, "                  and relocations behind a small 68000 unpacker)\n");
+    fprintf(stderr, "  --size-report FILE\n");
+    fprintf(stderr, "                  Attribute text/data/bss bytes to symbols and objects,\n");
+    fprintf(stderr, "                  print the tables and write them to FILE as JSON\n");
+    fprintf(stderr, "  --map FILE      ld map file (-Wl,-Map) giving the object of each input\n");
+    fprintf(stderr, "                  section for --size-report\n");
+    fprintf(stderr, "  --batch FILE    Convert every 'input output' (or 'input:output') pair\n");
+    fprintf(stderr, "                  listed in FILE, one per line; '-' reads stdin\n");
+    fprintf(stderr, "  -j N            Worker threads for --batch (default: CPU count)\n");
+}
+
+int main(int argc, char* argv[])
+{
+    struct Options opt;
+    memset(&opt, 0, sizeof(opt));
+
+    const char* manifest = NULL;
+    int numThreads = 0;
+    int verbose = -1;
+    int argIdx = 1;
+
+    while (argIdx < argc && argv[argIdx][0] == '-' && argv[argIdx][1] != '\0')
+    {
+        if (strcmp(argv[argIdx], "-s") == 0)
+            opt.includeSymbols = 1;
+        else if (strcmp(argv[argIdx], "--optimize-relocs") == 0)
+            opt.optimizeRelocs = 1;
+        else if (strcmp(argv[argIdx], "--compress") == 0)
+            opt.compress = 1;
+        else if (strcmp(argv[argIdx], "--size-report") == 0 && argIdx + 1 < argc)
+            opt.sizeReport = argv[++argIdx];
+        else if (strcmp(argv[argIdx], "--map") == 0 && argIdx + 1 < argc)
+            opt.mapFile = argv[++argIdx];
+        else if (strcmp(argv[argIdx], "-q") == 0)
+            verbose = 0;
+        else if (strcmp(argv[argIdx], "-v") == 0)
+            verbose = 1;
+        else if (strcmp(argv[argIdx], "--batch") == 0 && argIdx + 1 < argc)
+            manifest = argv[++argIdx];
+        else if (strcmp(argv[argIdx], "-j") == 0 && argIdx + 1 < argc)
+            numThreads = atoi(argv[++argIdx]);
+        else if (strncmp(argv[argIdx], "-j", 2) == 0 && argv[argIdx][2] != '\0')
+            numThreads = atoi(argv[argIdx] + 2);
+        else if (strcmp(argv[argIdx], "-h") == 0 || strcmp(argv[argIdx], "--help") == 0)
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[argIdx]);
+            usage(argv[0]);
+            return 1;
+        }
+        argIdx++;
+    }
+
+    if (opt.mapFile && !opt.sizeReport)
+    {
+        fprintf(stderr, "--map is only used with --size-report\n");
+        return 1;
+    }
+
+    if (manifest)
+    {
+        if (opt.sizeReport)
+        {
+            fprintf(stderr, "--size-report cannot be used with --batch\n");
+            return 1;
+        }
+
+        // Batch mode is quiet unless asked otherwise
+        opt.verbose = verbose > 0;
+        return runBatch(&opt, manifest, numThreads);
+    }
+
+    if (argc - argIdx < 2)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    opt.verbose = verbose != 0;
+    return convertFile(&opt, argv[argIdx], argv[argIdx + 1], stderr);
+}
+
+#endif // ELF2X68K_NO_MAIN
@@ -0,0 +1,378 @@
+#!/bin/bash
+# gen-dos-inline.sh — Generate inline DOS calls for <sys/dos.h> from newlib .S wrappers
+#
+# Usage: gen-dos-inline.sh <human68k-sysdir> <output-dir>
+#   human68k-sysdir: path to projects/newlib/newlib/libc/sys/human68k
+#   output-dir:      include directory searched before newlib's, i.e.
+#                    $PREFIX/$TARGET/sys-include; gets sys/dos.h and
+#                    sys/dos_inline.h
+#
+# Each libdos stub re-pushes its C arguments in the layout DOS wants, runs
+# the .short 0xFFxx and pops them again. The stub's push sequence is turned
+# into an inline asm macro that pushes the caller's values directly, so a
+# call costs the pushes, the trap and one stack adjust: no jsr/rts and no
+# copying of the arguments. Stubs that do anything else are left as calls.
+
+set -e
+
+SYSDIR="$1"
+OUTDIR="$2"
+
+if [ -z "$SYSDIR" ] || [ -z "$OUTDIR" ]; then
+    echo "Usage: $0 <human68k-sysdir> <output-dir>" >&2
+    exit 1
+fi
+
+DOSDIR="$SYSDIR/libdos"
+
+if [ ! -d "$DOSDIR" ]; then
+    echo "Error: $DOSDIR not found" >&2
+    exit 1
+fi
+
+mkdir -p "$OUTDIR/sys"
+
+# =========================================================
+# sys/dos.h — newlib's header plus the inline path
+# =========================================================
+generate_wrapper()
+{
+    cat <<'EOF'
+/* sys/dos.h — auto-generated by gen-dos-inline.sh
+ *
+ * newlib's <sys/dos.h>; with __DOS_INLINE__ defined (as with XC) the
+ * _dos_* calls are also defined as inline DOS traps, see <sys/dos_inline.h>.
+ */
+#include_next <sys/dos.h>
+
+#ifdef __DOS_INLINE__
+#include <sys/dos_inline.h>
+#endif
+EOF
+}
+
+# =========================================================
+# sys/dos_inline.h — one macro per stub
+# =========================================================
+generate_inline()
+{
+    cat <<'HEADER'
+/* sys/dos_inline.h — inline Human68k DOS calls (auto-generated from newlib)
+ *
+ * Included by <sys/dos.h> when __DOS_INLINE__ is defined. Each _dos_xxx()
+ * becomes a statement expression that pushes its arguments, executes the
+ * DOS call (.short 0xFFxx) and pops them: the same code the libdos.a stub
+ * runs, without the jsr/rts and the argument copy. The result has the type
+ * the prototype in <sys/dos.h> declares.
+ *
+ * Arguments are passed in registers ("ri"), never as stack-relative memory
+ * operands, which the pushes would move. DOS preserves everything but d0;
+ * d1/a0/a1 are clobbered as for a call, plus whatever the stub itself saves;
+ * a stub that saves a6 (the frame pointer) stays a library call.
+ *
+ * The library version stays available: (_dos_read)(fd, buf, n), or take
+ * its address.
+ */
+#ifndef _SYS_DOS_INLINE_H
+#define _SYS_DOS_INLINE_H
+
+HEADER
+
+    awk '
+    function reset()
+    {
+        name = ""; trap = ""; nargs = 0; npush = 0; nvalues = 0; pushed = 0; argbytes = 0; ok = 1;
+        post = 0; returns = 0; clobbers = ""; nsaved = 0;
+        delete used;
+    }
+
+    # register number, d0-d7 as 0-7 and a0-a7 as 8-15
+    function regNum(r)
+    {
+        return (substr(r, 1, 1) == "a" ? 8 : 0) + substr(r, 2, 1);
+    }
+
+    # Registers in a save list (d2-d4/a2, d3-a5) as clobbers, returning
+    # how many it pushes. Those the call clobbers anyway add nothing; a6
+    # (the frame pointer) and sp cannot be clobbered, so a stub saving them
+    # stays a library call.
+    function saveRegs(list,    n, parts, i, r, lo, hi, k, c)
+    {
+        n = split(list, parts, "/");
+        c = 0;
+        for (i = 1; i <= n; i++)
+        {
+            r = parts[i];
+            if (r ~ /^[da][0-7]-[da][0-7]$/)
+            {
+                lo = regNum(substr(r, 1, 2));
+                hi = regNum(substr(r, 4, 2));
+            }
+            else if (r ~ /^[da][0-7]$/)
+                lo = hi = regNum(r);
+            else
+            {
+                lo = 1;
+                hi = 0;
+            }
+            if (lo > hi || hi >= 14)
+            {
+                ok = 0;
+                return c;
+            }
+            for (k = lo; k <= hi; k++)
+            {
+                c++;
+                if (k == 0 || k == 1 || k == 8 || k == 9)
+                    continue;
+                clobbers = clobbers ", \"" (k < 8 ? "d" k : "a" (k - 8)) "\"";
+                nsaved++;
+            }
+        }
+        return c;
+    }
+
+    function flush(    i, k, args, sep, asm, ops, body, nregs)
+    {
+        if (name == "")
+            return;
+        if (!ok || trap == "")
+        {
+            skipped++;
+            skippedNames = skippedNames " " name;
+            reset();
+            return;
+        }
+        # every pushed value needs a register of its own, out of d2-d7/a2-a5
+        # less the ones the call clobbers
+        nregs = 10 - nsaved;
+        if (nvalues > nregs)
+        {
+            skipped++;
+            skippedNames = skippedNames " " name;
+            reset();
+            return;
+        }
+
+        args = "";
+        sep = "";
+        for (i = 0; i < nargs; i++)
+        {
+            args = args sep "__a" i;
+            sep = ", ";
+        }
+
+        # pushes in stub order; %0 is the result, %1... the arguments
+        asm = "";
+        ops = "";
+        sep = "";
+        k = 0;
+        for (i = 1; i <= npush; i++)
+        {
+            if (kind[i] == "const")
+            {
+                asm = asm text[i] "\\n\\t";
+                continue;
+            }
+            k++;
+            asm = asm "move." size[i] " %" k ",-(%%sp)\\n\\t";
+            ops = ops sep "\"ri\"((" ctype[size[i]] ")(__a" arg[i] "))";
+            sep = ", ";
+        }
+        asm = asm ".short " trap;
+        if (returns && argbytes > 0)
+        {
+            if (argbytes <= 8)
+                asm = asm "\\n\\taddq.l #" argbytes ",%%sp";
+            else
+                asm = asm "\\n\\tlea " argbytes "(%%sp),%%sp";
+        }
+
+        body = "";
+        for (i = 0; i < nargs; i++)
+            if (!(i in used))
+                body = body " (void)(__a" i ");";
+
+        printf "#ifndef %s\n", name;
+        printf "#define %s(%s) __extension__ ({ \\\n", name, args;
+        printf "    register long __d0 __asm__(\"d0\");%s \\\n", body;
+        printf "    __asm__ __volatile__ (\"%s\" \\\n", asm;
+        printf "        : \"=d\"(__d0)";
+        if (ops != "")
+            printf " \\\n        : %s", ops;
+        else
+            printf " \\\n        :";
+        printf " \\\n        : \"d1\", \"a0\", \"a1\"%s, \"cc\", \"memory\"); \\\n", clobbers;
+        if (returns)
+            printf "    (__typeof__(%s(%s)))__d0; })\n", name, args;
+        else
+            printf "    __builtin_unreachable(); })\n";
+        printf "#endif\n\n";
+        inlined++;
+        reset();
+    }
+
+    BEGIN {
+        ctype["l"] = "long"; ctype["w"] = "short"; ctype["b"] = "char";
+        inlined = 0; skipped = 0; skippedNames = "";
+        reset();
+    }
+
+    FNR == 1 {
+        flush();
+        reset();
+        base = FILENAME;
+        sub(/.*\//, "", base);
+        sub(/\.S$/, "", base);
+        name = "_dos_" base;
+    }
+
+    {
+        line = $0;
+        sub(/\|.*/, "", line);
+        sub(/\/\/.*/, "", line);
+        gsub(/\/\*.*\*\//, "", line);
+        gsub(/%/, "", line);
+        gsub(/\(a7\)/, "(sp)", line);
+        gsub(/a7@/, "sp@", line);
+        sub(/,a7$/, ",sp", line);
+        gsub(/sp@-/, "-(sp)", line);
+        gsub(/sp@\+/, "(sp)+", line);
+        while (match(line, /sp@\([0-9]+\)/))
+            line = substr(line, 1, RSTART - 1) substr(line, RSTART + 4, RLENGTH - 5) "(sp)" substr(line, RSTART + RLENGTH);
+        gsub(/[ \t]+$/, "", line);
+        sub(/^[ \t]+/, "", line);
+        if (line == "" || line ~ /^#/)
+            next;
+        # the label names the function (the file name is only a fallback)
+        if (line ~ /^_dos_[A-Za-z0-9_]+:/)
+        {
+            name = line;
+            sub(/:.*/, "", name);
+            line = substr(line, length(name) + 2);
+            sub(/^[ \t]+/, "", line);
+            if (line == "")
+                next;
+        }
+        if (line ~ /^[A-Za-z0-9_.]+:$/)
+            next;
+
+        n = split(line, f, /[ \t]+/);
+        op = tolower(f[1]);
+        operand = (n >= 2) ? f[2] : "";
+        for (i = 3; i <= n; i++)
+            operand = operand f[i];
+        sub(/^lea\.l$/, "lea", op);
+        sub(/^pea\.l$/, "pea", op);
+
+        if (op == ".short")
+        {
+            if (trap != "" || operand !~ /^0[xX][fF][fF][0-9a-fA-F][0-9a-fA-F]$/)
+                ok = 0;
+            else
+                trap = tolower(operand);
+            post = 1;
+            next;
+        }
+        if (op ~ /^\./)
+        {
+            if (post && op !~ /^\.(size|type|end|even|align|balign|p2align|section|text|globl|global)$/)
+                ok = 0;
+            next;
+        }
+        if (!ok)
+            next;
+
+        if (!post)
+        {
+            # saved registers: the call clobbers them
+            if (op == "movem.l" && operand ~ /^[da0-9\/-]+,-\(sp\)$/)
+            {
+                pushed += 4 * saveRegs(substr(operand, 1, index(operand, ",") - 1));
+                next;
+            }
+            if (op == "move.l" && operand ~ /^[da][0-7],-\(sp\)$/)
+            {
+                pushed += 4 * saveRegs(substr(operand, 1, 2));
+                next;
+            }
+            # an argument, re-pushed from the stub frame
+            if (op ~ /^move\.[lwb]$/ && operand ~ /^[0-9]*\(sp\),-\(sp\)$/)
+            {
+                s = substr(op, 6, 1);
+                off = operand;
+                sub(/\(.*/, "", off);
+                e = off - pushed - 4;
+                want = (s == "l") ? 0 : (s == "w") ? 2 : 3;
+                if (e < 0 || e % 4 != want)
+                {
+                    ok = 0;
+                    next;
+                }
+                a = int(e / 4);
+                npush++;
+                nvalues++;
+                kind[npush] = "arg";
+                arg[npush] = a;
+                size[npush] = s;
+                used[a] = 1;
+                if (a + 1 > nargs)
+                    nargs = a + 1;
+                pushed += (s == "l") ? 4 : 2;
+                argbytes += (s == "l") ? 4 : 2;
+                next;
+            }
+            # a constant (sub-function number and the like)
+            if ((op ~ /^move\.[lwb]$/ && operand ~ /^#[-0-9a-fA-FxX]+,-\(sp\)$/) ||
+                (op ~ /^clr\.[lwb]$/ && operand == "-(sp)") ||
+                (op == "pea" && operand ~ /^\(?[-0-9a-fA-FxX]+\)?(\.w|\.l)?$/))
+            {
+                npush++;
+                kind[npush] = "const";
+                t = line;
+                gsub(/sp/, "%%sp", t);
+                gsub(/[ \t]+/, " ", t);
+                text[npush] = t;
+                pushed += (op == "pea" || op ~ /\.l$/) ? 4 : 2;
+                argbytes += (op == "pea" || op ~ /\.l$/) ? 4 : 2;
+                next;
+            }
+            ok = 0;
+            next;
+        }
+
+        # after the trap: popping, restoring and returning only
+        if ((op == "lea" && operand ~ /^[0-9]+\(sp\),sp$/) ||
+            (op ~ /^(addq|add|adda)\.[lw]$/ && operand ~ /^#[0-9]+,sp$/) ||
+            (op == "movem.l" && operand ~ /^\(sp\)\+,/) ||
+            (op == "move.l" && operand ~ /^\(sp\)\+,[da][0-7]$/) ||
+            (op == "move.l" && operand == "d0,a0"))
+            next;
+        if (op == "rts")
+        {
+            returns = 1;
+            next;
+        }
+        ok = 0;
+    }
+
+    END {
+        flush();
+        printf "/* %d calls inline", inlined;
+        if (skipped)
+            printf "; left as library calls:%s", skippedNames;
+        printf " */\n";
+        print inlined " " skipped > "/dev/stderr";
+    }
+    ' $(ls "$DOSDIR"/*.S | sort)
+
+    cat <<'FOOTER'
+
+#endif /* _SYS_DOS_INLINE_H */
+FOOTER
+}
+
+generate_wrapper > "$OUTDIR/sys/dos.h"
+counts=$(generate_inline 2>&1 >"$OUTDIR/sys/dos_inline.h")
+
+echo "Generated $OUTDIR/sys/dos.h and $OUTDIR/sys/dos_inline.h ($(echo $counts | cut -d' ' -f1) inline, $(echo $counts | cut -d' ' -f2) left as calls)"
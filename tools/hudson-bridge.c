@@ -15,6 +15,11 @@
 //
 // Serial (real hardware):
 //   hudson-bridge /dev/ttyS0
+//   hudson-bridge -b 38400 -r /dev/ttyUSB0      (38400 baud, RTS/CTS)
+//   hudson-bridge -b 38400 -T /dev/ttyUSB0      (measure throughput, exit)
+//
+// Profiling (flat profile and flamegraph input, then exit):
+//   hudson-bridge -l 1234 -e hello.elf -o 6800 -s hello -t 30
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,25 +31,98 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <termios.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/ioctl.h>
 #include <sys/socket.h>
-#include <sys/select.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <netdb.h>
 #include <arpa/inet.h>
 
+#ifdef __linux__
+#include <asm/ioctls.h>
+#endif
+
+// termios2 for baud rates without a Bxxx constant; <asm/termbits.h> clashes
+// with <termios.h>, so the kernel structure is declared here. The layout is
+// the asm-generic one: alpha, mips and sparc differ and powerpc has no
+// TCGETS2, so there custom rates are refused as off Linux.
+#if defined(__linux__) && defined(TCGETS2) && !defined(__alpha__) && !defined(__mips__) && \
+    !defined(__sparc__) && !defined(__powerpc__)
+#define HAVE_TERMIOS2
+struct termios2
+{
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t c_line;
+    cc_t c_cc[19];
+    speed_t c_ispeed;
+    speed_t c_ospeed;
+};
+#ifndef BOTHER
+#define BOTHER 0010000
+#endif
+#endif
+
 #define NUM_REGS       18
-#define RSP_BUFSIZE    4096
+#define PACKET_SIZE    0x10000 // default RSP packet size offered to GDB
+#define RSP_OUTBUF     1024    // output buffered per write while streaming
 #define TARGET_BUFSIZE 4096
-#define MAX_BREAKPOINTS 10
+#define RING_SIZE      131072  // receive ring buffers, power of two
+#define MAX_BREAKPOINTS 10     // DB.X breakpoint slots
+#define BP_OPCODE      0x4afc  // ILLEGAL, patched in for software breakpoints
+#define PIPE_MAX       64      // outstanding pipelined DB.X commands
+#define PIPE_WINDOW    256     // default unanswered command bytes in flight
+#define DBX_LINE_MAX   80      // default longest coalesced DB.X command line
+#define DUMP_CHUNK     512     // bytes per pipelined "d" command
+#define CACHE_PAGE     256     // bytes per cached memory page
+#define CACHE_PAGES    512     // direct-mapped cache slots (128 KB)
+#define STREAM_PAGES   32      // pages in flight while streaming a read
+#define MAX_CLIENTS    8       // GDB connections served at once (-M)
+#define MAX_BACKING    16      // read-only regions served from local files
 
 // DB.X prompt character (standalone DB.X uses '-', ROM debugger uses '+')
 static char promptChar = '-';
 
 static int targetFd = -1;
-static int gdbFd = -1;
+static int targetIsSerial = 0;
 static int listenFd = -1;
 static int verbose = 0;
+static int packetSize = PACKET_SIZE;    // largest RSP packet offered to GDB
+static int baudRate = 9600;             // -b
+static int rtscts = 0;                  // -r: hardware flow control
+static int pipeWindow = PIPE_WINDOW;    // -w: 0 waits for every prompt
+static int lineMax = DBX_LINE_MAX;      // -L: 0 writes one value per command
+
+// Receive ring: bulk read() into the free space, consumers scan in place.
+// head and tail run freely and are masked on access.
+struct Ring
+{
+    uint8_t data[RING_SIZE];
+    uint32_t head;      // next byte to consume
+    uint32_t tail;      // next byte to fill
+};
+
+static struct Ring targetRx;
+
+// GDB connections. The first one to connect controls the target; the
+// others, up to -M, are observers that may only read registers and memory.
+// Packets are taken from them in turn, one each, so none can starve the
+// rest. "cur" is the client whose packet is being handled.
+struct Client
+{
+    int fd;             // -1: slot free
+    int eof;
+    int observer;
+    struct Ring rx;
+};
+
+static struct Client clients[MAX_CLIENTS];
+static struct Client* cur = NULL;
+static int maxClients = 1;
 
 static uint32_t regs[NUM_REGS];
 static int regsValid = 0;
@@ -56,6 +134,19 @@ static struct
     int active;
 } bpTable[MAX_BREAKPOINTS];
 
+// Software breakpoints managed by the bridge: the original word is kept
+// here while the target runs with ILLEGAL in its place
+struct SoftBp
+{
+    uint32_t addr;
+    uint16_t orig;
+};
+
+static struct SoftBp* softBps = NULL;
+static int numSoftBps = 0;
+static int maxSoftBps = 0;
+static int softBpsInserted = 0;
+
 // Register names matching GDB m68k order: D0-D7, A0-A7, SR, PC
 static const char* regNames[NUM_REGS] =
 {
@@ -118,6 +209,29 @@ static uint32_t hexToU32(const char* s)
 // Target (HudsonBug) I/O
 // ---------------------------------------------------------------------------
 
+static speed_t baudConstant(int baud)
+{
+    switch (baud)
+    {
+    case 1200: return B1200;
+    case 2400: return B2400;
+    case 4800: return B4800;
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+#ifdef B57600
+    case 57600: return B57600;
+#endif
+#ifdef B115200
+    case 115200: return B115200;
+#endif
+#ifdef B230400
+    case 230400: return B230400;
+#endif
+    default: return 0;
+    }
+}
+
 static int targetOpenSerial(const char* device)
 {
     int fd = open(device, O_RDWR | O_NOCTTY);
@@ -127,17 +241,55 @@ static int targetOpenSerial(const char* device)
         return -1;
     }
 
+    speed_t speed = baudConstant(baudRate);
+#ifndef HAVE_TERMIOS2
+    if (!speed)
+    {
+        fprintf(stderr, "%s: unsupported baud rate %d\n", device, baudRate);
+        close(fd);
+        return -1;
+    }
+#endif
+
     struct termios tty;
     tcgetattr(fd, &tty);
-    cfsetispeed(&tty, B9600);
-    cfsetospeed(&tty, B9600);
+    cfsetispeed(&tty, speed ? speed : B9600);
+    cfsetospeed(&tty, speed ? speed : B9600);
     tty.c_cflag = CS8 | CREAD | CLOCAL;
+#ifdef CRTSCTS
+    if (rtscts)
+        tty.c_cflag |= CRTSCTS;
+#endif
     tty.c_iflag = IGNPAR;
     tty.c_oflag = 0;
     tty.c_lflag = 0;
     tty.c_cc[VMIN] = 1;
     tty.c_cc[VTIME] = 0;
     tcsetattr(fd, TCSANOW, &tty);
+
+#ifdef HAVE_TERMIOS2
+    // Custom rate (e.g. a tuned DB.X at 76800): BOTHER with the rate itself
+    if (!speed)
+    {
+        struct termios2 tty2;
+        if (ioctl(fd, TCGETS2, &tty2) < 0)
+        {
+            perror("TCGETS2");
+            close(fd);
+            return -1;
+        }
+        tty2.c_cflag &= ~CBAUD;
+        tty2.c_cflag |= BOTHER;
+        tty2.c_ispeed = baudRate;
+        tty2.c_ospeed = baudRate;
+        if (ioctl(fd, TCSETS2, &tty2) < 0)
+        {
+            fprintf(stderr, "%s: cannot set %d baud: %s\n", device, baudRate, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+#endif
     tcflush(fd, TCIOFLUSH);
 
     return fd;
@@ -246,9 +398,150 @@ static int targetOpen(const char* target)
         return targetOpenTcp(host, colon + 1);
     }
 
+    targetIsSerial = 1;
     return targetOpenSerial(target);
 }
 
+// ---------------------------------------------------------------------------
+// Buffered I/O: both links are read in bulk into rings by one poll() loop
+// ---------------------------------------------------------------------------
+
+static uint32_t ringUsed(const struct Ring* r)
+{
+    return r->tail - r->head;
+}
+
+// Contiguous buffered bytes at the head
+static const uint8_t* ringPeek(const struct Ring* r, uint32_t* len)
+{
+    uint32_t off = r->head & (RING_SIZE - 1);
+    uint32_t n = ringUsed(r);
+    if (n > RING_SIZE - off)
+        n = RING_SIZE - off;
+    *len = n;
+    return r->data + off;
+}
+
+// One read() into the contiguous free space; returns bytes read, 0 on EOF
+static int ringFill(struct Ring* r, int fd)
+{
+    uint32_t off = r->tail & (RING_SIZE - 1);
+    uint32_t space = RING_SIZE - ringUsed(r);
+    if (space > RING_SIZE - off)
+        space = RING_SIZE - off;
+
+    int n;
+    do
+        n = read(fd, r->data + off, space);
+    while (n < 0 && errno == EINTR);
+    if (n > 0)
+        r->tail += n;
+    return n;
+}
+
+// Verbose trace of target traffic, written with one call per chunk.
+// Received text keeps newlines and drops CRs; other control characters
+// are shown as \xNN.
+static void traceTarget(const char* prefix, const uint8_t* data, uint32_t len, int rx)
+{
+    char out[1024];
+    int pos = 0;
+    if (prefix)
+        pos = snprintf(out, sizeof(out), "%s", prefix);
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        uint8_t c = data[i];
+        if (pos > (int)sizeof(out) - 8)
+        {
+            fwrite(out, 1, pos, stderr);
+            pos = 0;
+        }
+        if (c >= 0x20 || (rx && c == '\n'))
+            out[pos++] = c;
+        else if (!rx || c != '\r')
+            pos += sprintf(out + pos, "\\x%02x", c);
+    }
+    if (!rx)
+        out[pos++] = '\n';
+    fwrite(out, 1, pos, stderr);
+}
+
+static void acceptClient(void);
+
+// Wait up to timeoutMs (-1 = no limit) for input on the target or GDB
+// links and pull what is available into the rings. A full ring is not
+// polled until its consumer catches up. New GDB connections are accepted
+// while there is a free client slot. Returns 1 if anything happened, 0 on
+// timeout, -1 if the target link is gone. GDB EOF sets the client's eof.
+static int ioPoll(int timeoutMs)
+{
+    struct pollfd pfd[MAX_CLIENTS + 2];
+    struct Client* pfdClient[MAX_CLIENTS + 2];
+    int n = 0;
+    int targetIdx = -1;
+    int listenIdx = -1;
+    int numClients = 0;
+
+    if (ringUsed(&targetRx) < RING_SIZE)
+    {
+        pfd[n].fd = targetFd;
+        pfd[n].events = POLLIN;
+        pfdClient[n] = NULL;
+        targetIdx = n++;
+    }
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        struct Client* c = &clients[i];
+        if (c->fd < 0)
+            continue;
+        numClients++;
+        if (!c->eof && ringUsed(&c->rx) < RING_SIZE)
+        {
+            pfd[n].fd = c->fd;
+            pfd[n].events = POLLIN;
+            pfdClient[n] = c;
+            n++;
+        }
+    }
+    if (listenFd >= 0 && numClients < maxClients)
+    {
+        pfd[n].fd = listenFd;
+        pfd[n].events = POLLIN;
+        pfdClient[n] = NULL;
+        listenIdx = n++;
+    }
+    if (n == 0)
+        return 1;
+
+    int ready = poll(pfd, n, timeoutMs);
+    if (ready < 0)
+        return errno == EINTR ? 1 : -1;
+    if (ready == 0)
+        return 0;
+
+    if (targetIdx >= 0 && (pfd[targetIdx].revents & (POLLIN | POLLHUP | POLLERR)))
+    {
+        if (ringFill(&targetRx, targetFd) <= 0)
+        {
+            fprintf(stderr, "target read error\n");
+            return -1;
+        }
+    }
+    for (int i = 0; i < n; i++)
+    {
+        struct Client* c = pfdClient[i];
+        if (c && (pfd[i].revents & (POLLIN | POLLHUP | POLLERR)))
+        {
+            if (ringFill(&c->rx, c->fd) <= 0)
+                c->eof = 1;
+        }
+    }
+    if (listenIdx >= 0 && (pfd[listenIdx].revents & POLLIN))
+        acceptClient();
+    return 1;
+}
+
 static void targetSend(const char* fmt, ...)
 {
     char buf[512];
@@ -258,17 +551,7 @@ static void targetSend(const char* fmt, ...)
     va_end(ap);
 
     if (verbose)
-    {
-        fprintf(stderr, "-> target: ");
-        for (int i = 0; i < len; i++)
-        {
-            if (buf[i] < 0x20)
-                fprintf(stderr, "\\x%02x", (unsigned char)buf[i]);
-            else
-                fputc(buf[i], stderr);
-        }
-        fputc('\n', stderr);
-    }
+        traceTarget("-> target: ", (const uint8_t*)buf, len, 0);
 
     int written = 0;
     while (written < len)
@@ -276,6 +559,7 @@ static void targetSend(const char* fmt, ...)
         int n = write(targetFd, buf + written, len - written);
         if (n <= 0)
         {
+            if (n < 0 && errno == EINTR) continue;
             perror("target write");
             return;
         }
@@ -283,191 +567,606 @@ static void targetSend(const char* fmt, ...)
     }
 }
 
-// Read from target until we see the prompt character at start of line.
-// Stores everything before the prompt into buf.
-static int targetWaitPrompt(char* buf, int bufSize)
+// Target output being collected up to a delimiter
+struct Reply
 {
-    int pos = 0;
-    int atLineStart = 1;
+    char* buf;
+    int size;
+    int pos;
+    int atLineStart;
+};
 
-    while (pos < bufSize - 1)
+// Move buffered target output into rp up to delim (only at the start of a
+// line if lineStart is set), consuming the delimiter. Returns 1 when the
+// delimiter was found, 2 if rp is full, 0 if more input is needed.
+static int replyScan(struct Reply* rp, char delim, int lineStart)
+{
+    for (;;)
     {
-        char c;
-        int n = read(targetFd, &c, 1);
-        if (n <= 0)
+        int room = rp->size - 1 - rp->pos;
+        if (room <= 0)
         {
-            if (n < 0 && errno == EINTR) continue;
-            fprintf(stderr, "target read error\n");
-            return -1;
+            rp->buf[rp->pos] = '\0';
+            return 2;
         }
 
-        if (verbose)
+        uint32_t avail;
+        const uint8_t* p = ringPeek(&targetRx, &avail);
+        if (avail == 0)
+            return 0;
+        if (avail > (uint32_t)room)
+            avail = room;
+
+        // find the first delimiter that qualifies
+        uint32_t hit = avail;
+        const uint8_t* q = p;
+        while ((q = memchr(q, delim, avail - (q - p))) != NULL)
         {
-            if (c >= 0x20 || c == '\n')
-                fputc(c, stderr);
-            else if (c == '\r')
-                {} // skip CR in verbose output
-            else
-                fprintf(stderr, "\\x%02x", (unsigned char)c);
+            uint32_t k = q - p;
+            if (!lineStart || (k == 0 ? rp->atLineStart : p[k - 1] == '\n'))
+            {
+                hit = k;
+                break;
+            }
+            q++;
         }
 
-        if (c == promptChar && atLineStart)
+        uint32_t take = hit < avail ? hit + 1 : avail;
+        if (verbose)
+            traceTarget(NULL, p, take, 1);
+        memcpy(rp->buf + rp->pos, p, hit < avail ? hit : avail);
+        targetRx.head += take;
+
+        if (hit < avail)
         {
-            buf[pos] = '\0';
-            return pos;
+            rp->pos += hit;
+            rp->buf[rp->pos] = '\0';
+            return 1;
         }
-
-        buf[pos++] = c;
-        atLineStart = (c == '\n');
+        rp->pos += avail;
+        rp->atLineStart = (p[avail - 1] == '\n');
     }
-
-    buf[pos] = '\0';
-    return pos;
 }
 
-// Read from target until we see delim, storing into buf
-static int targetWaitDelim(char* buf, int bufSize, char delim)
+// Read target output into buf until delim (see replyScan). timeoutMs limits
+// each wait for more input. Returns the length, -1 on a target error or -2
+// on timeout.
+static int targetWaitFor(char* buf, int bufSize, char delim, int lineStart, int timeoutMs)
 {
-    int pos = 0;
-    while (pos < bufSize - 1)
+    struct Reply rp = { buf, bufSize, 0, 1 };
+    while (replyScan(&rp, delim, lineStart) == 0)
     {
-        char c;
-        int n = read(targetFd, &c, 1);
-        if (n <= 0)
-        {
-            if (n < 0 && errno == EINTR) continue;
+        int r = ioPoll(timeoutMs);
+        if (r < 0)
             return -1;
+        if (r == 0)
+        {
+            buf[rp.pos] = '\0';
+            return -2;
         }
+    }
+    return rp.pos;
+}
+
+// Read from target until we see the prompt character at start of line.
+// Stores everything before the prompt into buf.
+static int targetWaitPrompt(char* buf, int bufSize)
+{
+    return targetWaitFor(buf, bufSize, promptChar, 1, -1);
+}
 
-        if (verbose && c >= 0x20)
-            fputc(c, stderr);
+// Read from target until we see delim, storing into buf
+static int targetWaitDelim(char* buf, int bufSize, char delim)
+{
+    return targetWaitFor(buf, bufSize, delim, 0, -1);
+}
 
-        if (c == delim)
+// Discard target output until it has been quiet for quietMs
+static void targetDrain(int quietMs)
+{
+    while (ioPoll(quietMs) > 0)
+    {
+        if (verbose)
         {
-            buf[pos] = '\0';
-            return pos;
+            uint32_t avail;
+            const uint8_t* p = ringPeek(&targetRx, &avail);
+            traceTarget(NULL, p, avail, 1);
         }
-        buf[pos++] = c;
+        targetRx.head = targetRx.tail;
     }
-    buf[pos] = '\0';
-    return pos;
+    targetRx.head = targetRx.tail;
 }
 
 // ---------------------------------------------------------------------------
-// HudsonBug commands
+// Command pipeline
 // ---------------------------------------------------------------------------
+//
+// DB.X handles one command line at a time and ends every reply with a
+// prompt, so commands can be sent ahead of their replies: each prompt
+// completes the oldest outstanding command. The window bounds the command
+// bytes sent but not yet answered, so DB.X's receive buffer cannot overflow
+// on a serial line without flow control. Other code runs with the pipeline
+// empty (cmdFlush) and talks to the target directly.
 
-// Parse register dump from "x\r" command
-// Format:
-//   PC=00FF0D3C USP=00000000 SSP=00001FFC SR=2000 X:0  N:0  Z:0  V:0  C:0
-//   D  00000000 FFFF9470 00000007 00000009  00000001 00001206 00FF00E0 00004AB9
-//   A  00000CB0 00000000 00FF00E1 000012AD  00001120 00001206 00001000 00001FFC
-static int hudsonFetchRegs(void)
-{
-    char buf[TARGET_BUFSIZE];
-    targetSend("x\r");
+// Called with the reply text (echo included, prompt stripped)
+typedef void (*ReplyFn)(void* ctx, char* text, int len);
 
-    int len = targetWaitPrompt(buf, sizeof(buf));
-    if (len < 0) return -1;
+static struct
+{
+    ReplyFn fn;
+    void* ctx;
+    int len;            // command bytes
+} pipeCmds[PIPE_MAX];
 
-    if (verbose)
-        fprintf(stderr, "\nreg dump: [%s]\n", buf);
+static int pipeHead = 0;
+static int pipeCount = 0;
+static int pipeBytes = 0;
 
-    // DB.X 3.00 format uses "PC:" and "SR:" (colon, not equals)
-    // Also handle "PC=" for ROM debugger compatibility
-    char* p = strtok(buf, " \r\n");
-    while (p)
-    {
-        if (strncmp(p, "PC:", 3) == 0 || strncmp(p, "PC=", 3) == 0)
-        {
-            regs[17] = hexToU32(p + 3);
-        }
-        else if (strncmp(p, "SR:", 3) == 0 || strncmp(p, "SR=", 3) == 0)
-        {
-            regs[16] = hexToU32(p + 3);
-        }
-        else if (p[0] == 'D' && (p[1] == ' ' || p[1] == '\0'))
-        {
-            for (int i = 0; i < 8; i++)
-            {
-                p = strtok(NULL, " \r\n");
-                if (p) regs[i] = hexToU32(p);
-            }
-        }
-        else if (p[0] == 'A' && (p[1] == ' ' || p[1] == '\0'))
-        {
-            for (int i = 0; i < 8; i++)
-            {
-                p = strtok(NULL, " \r\n");
-                if (p) regs[8 + i] = hexToU32(p);
-            }
-        }
-        p = strtok(NULL, " \r\n");
-    }
+// Wait for the reply to the oldest outstanding command and hand it on
+static int cmdComplete(void)
+{
+    char buf[TARGET_BUFSIZE];
+    int n = targetWaitPrompt(buf, sizeof(buf));
 
-    regsValid = 1;
+    int i = pipeHead;
+    pipeHead = (pipeHead + 1) % PIPE_MAX;
+    pipeCount--;
+    pipeBytes -= pipeCmds[i].len;
+    if (n < 0)
+        return -1;
+    if (pipeCmds[i].fn)
+        pipeCmds[i].fn(pipeCmds[i].ctx, buf, n);
     return 0;
 }
 
-// Set register: DB.X uses interactive mode
-// Send "x REGNAME\r", wait for '=' prompt, then send value
-static int hudsonStoreReg(int regNum, uint32_t val)
+// Wait for every outstanding reply
+static int cmdFlush(void)
 {
-    char buf[TARGET_BUFSIZE];
-    targetSend("x %s\r", regNames[regNum]);
-    targetWaitDelim(buf, sizeof(buf), '=');
-    targetSend("%x\r", val);
-    targetWaitPrompt(buf, sizeof(buf));
-    regs[regNum] = val;
-    return 0;
+    int rc = 0;
+    while (pipeCount > 0)
+    {
+        if (cmdComplete() < 0)
+            rc = -1;
+    }
+    return rc;
 }
 
-// Read memory: "d START END\r" with inclusive end address
-// Response: space-separated hex bytes
-static int hudsonReadMem(uint32_t addr, uint8_t* data, int len)
+// Send a command once the window has room; fn(ctx, reply) runs when its
+// prompt arrives, at the latest in cmdFlush
+static int cmdQueue(ReplyFn fn, void* ctx, const char* fmt, ...)
 {
-    if (len == 0) return 0;
-
-    char buf[TARGET_BUFSIZE];
-    uint32_t endAddr = addr + len - 1;
-    targetSend("d %x %x\r", addr, endAddr);
+    char line[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
 
-    int n = targetWaitPrompt(buf, sizeof(buf));
-    if (n < 0) return -1;
+    while (pipeCount > 0 && (pipeCount == PIPE_MAX || pipeBytes + len > pipeWindow))
+    {
+        if (cmdComplete() < 0)
+            return -1;
+    }
 
-    if (verbose)
-        fprintf(stderr, "\nmem dump: [%s]\n", buf);
+    targetSend("%s", line);
+    int i = (pipeHead + pipeCount) % PIPE_MAX;
+    pipeCmds[i].fn = fn;
+    pipeCmds[i].ctx = ctx;
+    pipeCmds[i].len = len;
+    pipeCount++;
+    pipeBytes += len;
+    return 0;
+}
 
-    // DB.X dump format:
-    //   d 0 f\r\n                                         (echoed command)
-    //   00000000  00FF 0540 01FF 0540 0003 B30A ...       (addr + hex words + ASCII)
-    // Parse line by line, skip echo, extract 4-char hex words after address
-    int pos = 0;
-    char* lineSave = NULL;
-    char* line = strtok_r(buf, "\r\n", &lineSave);
-    while (line && pos < len)
+// Reply check for commands that print nothing but their echo: anything
+// after the echoed line is an error message
+static void replyQuiet(void* ctx, char* text, int len)
+{
+    (void)len;
+    char* nl = strchr(text, '\n');
+    if (!nl)
+        return;
+    for (char* p = nl + 1; *p; p++)
     {
-        // Skip the echoed command line (starts with "d " or "d\t")
-        if (line[0] == 'd' && (line[1] == ' ' || line[1] == '\t'))
+        if (*p != '\r' && *p != '\n' && *p != ' ')
         {
-            line = strtok_r(NULL, "\r\n", &lineSave);
-            continue;
+            if (verbose)
+                fprintf(stderr, "\ncommand failed: [%s]\n", text);
+            (*(int*)ctx)++;
+            return;
         }
+    }
+}
 
-        // Data line: "XXXXXXXX  XXXX XXXX XXXX ...  ASCII"
-        // Find the first 8-char hex address, skip it, then parse 4-char words
-        char* lp = line;
+// ---------------------------------------------------------------------------
+// Memory cache and local backing store
+// ---------------------------------------------------------------------------
+//
+// Target memory read over the wire is kept in page-sized slots until the
+// target runs or is written: c/s, M and register writes invalidate it.
+// Only main RAM and ROM are cached; I/O and VRAM are always read live.
+// Read-only regions can also be served from local copies: the text and
+// rodata of the loaded program's ELF (-e, relocated for load base -o) and
+// an IPL ROM image (-R). Writes through the bridge update those copies too,
+// so reads keep matching the target.
 
-        // Skip leading whitespace
-        while (*lp == ' ') lp++;
+static struct
+{
+    uint32_t addr;      // page address
+    int valid;
+    uint8_t data[CACHE_PAGE];
+} cache[CACHE_PAGES];
 
-        // Skip 8-char address
-        int addrLen = 0;
-        while (hexVal(lp[addrLen]) >= 0) addrLen++;
-        if (addrLen >= 6)
-            lp += addrLen;
+static struct
+{
+    uint32_t addr;
+    uint32_t len;
+    uint8_t* data;
+} backing[MAX_BACKING];
+
+static int numBacking = 0;
+static int cacheEnabled = 1;            // -C turns the cache off
+static unsigned long cacheHits = 0;     // pages
+static unsigned long cacheMisses = 0;
+static unsigned long cacheUncached = 0;
+static unsigned long backedReads = 0;
+
+// Main RAM (up to 12 MB) and CG/IPL ROM; not I/O or VRAM
+static int cacheable(uint32_t addr)
+{
+    return addr < 0xc00000 || (addr >= 0xf00000 && addr < 0x1000000);
+}
 
-        // Parse 4-char hex words from the rest of the line
+static void cacheInvalidateAll(void)
+{
+    for (int i = 0; i < CACHE_PAGES; i++)
+        cache[i].valid = 0;
+}
+
+static void cacheInvalidate(uint32_t addr, uint32_t len)
+{
+    if (len == 0)
+        return;
+    uint32_t first = addr / CACHE_PAGE;
+    uint32_t last = (addr + len - 1) / CACHE_PAGE;
+    if (last - first >= CACHE_PAGES)
+    {
+        cacheInvalidateAll();
+        return;
+    }
+    for (uint32_t p = first; p <= last; p++)
+    {
+        int slot = p % CACHE_PAGES;
+        if (cache[slot].addr == p * CACHE_PAGE)
+            cache[slot].valid = 0;
+    }
+}
+
+// Backing region holding all of [addr, addr+len), or NULL
+static const uint8_t* backingFind(uint32_t addr, uint32_t len)
+{
+    for (int i = 0; i < numBacking; i++)
+    {
+        if (addr >= backing[i].addr && addr - backing[i].addr + len <= backing[i].len)
+            return backing[i].data + (addr - backing[i].addr);
+    }
+    return NULL;
+}
+
+// Apply a write to the backing copies it overlaps
+static void backingWrite(uint32_t addr, const uint8_t* data, uint32_t len)
+{
+    for (int i = 0; i < numBacking; i++)
+    {
+        uint32_t start = addr > backing[i].addr ? addr : backing[i].addr;
+        uint32_t end = addr + len;
+        if (end > backing[i].addr + backing[i].len)
+            end = backing[i].addr + backing[i].len;
+        if (start < end)
+            memcpy(backing[i].data + (start - backing[i].addr), data + (start - addr), end - start);
+    }
+}
+
+static int backingAdd(uint32_t addr, uint32_t len, uint8_t* data)
+{
+    if (numBacking == MAX_BACKING)
+    {
+        fprintf(stderr, "Too many backing regions\n");
+        free(data);
+        return -1;
+    }
+    backing[numBacking].addr = addr;
+    backing[numBacking].len = len;
+    backing[numBacking].data = data;
+    numBacking++;
+    return 0;
+}
+
+static uint8_t* readFile(const char* path, uint32_t* lenOut)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t* data = malloc(len > 0 ? len : 1);
+    if (len < 0 || fread(data, 1, len, f) != (size_t)len)
+    {
+        fprintf(stderr, "%s: read error\n", path);
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *lenOut = len;
+    return data;
+}
+
+static uint32_t be32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static uint16_t be16(const uint8_t* p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+// IPL ROM (128 KB) or CG+IPL ROM image, ending at the top of memory
+static int backingLoadRom(const char* path)
+{
+    uint32_t len;
+    uint8_t* data = readFile(path, &len);
+    if (!data)
+        return -1;
+    if (len == 0 || len > 0x100000)
+    {
+        fprintf(stderr, "%s: not a ROM image (%u bytes)\n", path, len);
+        free(data);
+        return -1;
+    }
+    return backingAdd(0x1000000 - len, len, data);
+}
+
+// Read-only allocated sections of the program's ELF, as loaded at base.
+// The ELF must carry its relocations (linked with -q, as for elf2x68k);
+// R_68K_32 words get base added like the Human68k loader does, except
+// those against SHN_ABS symbols, which elf2x68k leaves out. Pass the same
+// ELF that was converted without --optimize-relocs.
+static int backingLoadElf(const char* path, uint32_t base)
+{
+    uint32_t size;
+    uint8_t* elf = readFile(path, &size);
+    if (!elf)
+        return -1;
+
+    if (size < 52 || memcmp(elf, "\177ELF", 4) != 0 || elf[4] != 1 || elf[5] != 2)
+    {
+        fprintf(stderr, "%s: not a 32-bit big-endian ELF\n", path);
+        free(elf);
+        return -1;
+    }
+
+    uint32_t shoff = be32(elf + 32);
+    uint16_t shentsize = be16(elf + 46);
+    uint16_t shnum = be16(elf + 48);
+    if (shentsize < 40 || shoff > size || (uint64_t)shnum * shentsize > size - shoff)
+    {
+        fprintf(stderr, "%s: bad section headers\n", path);
+        free(elf);
+        return -1;
+    }
+
+    int* region = malloc(shnum * sizeof(int));   // backing index per section
+    int rc = 0;
+    for (int i = 0; i < shnum; i++)
+    {
+        const uint8_t* sh = elf + shoff + i * shentsize;
+        uint32_t type = be32(sh + 4);
+        uint32_t flags = be32(sh + 8);
+        uint32_t addr = be32(sh + 12);
+        uint32_t offset = be32(sh + 16);
+        uint32_t len = be32(sh + 20);
+
+        region[i] = -1;
+        // SHF_ALLOC without SHF_WRITE, with contents (not SHT_NOBITS)
+        if ((flags & 0x2) == 0 || (flags & 0x1) || type == 8 || len == 0)
+            continue;
+        if (offset > size || len > size - offset)
+            continue;
+
+        uint8_t* data = malloc(len);
+        memcpy(data, elf + offset, len);
+        region[i] = numBacking;
+        if (backingAdd(base + addr, len, data) < 0)
+        {
+            rc = -1;
+            break;
+        }
+        if (verbose)
+            fprintf(stderr, "backing: %x-%x from %s\n", base + addr, base + addr + len - 1, path);
+    }
+
+    // Relocate the copies for the load base
+    for (int i = 0; i < shnum && rc == 0 && base != 0; i++)
+    {
+        const uint8_t* sh = elf + shoff + i * shentsize;
+        if (be32(sh + 4) != 4)  // SHT_RELA
+            continue;
+        uint32_t target = be32(sh + 28);
+        if (target >= shnum || region[target] < 0)
+            continue;
+
+        uint32_t relOff = be32(sh + 16);
+        uint32_t relLen = be32(sh + 20);
+        uint32_t symLink = be32(sh + 24);
+        if (relOff > size || relLen > size - relOff || symLink >= shnum)
+            continue;
+        const uint8_t* symSh = elf + shoff + symLink * shentsize;
+        uint32_t symOff = be32(symSh + 16);
+        uint32_t numSyms = be32(symSh + 20) / 16;
+        if (symOff > size || (uint64_t)numSyms * 16 > size - symOff)
+            continue;
+
+        const uint8_t* tsh = elf + shoff + target * shentsize;
+        uint32_t secAddr = be32(tsh + 12);
+        int b = region[target];
+        uint8_t* done = calloc(backing[b].len, 1);  // elf2x68k drops duplicates
+        for (uint32_t r = 0; r + 12 <= relLen; r += 12)
+        {
+            const uint8_t* rel = elf + relOff + r;
+            uint32_t info = be32(rel + 4);
+            uint32_t sym = info >> 8;
+            if ((info & 0xff) != 1)     // R_68K_32
+                continue;
+            if (sym < numSyms && be16(elf + symOff + sym * 16 + 14) == 0xfff1)  // SHN_ABS
+                continue;
+
+            uint32_t off = be32(rel) - secAddr;
+            if (off + 4 > backing[b].len || done[off])
+                continue;
+            done[off] = 1;
+            uint8_t* p = backing[b].data + off;
+            uint32_t v = be32(p) + base;
+            p[0] = v >> 24;
+            p[1] = v >> 16;
+            p[2] = v >> 8;
+            p[3] = v;
+        }
+        free(done);
+    }
+
+    free(region);
+    free(elf);
+    return rc;
+}
+
+// ---------------------------------------------------------------------------
+// HudsonBug commands
+// ---------------------------------------------------------------------------
+
+// Parse a register dump, as printed by "x" and after each "t". Returns
+// REGS_PC if the PC was in it, plus REGS_ALL if everything else was too.
+// Format:
+//   PC=00FF0D3C USP=00000000 SSP=00001FFC SR=2000 X:0  N:0  Z:0  V:0  C:0
+//   D  00000000 FFFF9470 00000007 00000009  00000001 00001206 00FF00E0 00004AB9
+//   A  00000CB0 00000000 00FF00E1 000012AD  00001120 00001206 00001000 00001FFC
+#define REGS_PC  1
+#define REGS_ALL 2
+
+static int regsParse(char* buf)
+{
+    int found = 0;
+
+    // DB.X 3.00 format uses "PC:" and "SR:" (colon, not equals)
+    // Also handle "PC=" for ROM debugger compatibility
+    char* p = strtok(buf, " \r\n");
+    while (p)
+    {
+        if (strncmp(p, "PC:", 3) == 0 || strncmp(p, "PC=", 3) == 0)
+        {
+            regs[17] = hexToU32(p + 3);
+            found |= 1;
+        }
+        else if (strncmp(p, "SR:", 3) == 0 || strncmp(p, "SR=", 3) == 0)
+        {
+            regs[16] = hexToU32(p + 3);
+            found |= 2;
+        }
+        else if (p[0] == 'D' && (p[1] == ' ' || p[1] == '\0'))
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                p = strtok(NULL, " \r\n");
+                if (p) regs[i] = hexToU32(p);
+            }
+            found |= 4;
+        }
+        else if (p[0] == 'A' && (p[1] == ' ' || p[1] == '\0'))
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                p = strtok(NULL, " \r\n");
+                if (p) regs[8 + i] = hexToU32(p);
+            }
+            found |= 8;
+        }
+        if (!p)
+            break;
+        p = strtok(NULL, " \r\n");
+    }
+
+    if (found == 15)
+        return REGS_PC | REGS_ALL;
+    return found & 1 ? REGS_PC : 0;
+}
+
+static int hudsonFetchRegs(void)
+{
+    char buf[TARGET_BUFSIZE];
+    targetSend("x\r");
+
+    int len = targetWaitPrompt(buf, sizeof(buf));
+    if (len < 0) return -1;
+
+    if (verbose)
+        fprintf(stderr, "\nreg dump: [%s]\n", buf);
+
+    regsParse(buf);
+    regsValid = 1;
+    return 0;
+}
+
+// Set register: DB.X uses interactive mode
+// Send "x REGNAME\r", wait for '=' prompt, then send value
+static int hudsonStoreReg(int regNum, uint32_t val)
+{
+    char buf[TARGET_BUFSIZE];
+    targetSend("x %s\r", regNames[regNum]);
+    targetWaitDelim(buf, sizeof(buf), '=');
+    targetSend("%x\r", val);
+    targetWaitPrompt(buf, sizeof(buf));
+    regs[regNum] = val;
+    cacheInvalidateAll();
+    return 0;
+}
+
+// Parse a "d" reply into data[0..len); returns the bytes found
+static int dumpParse(char* buf, uint8_t* data, int len)
+{
+    // DB.X dump format:
+    //   d 0 f\r\n                                         (echoed command)
+    //   00000000  00FF 0540 01FF 0540 0003 B30A ...       (addr + hex words + ASCII)
+    // Parse line by line, skip echo, extract 4-char hex words after address
+    int pos = 0;
+    char* lineSave = NULL;
+    char* line = strtok_r(buf, "\r\n", &lineSave);
+    while (line && pos < len)
+    {
+        // Skip the echoed command line (starts with "d " or "d\t")
+        if (line[0] == 'd' && (line[1] == ' ' || line[1] == '\t'))
+        {
+            line = strtok_r(NULL, "\r\n", &lineSave);
+            continue;
+        }
+
+        // Data line: "XXXXXXXX  XXXX XXXX XXXX ...  ASCII"
+        // Find the first 8-char hex address, skip it, then parse 4-char words
+        char* lp = line;
+
+        // Skip leading whitespace
+        while (*lp == ' ') lp++;
+
+        // Skip 8-char address
+        int addrLen = 0;
+        while (hexVal(lp[addrLen]) >= 0) addrLen++;
+        if (addrLen >= 6)
+            lp += addrLen;
+
+        // Parse 4-char hex words from the rest of the line
         // Stop at ASCII section (non-hex chars after the data)
         char* wordSave = NULL;
         char* wp = strtok_r(lp, " \t", &wordSave);
@@ -511,226 +1210,1051 @@ static int hudsonReadMem(uint32_t addr, uint8_t* data, int len)
     return pos;
 }
 
+// One pipelined "d" command's share of a read
+struct DumpChunk
+{
+    uint32_t addr;
+    uint8_t* data;
+    int len;
+    int got;
+    int done;
+};
+
+static void replyDump(void* ctx, char* text, int len)
+{
+    struct DumpChunk* c = ctx;
+    (void)len;
+    if (verbose)
+        fprintf(stderr, "\nmem dump: [%s]\n", text);
+    c->got = dumpParse(text, c->data, c->len);
+    c->done = 1;
+}
+
+// Receives memory in address order from hudsonReadMem
+typedef void (*MemSink)(void* ctx, const uint8_t* data, int len);
+
+// Read memory: "d START END\r" with inclusive end address
+// Response: space-separated hex bytes
+// Pages come from the cache or backing store where possible. Missing
+// cacheable pages are fetched whole, uncacheable ones only for the bytes
+// asked for; adjacent fetches share a "d" command up to DUMP_CHUNK bytes.
+// Data is passed to sink as soon as it and everything before it is in, with
+// at most STREAM_PAGES pages buffered, so long reads start producing output
+// after the first reply and need no buffer of their own. Returns the bytes
+// delivered, short if DB.X stopped answering part way, or -1 on a link error
+// before any data.
+static int hudsonReadMem(uint32_t addr, int len, MemSink sink, void* ctx)
+{
+    static uint8_t window[STREAM_PAGES][CACHE_PAGE];
+    static struct DumpChunk chunks[STREAM_PAGES];  // reused in turn
+    int chunkOf[STREAM_PAGES];                      // -1: page needs no fetch
+    int nextChunk = 0;
+    struct DumpChunk* open = NULL;                  // not yet queued
+    int rc = 0;
+
+    if (len == 0) return 0;
+
+    uint32_t first = addr & ~(CACHE_PAGE - 1);
+    int numPages = (addr + len - first + CACHE_PAGE - 1) / CACHE_PAGE;
+    int issued = 0;
+    int emitted = 0;
+    int delivered = 0;
+    int stopped = 0;
+
+    while (emitted < numPages && !stopped)
+    {
+        // Classify pages ahead once the window has room for a whole "d"
+        int room = STREAM_PAGES - (issued - emitted) >= DUMP_CHUNK / CACHE_PAGE;
+        while (room && issued < numPages && issued - emitted < STREAM_PAGES && rc == 0)
+        {
+            uint32_t pageAddr = first + issued * CACHE_PAGE;
+            uint32_t start = pageAddr > addr ? pageAddr : addr;
+            uint32_t end = pageAddr + CACHE_PAGE < addr + len ? pageAddr + CACHE_PAGE : addr + len;
+            int slot = issued % STREAM_PAGES;
+            int cslot = (pageAddr / CACHE_PAGE) % CACHE_PAGES;
+            const uint8_t* src = backingFind(start, end - start);
+            issued++;
+
+            chunkOf[slot] = -1;
+            if (src)
+            {
+                backedReads++;
+                memcpy(window[slot] + (start - pageAddr), src, end - start);
+                continue;
+            }
+            if (!cacheEnabled || !cacheable(pageAddr))
+            {
+                cacheUncached++;
+            }
+            else if (cache[cslot].valid && cache[cslot].addr == pageAddr)
+            {
+                cacheHits++;
+                memcpy(window[slot], cache[cslot].data, CACHE_PAGE);
+                continue;
+            }
+            else
+            {
+                cacheMisses++;
+                start = pageAddr;
+                end = pageAddr + CACHE_PAGE;
+            }
+
+            // Extend the open fetch if it ends here, else start a new one
+            uint8_t* p = window[slot] + (start - pageAddr);
+            if (!open || open->data + open->len != p || open->len + (int)(end - start) > DUMP_CHUNK)
+            {
+                if (open)
+                    rc = cmdQueue(replyDump, open, "d %x %x\r", open->addr, open->addr + open->len - 1);
+                // A chunk is reused only after all its pages were passed on
+                open = &chunks[nextChunk++ % STREAM_PAGES];
+                open->addr = start;
+                open->data = p;
+                open->len = 0;
+                open->got = 0;
+                open->done = 0;
+            }
+            open->len += end - start;
+            chunkOf[slot] = open - chunks;
+        }
+
+        // Nothing is waited for before it has been sent
+        if (open && rc == 0)
+        {
+            rc = cmdQueue(replyDump, open, "d %x %x\r", open->addr, open->addr + open->len - 1);
+            open = NULL;
+        }
+        if (rc < 0)
+            break;
+
+        // Pass on every page that is complete, in order
+        while (emitted < issued)
+        {
+            uint32_t pageAddr = first + emitted * CACHE_PAGE;
+            uint32_t start = pageAddr > addr ? pageAddr : addr;
+            uint32_t end = pageAddr + CACHE_PAGE < addr + len ? pageAddr + CACHE_PAGE : addr + len;
+            int slot = emitted % STREAM_PAGES;
+
+            if (chunkOf[slot] >= 0)
+            {
+                struct DumpChunk* c = &chunks[chunkOf[slot]];
+                if (!c->done)
+                    break;
+
+                // Bytes from the end of a short reply on are missing
+                uint32_t bad = c->addr + c->got;
+                if (bad < end)
+                {
+                    if (bad > start)
+                        sink(ctx, window[slot] + (start - pageAddr), bad - start);
+                    delivered += bad > start ? bad - start : 0;
+                    stopped = 1;
+                    break;
+                }
+                if (cacheEnabled && cacheable(pageAddr))
+                {
+                    int cslot = (pageAddr / CACHE_PAGE) % CACHE_PAGES;
+                    memcpy(cache[cslot].data, window[slot], CACHE_PAGE);
+                    cache[cslot].addr = pageAddr;
+                    cache[cslot].valid = 1;
+                }
+            }
+            sink(ctx, window[slot] + (start - pageAddr), end - start);
+            delivered += end - start;
+            emitted++;
+        }
+
+        // Wait for the reply the next page depends on
+        if (!stopped && emitted < issued && cmdComplete() < 0)
+        {
+            rc = -1;
+            break;
+        }
+    }
+
+    if (cmdFlush() < 0)
+        rc = -1;
+
+    if (verbose)
+    {
+        unsigned long total = cacheHits + cacheMisses + backedReads + cacheUncached;
+        fprintf(stderr, "cache: %lu hits, %lu misses, %lu uncached, %lu local (%.0f%% of pages not read)\n",
+                cacheHits, cacheMisses, cacheUncached, backedReads,
+                total ? 100.0 * (cacheHits + backedReads) / total : 0.0);
+    }
+
+    return rc < 0 && delivered == 0 ? -1 : delivered;
+}
+
+// Breakpoints are ILLEGAL instructions patched in by the bridge, so there
+// is no limit on their number. They are in memory only while the target
+// runs: hudsonContinue inserts them and takes them out when it stops, so
+// reads, writes and single steps see the original code. Where a patch
+// does not take (ROM), one of DB.X's numbered slots is used instead.
+
+static int softBpFind(uint32_t addr)
+{
+    for (int i = 0; i < numSoftBps; i++)
+    {
+        if (softBps[i].addr == addr)
+            return i;
+    }
+    return -1;
+}
+
+static void replyCopy(void* ctx, const uint8_t* data, int len)
+{
+    uint8_t** p = ctx;
+    memcpy(*p, data, len);
+    *p += len;
+}
+
+// Patch each breakpoint with ILLEGAL (insert) or its original word
+static int softBpPatch(int insert)
+{
+    int errors = 0;
+    int rc = 0;
+    for (int i = 0; i < numSoftBps && rc == 0; i++)
+    {
+        rc = cmdQueue(replyQuiet, &errors, "mew %x %x\r", softBps[i].addr,
+                      insert ? BP_OPCODE : softBps[i].orig);
+    }
+    if (cmdFlush() < 0 || rc < 0 || errors)
+    {
+        fprintf(stderr, "Failed to %s software breakpoints\n", insert ? "insert" : "remove");
+        return -1;
+    }
+    softBpsInserted = insert;
+    return 0;
+}
+
+// Keep saved original words current when GDB writes over a breakpoint
+static void softBpWrite(uint32_t addr, const uint8_t* data, uint32_t len)
+{
+    for (int i = 0; i < numSoftBps; i++)
+    {
+        uint32_t a = softBps[i].addr;
+        if (a >= addr && a - addr < len)
+            softBps[i].orig = (data[a - addr] << 8) | (softBps[i].orig & 0xff);
+        if (a + 1 >= addr && a + 1 - addr < len)
+            softBps[i].orig = (softBps[i].orig & 0xff00) | data[a + 1 - addr];
+    }
+}
+
+// Try ILLEGAL at addr and read it back, putting the original word back
+static int softBpWorks(uint32_t addr, uint16_t orig)
+{
+    uint8_t check[2];
+    struct DumpChunk c = { addr, check, 2, 0, 0 };
+    int errors = 0;
+
+    int rc = cmdQueue(replyQuiet, &errors, "mew %x %x\r", addr, BP_OPCODE);
+    if (rc == 0)
+        rc = cmdQueue(replyDump, &c, "d %x %x\r", addr, addr + 1);
+    if (rc == 0)
+        rc = cmdQueue(replyQuiet, &errors, "mew %x %x\r", addr, orig);
+    if (cmdFlush() < 0 || rc < 0)
+        return -1;
+    return !errors && c.got == 2 && ((check[0] << 8) | check[1]) == BP_OPCODE;
+}
+
+// Set breakpoint: DB.X uses "B<slot> addr" with numbered slots 0-9
+static int hudsonSetSlotBreakpoint(uint32_t addr)
+{
+    // Find free slot
+    int slot = -1;
+    for (int i = 0; i < MAX_BREAKPOINTS; i++)
+    {
+        if (!bpTable[i].active)
+        {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0)
+    {
+        fprintf(stderr, "No free breakpoint slots\n");
+        return -1;
+    }
+
+    char buf[TARGET_BUFSIZE];
+    targetSend("b%d %x\r", slot, addr);
+    if (targetWaitPrompt(buf, sizeof(buf)) < 0)
+        return -1;
+    bpTable[slot].addr = addr;
+    bpTable[slot].active = 1;
+    return 0;
+}
+
+static int hudsonSetBreakpoint(uint32_t addr)
+{
+    if (addr & 1)
+        return -1;
+    if (softBpFind(addr) >= 0)
+        return 0;
+    for (int i = 0; i < MAX_BREAKPOINTS; i++)
+    {
+        if (bpTable[i].active && bpTable[i].addr == addr)
+            return 0;
+    }
+
+    uint8_t word[2];
+    uint8_t* p = word;
+    if (hudsonReadMem(addr, 2, replyCopy, &p) != 2)
+        return -1;
+    uint16_t orig = (word[0] << 8) | word[1];
+
+    int works = softBpWorks(addr, orig);
+    if (works < 0)
+        return -1;
+    if (!works)
+    {
+        if (verbose)
+            fprintf(stderr, "%x is not writable, using a DB.X breakpoint slot\n", addr);
+        return hudsonSetSlotBreakpoint(addr);
+    }
+
+    if (numSoftBps == maxSoftBps)
+    {
+        maxSoftBps = maxSoftBps ? maxSoftBps * 2 : 16;
+        softBps = realloc(softBps, maxSoftBps * sizeof(struct SoftBp));
+    }
+    softBps[numSoftBps].addr = addr;
+    softBps[numSoftBps].orig = orig;
+    numSoftBps++;
+    return 0;
+}
+
+// Clear breakpoint: DB.X uses "BC <slot>" (by number, not address)
+static int hudsonClearBreakpoint(uint32_t addr)
+{
+    int i = softBpFind(addr);
+    if (i >= 0)
+    {
+        softBps[i] = softBps[--numSoftBps];
+        return 0;
+    }
+
+    for (i = 0; i < MAX_BREAKPOINTS; i++)
+    {
+        if (bpTable[i].active && bpTable[i].addr == addr)
+        {
+            char buf[TARGET_BUFSIZE];
+            targetSend("bc %d\r", i);
+            bpTable[i].active = 0;
+            return targetWaitPrompt(buf, sizeof(buf)) < 0 ? -1 : 0;
+        }
+    }
+    fprintf(stderr, "Breakpoint at %x not found\n", addr);
+    return -1;
+}
+
+static int hudsonClearAllBreakpoints(void)
+{
+    char buf[TARGET_BUFSIZE];
+    numSoftBps = 0;
+    for (int i = 0; i < MAX_BREAKPOINTS; i++)
+    {
+        if (bpTable[i].active)
+        {
+            targetSend("bc %d\r", i);
+            targetWaitPrompt(buf, sizeof(buf));
+            bpTable[i].active = 0;
+        }
+    }
+    return 0;
+}
+
+// Queue "me<size> addr value..." commands for count items of size bytes,
+// as many values per line as lineMax allows
+static int queueMemEdit(uint32_t addr, const uint8_t* data, int count, int size, int* errors)
+{
+    static const char suffix[5] = { 0, 's', 'w', 0, 'l' };
+    int i = 0;
+    while (i < count)
+    {
+        char line[512];
+        int len = snprintf(line, sizeof(line), "me%c %x", suffix[size], addr + i * size);
+        do
+        {
+            uint32_t v = 0;
+            for (int b = 0; b < size; b++)
+                v = (v << 8) | data[i * size + b];
+            len += sprintf(line + len, " %0*x", size * 2, v);
+            i++;
+        }
+        while (i < count && len + 1 + size * 2 + 1 <= lineMax);
+
+        if (cmdQueue(replyQuiet, errors, "%s\r", line) < 0)
+            return -1;
+    }
+    return 0;
+}
+
 // Write memory using DB.X 3.00 "ME" (memory edit) command
-// Format: mel addr data  (size suffix S/W/L concatenated, no dot)
+// Format: mel addr data...  (size suffix S/W/L concatenated, no dot)
+// Commands go through the pipeline; longs are coalesced into lines of up
+// to lineMax characters. If DB.X rejects a multi-value line, the write is
+// repeated with one value per command for the rest of the session.
 static int hudsonWriteMem(uint32_t addr, const uint8_t* data, int len)
 {
     if (len == 0) return 0;
 
-    char buf[TARGET_BUFSIZE];
+    cacheInvalidate(addr, len);
+
+    int errors = 0;
     int pos = 0;
+    int rc = 0;
 
     // Handle initial odd byte to get word-aligned
     // DB.X size suffixes: S=byte, W=word, L=long (concatenated, no dot)
     if ((addr & 1) && pos < len)
     {
-        targetSend("mes %x %02x\r", addr + pos, data[pos]);
-        targetWaitPrompt(buf, sizeof(buf));
+        rc |= queueMemEdit(addr + pos, data + pos, 1, 1, &errors);
         pos++;
     }
 
     // Handle initial word to get long-aligned
     if (((addr + pos) & 2) && pos + 1 < len)
     {
-        uint16_t w = ((uint16_t)data[pos] << 8) | data[pos + 1];
-        targetSend("mew %x %04x\r", addr + pos, w);
-        targetWaitPrompt(buf, sizeof(buf));
+        rc |= queueMemEdit(addr + pos, data + pos, 1, 2, &errors);
         pos += 2;
     }
 
-    // Write longwords (4 bytes at a time)
-    while (pos + 3 < len)
+    // Longwords, several per command
+    int longs = (len - pos) / 4;
+    if (longs > 0)
     {
-        uint32_t l = ((uint32_t)data[pos] << 24) | ((uint32_t)data[pos + 1] << 16) |
-                     ((uint32_t)data[pos + 2] << 8) | data[pos + 3];
-        targetSend("mel %x %08x\r", addr + pos, l);
-        targetWaitPrompt(buf, sizeof(buf));
-        pos += 4;
+        rc |= queueMemEdit(addr + pos, data + pos, longs, 4, &errors);
+        pos += longs * 4;
     }
 
     // Handle remaining word
     if (pos + 1 < len)
     {
-        uint16_t w = ((uint16_t)data[pos] << 8) | data[pos + 1];
-        targetSend("mew %x %04x\r", addr + pos, w);
-        targetWaitPrompt(buf, sizeof(buf));
+        rc |= queueMemEdit(addr + pos, data + pos, 1, 2, &errors);
         pos += 2;
     }
 
     // Handle remaining byte
     if (pos < len)
     {
-        targetSend("mes %x %02x\r", addr + pos, data[pos]);
-        targetWaitPrompt(buf, sizeof(buf));
+        rc |= queueMemEdit(addr + pos, data + pos, 1, 1, &errors);
         pos++;
     }
 
+    if (cmdFlush() < 0 || rc < 0)
+        return -1;
+
+    if (errors && lineMax > 0)
+    {
+        fprintf(stderr, "DB.X rejected a multi-value ME command, writing one value per command\n");
+        lineMax = 0;
+        return hudsonWriteMem(addr, data, len);
+    }
+    if (errors)
+        return -1;
+
+    // Only once the target took the write: backing copy and saved words
+    // must keep matching what is really there
+    backingWrite(addr, data, len);
+    softBpWrite(addr, data, len);
     return 0;
 }
 
 // Continue: DB.X "g=addr" to run from address
 // Bare "g" gives "no process" without a loaded program, so always use g=PC
-// Uses select() to monitor both target and GDB FDs so Ctrl-C can interrupt.
+// Watches the GDB link while waiting so Ctrl-C can interrupt.
 // Returns: 0 = normal stop (breakpoint/exception), 1 = interrupted by GDB Ctrl-C
-static int hudsonContinue(uint32_t addr)
+static int hudsonRun(uint32_t addr)
 {
     regsValid = 0;
+    cacheInvalidateAll();
     targetSend("g=%x\r", addr);
-
     char buf[TARGET_BUFSIZE];
-    int pos = 0;
-    int atLineStart = 1;
+    struct Reply rp = { buf, sizeof(buf), 0, 1 };
     int interrupted = 0;
+    int gdbGone = 0;
 
-    while (pos < (int)sizeof(buf) - 1)
+    for (;;)
     {
-        fd_set fds;
-        FD_ZERO(&fds);
-        FD_SET(targetFd, &fds);
-        if (gdbFd >= 0)
-            FD_SET(gdbFd, &fds);
-
-        int maxfd = targetFd > gdbFd ? targetFd : gdbFd;
-        int ready = select(maxfd + 1, &fds, NULL, NULL, NULL);
-        if (ready < 0)
+        // Check for GDB interrupt (Ctrl-C); GDB sends nothing else while
+        // the target runs
+        uint32_t avail = 0;
+        const uint8_t* p = cur ? ringPeek(&cur->rx, &avail) : NULL;
+        if (avail > 0 && p[0] == 0x03)
         {
-            if (errno == EINTR) continue;
-            break;
+            cur->rx.head++;
+            if (verbose)
+                fprintf(stderr, "\nGDB Ctrl-C, breaking target\n");
+            targetSend("\003");
+            interrupted = 1;
         }
-
-        // Check for GDB interrupt (Ctrl-C)
-        if (gdbFd >= 0 && FD_ISSET(gdbFd, &fds))
+        if (cur && cur->eof && !gdbGone)
         {
-            char c;
-            int n = read(gdbFd, &c, 1);
-            if (n <= 0)
-            {
-                // GDB disconnected while target running — stop target
-                fprintf(stderr, "GDB disconnected during continue\n");
-                targetSend("\003");
-                break;
-            }
-            if (c == 0x03)
-            {
-                if (verbose)
-                    fprintf(stderr, "\nGDB Ctrl-C, breaking target\n");
-                targetSend("\003");
-                interrupted = 1;
-            }
+            // GDB disconnected while target running: stop it, and still
+            // take the prompt so the next session starts in sync
+            fprintf(stderr, "GDB disconnected during continue\n");
+            targetSend("\003");
+            gdbGone = 1;
         }
 
-        // Check for target response
-        if (FD_ISSET(targetFd, &fds))
-        {
-            char c;
-            int n = read(targetFd, &c, 1);
-            if (n <= 0) break;
-
-            if (verbose)
-            {
-                if (c >= 0x20 || c == '\n')
-                    fputc(c, stderr);
-                else if (c != '\r')
-                    fprintf(stderr, "\\x%02x", (unsigned char)c);
-            }
-
-            if (c == promptChar && atLineStart)
-            {
-                buf[pos] = '\0';
-                return interrupted;
-            }
-
-            buf[pos++] = c;
-            atLineStart = (c == '\n');
-        }
+        // Output while running is not needed, only the final prompt
+        int r = replyScan(&rp, promptChar, 1);
+        if (r == 1)
+            return interrupted;
+        if (r == 2)
+            rp.pos = 0;
+        else if (ioPoll(-1) < 0)
+            return interrupted;
     }
-
-    buf[pos] = '\0';
-    return interrupted;
 }
 
 // Step: DB.X "t=addr" to trace from address
+// DB.X prints the registers after the step, so they are taken from its
+// reply; a dump without the PC falls back to "x". The new PC is in regs[17].
 static int hudsonStep(uint32_t addr)
 {
     char buf[TARGET_BUFSIZE];
     regsValid = 0;
+    cacheInvalidateAll();
     targetSend("t=%x\r", addr);
-    targetWaitPrompt(buf, sizeof(buf));
+    if (targetWaitPrompt(buf, sizeof(buf)) < 0)
+        return -1;
+
+    int found = regsParse(buf);
+    if (!(found & REGS_PC))
+        return hudsonFetchRegs();
+    regsValid = (found & REGS_ALL) != 0;
     return 0;
 }
 
-// Set breakpoint: DB.X uses "B<slot> addr" with numbered slots 0-9
-static int hudsonSetBreakpoint(uint32_t addr)
+// Continue with the software breakpoints in place
+// Returns: 0 = normal stop (breakpoint/exception), 1 = interrupted by GDB Ctrl-C
+static int hudsonContinue(uint32_t addr)
 {
-    // Find free slot
-    int slot = -1;
+    // A breakpoint where the target resumes would trap at once: step past
+    // it first, with the original instruction in place
+    if (softBpFind(addr) >= 0)
+    {
+        if (hudsonStep(addr) < 0)
+            return 0;
+        addr = regs[17];
+    }
+    if (numSoftBps > 0 && softBpPatch(1) < 0)
+    {
+        softBpPatch(0);
+        return 0;
+    }
+
+    int interrupted = hudsonRun(addr);
+
+    if (softBpsInserted)
+        softBpPatch(0);
+    return interrupted;
+}
+
+static int breakpointAt(uint32_t addr)
+{
+    if (softBpFind(addr) >= 0)
+        return 1;
     for (int i = 0; i < MAX_BREAKPOINTS; i++)
     {
-        if (!bpTable[i].active)
+        if (bpTable[i].active && bpTable[i].addr == addr)
+            return 1;
+    }
+    return 0;
+}
+
+// Range step: trace from addr while the PC stays in [start, end), as GDB
+// asks for when stepping over a source line. Each step's own register dump
+// gives the PC, so there is one "t" per instruction and nothing else.
+// Stops early at a breakpoint, and on Ctrl-C from GDB.
+// Returns: 0 = stopped, 1 = interrupted by GDB Ctrl-C, -1 = target error
+static int hudsonRangeStep(uint32_t addr, uint32_t start, uint32_t end)
+{
+    int steps = 0;
+    int rc = 0;
+    for (;;)
+    {
+        if (hudsonStep(addr) < 0)
         {
-            slot = i;
+            rc = -1;
+            break;
+        }
+        steps++;
+        addr = regs[17];
+        if (addr < start || addr >= end || breakpointAt(addr) || cur->eof)
+            break;
+
+        uint32_t avail;
+        const uint8_t* p = ringPeek(&cur->rx, &avail);
+        if (avail > 0 && p[0] == 0x03)
+        {
+            cur->rx.head++;
+            rc = 1;
             break;
         }
     }
-    if (slot < 0)
+    if (verbose)
+        fprintf(stderr, "\nrange step %x-%x: %d steps, stopped at %x\n", start, end, steps, addr);
+    return rc;
+}
+
+// Throughput self-test: dump len bytes at addr with one "d" command per
+// pass and time it. Passes must parse completely and agree with each
+// other, so a rate that drops or corrupts characters shows up as
+// unreliable. The default range is the IPL ROM, which does not change.
+static int hudsonSpeedTest(uint32_t addr, uint32_t len, int passes)
+{
+    // 16 bytes per line of about 75 characters
+    int bufSize = len / 16 * 80 + 256;
+    char* buf = malloc(bufSize);
+    uint8_t* data[2] = { malloc(len), malloc(len) };
+    int reliable = 1;
+
+    fprintf(stderr, "Speed test: %u bytes at %x, %d passes", len, addr, passes);
+    if (targetIsSerial)
+        fprintf(stderr, ", %d baud%s", baudRate, rtscts ? ", RTS/CTS" : "");
+    fprintf(stderr, "\n");
+
+    for (int pass = 0; pass < passes; pass++)
     {
-        fprintf(stderr, "No free breakpoint slots\n");
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        targetSend("d %x %x\r", addr, addr + len - 1);
+        int n = targetWaitPrompt(buf, bufSize);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        if (n < 0)
+        {
+            reliable = 0;
+            break;
+        }
+
+        double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        uint8_t* d = data[pass & 1];
+        int got = dumpParse(buf, d, len);
+        fprintf(stderr, "  pass %d: %d wire bytes in %.2f s: %.0f B/s wire, %.0f B/s data",
+                pass + 1, n, secs, n / secs, got / secs);
+        if (targetIsSerial)
+            fprintf(stderr, " (%.0f%% of line rate)", 100.0 * n * 10 / baudRate / secs);
+        fprintf(stderr, "\n");
+
+        if ((uint32_t)got != len)
+        {
+            fprintf(stderr, "  pass %d: parsed %d of %u bytes\n", pass + 1, got, len);
+            reliable = 0;
+        }
+        else if (pass > 0 && memcmp(data[0], data[1], len) != 0)
+        {
+            fprintf(stderr, "  pass %d: data differs from the previous pass\n", pass + 1);
+            reliable = 0;
+        }
+    }
+
+    fprintf(stderr, "%s\n", reliable ? "Result: reliable" : "Result: UNRELIABLE");
+    free(buf);
+    free(data[0]);
+    free(data[1]);
+    return reliable ? 0 : 1;
+}
+
+// ---------------------------------------------------------------------------
+// Sampling profiler
+// ---------------------------------------------------------------------------
+
+// The target runs under DB.X and is broken into with Ctrl-C every
+// interval. The register dump DB.X prints on the break gives the PC and
+// A6, and the A6 frame chain (link/unlk, so -fno-omit-frame-pointer) gives
+// the callers. Each sample costs a break, a resume and one "d" per stack
+// page, so on a serial line the interval should stay well above the time
+// that takes.
+
+#define PROFILE_DEPTH  64      // most frames walked per sample (-g)
+
+struct Symbol
+{
+    uint32_t addr;
+    uint32_t size;              // 0: up to the next symbol
+    const char* name;
+    unsigned long self;         // samples with the PC here
+    unsigned long total;        // samples with the function on the stack
+    unsigned long seen;         // last sample counted in total
+};
+
+// Program functions sorted by address, then the two catch-alls below
+static struct Symbol* symbols = NULL;
+static int numSymbols = 0;
+static char* symbolNames = NULL;
+
+#define SYM_ROM     (numSymbols)
+#define SYM_UNKNOWN (numSymbols + 1)
+
+static char** stackSamples = NULL;  // folded stack per sample
+static unsigned long numSamples = 0;
+static unsigned long maxSamples = 0;
+
+static int symbolCompare(const void* a, const void* b)
+{
+    const struct Symbol* x = a;
+    const struct Symbol* y = b;
+    return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+// Function symbols from the ELF's .symtab, at base like backingLoadElf.
+// Global labels in code sections count too, for assembler routines.
+static int symbolsLoadElf(const char* path, uint32_t base)
+{
+    uint32_t size;
+    uint8_t* elf = readFile(path, &size);
+    if (!elf)
+        return -1;
+
+    uint32_t shoff = size >= 52 ? be32(elf + 32) : 0;
+    uint16_t shentsize = size >= 52 ? be16(elf + 46) : 0;
+    uint16_t shnum = size >= 52 ? be16(elf + 48) : 0;
+    if (shentsize < 40 || shoff > size || (uint64_t)shnum * shentsize > size - shoff)
+    {
+        fprintf(stderr, "%s: bad section headers\n", path);
+        free(elf);
         return -1;
     }
 
-    char buf[TARGET_BUFSIZE];
-    targetSend("b%d %x\r", slot, addr);
-    targetWaitPrompt(buf, sizeof(buf));
-    bpTable[slot].addr = addr;
-    bpTable[slot].active = 1;
+    int max = 0;
+    for (int i = 0; i < shnum; i++)
+    {
+        const uint8_t* sh = elf + shoff + i * shentsize;
+        if (be32(sh + 4) != 2)  // SHT_SYMTAB
+            continue;
+        uint32_t symOff = be32(sh + 16);
+        uint32_t symLen = be32(sh + 20);
+        uint32_t strLink = be32(sh + 24);
+        if (symOff > size || symLen > size - symOff || strLink >= shnum)
+            continue;
+        const uint8_t* strSh = elf + shoff + strLink * shentsize;
+        uint32_t strOff = be32(strSh + 16);
+        uint32_t strLen = be32(strSh + 20);
+        if (strOff > size || strLen > size - strOff || strLen == 0)
+            continue;
+
+        // One copy of the string table, kept for the names
+        symbolNames = malloc(strLen + 1);
+        memcpy(symbolNames, elf + strOff, strLen);
+        symbolNames[strLen] = '\0';
+        max = symLen / 16;
+        symbols = malloc((max + 2) * sizeof(struct Symbol));
+
+        for (int k = 1; k < max; k++)
+        {
+            const uint8_t* sym = elf + symOff + k * 16;
+            uint32_t name = be32(sym);
+            uint8_t info = sym[12];
+            uint16_t shndx = be16(sym + 14);
+            if (name == 0 || name >= strLen || shndx == 0 || shndx >= shnum)
+                continue;
+            uint32_t flags = be32(elf + shoff + shndx * shentsize + 8);
+            int type = info & 0xf;
+            // STT_FUNC, or a global STT_NOTYPE label in SHF_EXECINSTR
+            if (!(type == 2 || (type == 0 && (info >> 4) == 1 && (flags & 0x4))))
+                continue;
+
+            struct Symbol* s = &symbols[numSymbols++];
+            s->addr = base + be32(sym + 4);
+            s->size = be32(sym + 8);
+            s->name = symbolNames + name;
+        }
+        break;
+    }
+    free(elf);
+
+    if (numSymbols == 0)
+    {
+        fprintf(stderr, "%s: no function symbols\n", path);
+        return -1;
+    }
+    qsort(symbols, numSymbols, sizeof(struct Symbol), symbolCompare);
+    symbols[SYM_ROM].name = "[rom]";
+    symbols[SYM_UNKNOWN].name = "[unknown]";
+    for (int i = 0; i < numSymbols + 2; i++)
+    {
+        symbols[i].self = 0;
+        symbols[i].total = 0;
+        symbols[i].seen = 0;
+    }
+    if (verbose)
+        fprintf(stderr, "profile: %d function symbols from %s\n", numSymbols, path);
     return 0;
 }
 
-// Clear breakpoint: DB.X uses "BC <slot>" (by number, not address)
-static int hudsonClearBreakpoint(uint32_t addr)
+static int symbolFind(uint32_t addr)
 {
-    for (int i = 0; i < MAX_BREAKPOINTS; i++)
+    int lo = 0;
+    int hi = numSymbols;
+    while (lo < hi)
     {
-        if (bpTable[i].active && bpTable[i].addr == addr)
+        int mid = (lo + hi) / 2;
+        if (symbols[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo > 0 && (symbols[lo - 1].size == 0 || addr - symbols[lo - 1].addr < symbols[lo - 1].size))
+        return lo - 1;
+    return addr >= 0xf00000 ? SYM_ROM : SYM_UNKNOWN;
+}
+
+// Record the sample in regs: the PC, then the callers found by following
+// the frame pointer while the chain looks sane
+static void profileSample(int depth, int haveFp)
+{
+    uint32_t pcs[PROFILE_DEPTH + 1];
+    int n = 0;
+    pcs[n++] = regs[17];
+
+    uint32_t fp = regs[14];
+    while (haveFp && n <= depth && fp != 0 && (fp & 1) == 0)
+    {
+        uint8_t frame[8];
+        uint8_t* p = frame;
+        if (hudsonReadMem(fp, 8, replyCopy, &p) != 8)
+            break;
+        uint32_t next = be32(frame);
+        uint32_t ret = be32(frame + 4);
+        if (ret == 0 || (ret & 1))
+            break;
+        pcs[n++] = ret - 2;     // inside the call, not after it
+        if (next <= fp)
+            break;
+        fp = next;
+    }
+
+    numSamples++;
+    symbols[symbolFind(pcs[0])].self++;
+
+    int folded = 0;
+    for (int i = 0; i < n; i++)
+        folded += strlen(symbols[symbolFind(pcs[i])].name) + 1;
+    char* s = malloc(folded);
+    char* q = s;
+    for (int i = n - 1; i >= 0; i--)
+    {
+        struct Symbol* sym = &symbols[symbolFind(pcs[i])];
+        if (sym->seen != numSamples)
         {
-            char buf[TARGET_BUFSIZE];
-            targetSend("bc %d\r", i);
-            targetWaitPrompt(buf, sizeof(buf));
-            bpTable[i].active = 0;
-            return 0;
+            sym->seen = numSamples;
+            sym->total++;
         }
+        q += sprintf(q, "%s%s", sym->name, i > 0 ? ";" : "");
     }
-    fprintf(stderr, "Breakpoint at %x not found\n", addr);
-    return -1;
+
+    if (numSamples > maxSamples)
+    {
+        maxSamples = maxSamples ? maxSamples * 2 : 1024;
+        stackSamples = realloc(stackSamples, maxSamples * sizeof(char*));
+    }
+    stackSamples[numSamples - 1] = s;
 }
 
-static int hudsonClearAllBreakpoints(void)
+static int stringCompare(const void* a, const void* b)
+{
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static int flatCompare(const void* a, const void* b)
+{
+    const struct Symbol* x = *(const struct Symbol* const*)a;
+    const struct Symbol* y = *(const struct Symbol* const*)b;
+    if (x->self != y->self)
+        return x->self < y->self ? 1 : -1;
+    if (x->total != y->total)
+        return x->total < y->total ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+// PREFIX.flat: self and total samples per function, busiest first.
+// PREFIX.folded: one "caller;callee count" line per distinct stack, for
+// flamegraph.pl and other tools reading perf's folded format.
+static int profileWrite(const char* prefix, int intervalMs)
+{
+    size_t len = strlen(prefix) + 8;
+    char* path = malloc(len);
+
+    snprintf(path, len, "%s.flat", prefix);
+    FILE* f = fopen(path, "w");
+    if (!f)
+    {
+        perror(path);
+        free(path);
+        return -1;
+    }
+    struct Symbol** order = malloc((numSymbols + 2) * sizeof(struct Symbol*));
+    int n = 0;
+    for (int i = 0; i < numSymbols + 2; i++)
+    {
+        if (symbols[i].total > 0)
+            order[n++] = &symbols[i];
+    }
+    qsort(order, n, sizeof(struct Symbol*), flatCompare);
+    double scale = numSamples ? 100.0 / numSamples : 0;
+    fprintf(f, "# %lu samples, one per %d ms\n", numSamples, intervalMs);
+    fprintf(f, "#  self%%     self  total%%    total  function\n");
+    for (int i = 0; i < n; i++)
+    {
+        fprintf(f, "%7.2f %8lu %7.2f %8lu  %s\n", order[i]->self * scale, order[i]->self,
+                order[i]->total * scale, order[i]->total, order[i]->name);
+    }
+    free(order);
+    fclose(f);
+    fprintf(stderr, "Wrote %s\n", path);
+
+    snprintf(path, len, "%s.folded", prefix);
+    f = fopen(path, "w");
+    if (!f)
+    {
+        perror(path);
+        free(path);
+        return -1;
+    }
+    qsort(stackSamples, numSamples, sizeof(char*), stringCompare);
+    for (unsigned long i = 0; i < numSamples; )
+    {
+        unsigned long j = i + 1;
+        while (j < numSamples && strcmp(stackSamples[j], stackSamples[i]) == 0)
+            j++;
+        fprintf(f, "%s %lu\n", stackSamples[i], j - i);
+        i = j;
+    }
+    fclose(f);
+    fprintf(stderr, "Wrote %s\n", path);
+    free(path);
+    return 0;
+}
+
+static double secondsSince(const struct timespec* t0)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (t.tv_sec - t0->tv_sec) + (t.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static volatile int running = 1;
+
+// Run the target from its current PC and sample it every intervalMs until
+// it stops by itself, the time limit (0 = none) runs out, or the bridge
+// gets Ctrl-C. The target is left stopped where the last sample was taken.
+static int hudsonProfile(const char* prefix, int intervalMs, int seconds, int depth)
 {
     char buf[TARGET_BUFSIZE];
-    for (int i = 0; i < MAX_BREAKPOINTS; i++)
+    if (hudsonFetchRegs() < 0)
+        return 1;
+    uint32_t pc = regs[17];
+    fprintf(stderr, "Profiling from %x every %d ms%s\n", pc, intervalMs,
+            seconds ? "" : ", Ctrl-C to stop");
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    double stoppedSecs = 0;
+    int rc = 0;
+
+    while (running && (seconds == 0 || secondsSince(&start) < seconds))
     {
-        if (bpTable[i].active)
+        regsValid = 0;
+        cacheInvalidateAll();
+        targetSend("g=%x\r", pc);
+
+        struct timespec resumed;
+        struct timespec broke;
+        clock_gettime(CLOCK_MONOTONIC, &resumed);
+        struct Reply rp = { buf, sizeof(buf), 0, 1 };
+        int interrupted = 0;
+        int r;
+        while ((r = replyScan(&rp, promptChar, 1)) != 1)
         {
-            targetSend("bc %d\r", i);
-            targetWaitPrompt(buf, sizeof(buf));
-            bpTable[i].active = 0;
+            if (r == 2)
+            {
+                rp.pos = 0;
+                continue;
+            }
+            int waitMs = -1;
+            if (!interrupted)
+            {
+                waitMs = intervalMs - (int)(secondsSince(&resumed) * 1000);
+                if (waitMs <= 0 || !running)
+                {
+                    targetSend("\003");
+                    clock_gettime(CLOCK_MONOTONIC, &broke);
+                    interrupted = 1;
+                    waitMs = -1;
+                }
+            }
+            if (ioPoll(waitMs) < 0)
+            {
+                fprintf(stderr, "Target connection lost\n");
+                rc = 1;
+                break;
+            }
+        }
+        if (r != 1)
+            break;
+
+        int found = regsParse(buf);
+        if (!(found & REGS_PC))
+        {
+            if (hudsonFetchRegs() < 0)
+            {
+                rc = 1;
+                break;
+            }
+            found = REGS_PC | REGS_ALL;
+        }
+        regsValid = (found & REGS_ALL) != 0;
+        pc = regs[17];
+
+        // A prompt before the break means a breakpoint, an exception or the
+        // end of the program
+        if (!interrupted)
+        {
+            fprintf(stderr, "Target stopped by itself at %x\n", pc);
+            break;
         }
+        profileSample(depth, regsValid);
+        stoppedSecs += secondsSince(&broke);
     }
-    return 0;
+
+    double secs = secondsSince(&start);
+    fprintf(stderr, "%lu samples in %.1f s", numSamples, secs);
+    if (numSamples)
+        fprintf(stderr, ", target stopped %.0f ms per sample", stoppedSecs * 1000 / numSamples);
+    fprintf(stderr, "\n");
+    if (numSamples && profileWrite(prefix, intervalMs) < 0)
+        rc = 1;
+    return rc;
 }
 
 // ---------------------------------------------------------------------------
 // GDB RSP framing
 // ---------------------------------------------------------------------------
 
+// Next byte from GDB, waiting for it if necessary; -1 on disconnect
+static int gdbGetc(void)
+{
+    while (ringUsed(&cur->rx) == 0)
+    {
+        if (cur->eof || ioPoll(-1) < 0)
+            return -1;
+    }
+    uint8_t c = cur->rx.data[cur->rx.head & (RING_SIZE - 1)];
+    cur->rx.head++;
+    return c;
+}
+
 static int rspGetPacket(char* buf, int bufSize)
 {
     // Read until we get '$'
-    char c;
+    int c;
     for (;;)
     {
-        int n = read(gdbFd, &c, 1);
-        if (n <= 0) return -1;
+        c = gdbGetc();
+        if (c < 0) return -1;
         if (c == '$') break;
         if (c == 0x03)
         {
@@ -741,55 +2265,152 @@ static int rspGetPacket(char* buf, int bufSize)
         }
     }
 
-    // Read payload until '#'
+    // Read payload until '#'; the excess of an oversized packet is dropped
     int pos = 0;
+    int overflow = 0;
     uint8_t csum = 0;
-    while (pos < bufSize - 1)
+    for (;;)
     {
-        int n = read(gdbFd, &c, 1);
-        if (n <= 0) return -1;
+        c = gdbGetc();
+        if (c < 0) return -1;
         if (c == '#') break;
-        buf[pos++] = c;
+        if (pos < bufSize - 1)
+            buf[pos++] = c;
+        else
+            overflow = 1;
         csum += (uint8_t)c;
     }
     buf[pos] = '\0';
 
-    // Read 2 hex checksum chars
-    char csumHex[2];
-    if (read(gdbFd, &csumHex[0], 1) <= 0) return -1;
-    if (read(gdbFd, &csumHex[1], 1) <= 0) return -1;
+    // Read 2 hex checksum chars
+    char csumHex[2];
+    if ((c = gdbGetc()) < 0) return -1;
+    csumHex[0] = c;
+    if ((c = gdbGetc()) < 0) return -1;
+    csumHex[1] = c;
+
+    uint8_t rxCsum = (hexVal(csumHex[0]) << 4) | hexVal(csumHex[1]);
+    if (rxCsum != csum)
+    {
+        if (verbose)
+            fprintf(stderr, "RSP checksum error: got %02x, expected %02x\n", rxCsum, csum);
+        (void)!write(cur->fd, "-", 1);
+        return -1;
+    }
+
+    (void)!write(cur->fd, "+", 1);
+
+    if (verbose)
+        fprintf(stderr, "<- GDB: $%.*s#%c%c\n", pos, buf, csumHex[0], csumHex[1]);
+
+    if (overflow)
+    {
+        fprintf(stderr, "RSP packet longer than %d bytes\n", bufSize - 1);
+        return -2;
+    }
+    return pos;
+}
+
+// Packets are written as they are produced: rspBegin, any number of
+// rspWrite, rspEnd. Output goes to GDB in RSP_OUTBUF pieces, so a reply
+// can be longer than any buffer and starts before it is complete.
+static struct
+{
+    char buf[RSP_OUTBUF];
+    int len;
+    uint8_t csum;
+} rspOut;
+
+static void rspOutFlush(void)
+{
+    if (verbose)
+        fprintf(stderr, "%.*s", rspOut.len, rspOut.buf);
+    (void)!write(cur->fd, rspOut.buf, rspOut.len);
+    rspOut.len = 0;
+}
 
-    uint8_t rxCsum = (hexVal(csumHex[0]) << 4) | hexVal(csumHex[1]);
-    if (rxCsum != csum)
+static void rspOutRaw(const char* data, int len)
+{
+    while (len > 0)
     {
-        if (verbose)
-            fprintf(stderr, "RSP checksum error: got %02x, expected %02x\n", rxCsum, csum);
-        (void)!write(gdbFd, "-", 1);
-        return -1;
+        int n = RSP_OUTBUF - rspOut.len < len ? RSP_OUTBUF - rspOut.len : len;
+        memcpy(rspOut.buf + rspOut.len, data, n);
+        rspOut.len += n;
+        data += n;
+        len -= n;
+        if (rspOut.len == RSP_OUTBUF)
+            rspOutFlush();
     }
+}
+
+static void rspBegin(void)
+{
+    if (verbose)
+        fprintf(stderr, "-> GDB: ");
+    rspOut.csum = 0;
+    rspOutRaw("$", 1);
+}
 
-    (void)!write(gdbFd, "+", 1);
+static void rspWrite(const char* data, int len)
+{
+    for (int i = 0; i < len; i++)
+        rspOut.csum += (uint8_t)data[i];
+    rspOutRaw(data, len);
+}
 
+static void rspEnd(void)
+{
+    char tail[4];
+    snprintf(tail, sizeof(tail), "#%02x", rspOut.csum);
+    rspOutRaw(tail, 3);
+    rspOutFlush();
     if (verbose)
-        fprintf(stderr, "<- GDB: $%s#%c%c\n", buf, csumHex[0], csumHex[1]);
+        fprintf(stderr, "\n");
+}
 
-    return pos;
+static void rspPutPacketLen(const char* data, int len)
+{
+    rspBegin();
+    rspWrite(data, len);
+    rspEnd();
 }
 
 static void rspPutPacket(const char* data)
 {
-    int len = strlen(data);
-    uint8_t csum = 0;
-    for (int i = 0; i < len; i++)
-        csum += (uint8_t)data[i];
-
-    char pkt[RSP_BUFSIZE + 4];
-    int plen = snprintf(pkt, sizeof(pkt), "$%s#%02x", data, csum);
+    rspPutPacketLen(data, strlen(data));
+}
 
-    if (verbose)
-        fprintf(stderr, "-> GDB: %s\n", pkt);
+// Binary data as sent in X packets and x replies: '#', '$', '}' and '*'
+// are sent as '}' followed by the byte xor 0x20
+static void rspWriteBinary(const uint8_t* data, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        char c = data[i];
+        if (c == '#' || c == '$' || c == '}' || c == '*')
+        {
+            char esc[2] = { '}', c ^ 0x20 };
+            rspWrite(esc, 2);
+        }
+        else
+        {
+            rspWrite(&c, 1);
+        }
+    }
+}
 
-    (void)!write(gdbFd, pkt, plen);
+// Undo the escaping of binary data in place; returns the decoded length
+static int binaryUnescape(uint8_t* buf, int len)
+{
+    int out = 0;
+    for (int i = 0; i < len; i++)
+    {
+        if (buf[i] == '}' && i + 1 < len)
+            buf[out++] = buf[++i] ^ 0x20;
+        else
+            buf[out++] = buf[i];
+    }
+    return out;
 }
 
 // ---------------------------------------------------------------------------
@@ -888,8 +2509,42 @@ static void handleWriteReg(const char* data)
     rspPutPacket("OK");
 }
 
-// 'm addr,len' - read memory
-static void handleReadMem(const char* data)
+// Memory replies are streamed from hudsonReadMem; the packet is opened
+// with the first data, so a read that gets nothing can still answer E01
+struct MemReply
+{
+    int started;
+    int binary;
+};
+
+static void replyMem(void* ctx, const uint8_t* data, int len)
+{
+    struct MemReply* r = ctx;
+    if (!r->started)
+    {
+        rspBegin();
+        if (r->binary)
+            rspWrite("b", 1);
+        r->started = 1;
+    }
+
+    if (r->binary)
+    {
+        rspWriteBinary(data, len);
+        return;
+    }
+    char hex[2 * CACHE_PAGE + 1];
+    while (len > 0)
+    {
+        int n = len < CACHE_PAGE ? len : CACHE_PAGE;
+        hexEncode(hex, data, n);
+        rspWrite(hex, 2 * n);
+        data += n;
+        len -= n;
+    }
+}
+
+static void handleReadMemReply(const char* data, int binary)
 {
     char* comma = strchr(data, ',');
     if (!comma)
@@ -901,23 +2556,33 @@ static void handleReadMem(const char* data)
     uint32_t addr = hexToU32(data);
     uint32_t len = hexToU32(comma + 1);
 
-    if (len > (RSP_BUFSIZE - 1) / 2)
-        len = (RSP_BUFSIZE - 1) / 2;
+    // Hex, or binary with every byte escaped, must fit the packet size
+    if (len > (uint32_t)(packetSize - 1) / 2)
+        len = (packetSize - 1) / 2;
 
-    uint8_t memBuf[2048];
-    if (len > sizeof(memBuf))
-        len = sizeof(memBuf);
-
-    int got = hudsonReadMem(addr, memBuf, len);
-    if (got < 0)
+    struct MemReply r = { 0, binary };
+    int got = hudsonReadMem(addr, len, replyMem, &r);
+    if (got < 0 || (got == 0 && len > 0))
     {
         rspPutPacket("E01");
         return;
     }
+    if (!r.started)
+        rspPutPacket(binary ? "b" : "");
+    else
+        rspEnd();
+}
+
+// 'm addr,len' - read memory
+static void handleReadMem(const char* data)
+{
+    handleReadMemReply(data, 0);
+}
 
-    char hexBuf[RSP_BUFSIZE];
-    hexEncode(hexBuf, memBuf, got);
-    rspPutPacket(hexBuf);
+// 'x addr,len' - read memory, binary reply ("b" followed by escaped data)
+static void handleReadMemBinary(const char* data)
+{
+    handleReadMemReply(data, 1);
 }
 
 // 'M addr,len:XXXX' - write memory
@@ -934,13 +2599,54 @@ static void handleWriteMem(const char* data)
     uint32_t addr = hexToU32(data);
     uint32_t len = hexToU32(comma + 1);
 
-    uint8_t memBuf[2048];
-    if (len > sizeof(memBuf))
-        len = sizeof(memBuf);
+    if (len > strlen(colon + 1) / 2)
+    {
+        rspPutPacket("E01");
+        return;
+    }
 
+    uint8_t* memBuf = malloc(len ? len : 1);
     hexDecode(memBuf, colon + 1, len);
-    hudsonWriteMem(addr, memBuf, len);
-    rspPutPacket("OK");
+    rspPutPacket(hudsonWriteMem(addr, memBuf, len) < 0 ? "E01" : "OK");
+    free(memBuf);
+}
+
+// 'X addr,len:BINARY' - write memory, binary data
+static void handleWriteMemBinary(char* data, int dataLen)
+{
+    char* comma = strchr(data, ',');
+    char* colon = memchr(data, ':', dataLen);
+    if (!comma || !colon || comma > colon)
+    {
+        rspPutPacket("E01");
+        return;
+    }
+
+    uint32_t addr = hexToU32(data);
+    uint32_t len = hexToU32(comma + 1);
+
+    uint8_t* bin = (uint8_t*)colon + 1;
+    int binLen = binaryUnescape(bin, dataLen - (colon + 1 - data));
+    if ((uint32_t)binLen != len)
+    {
+        rspPutPacket("E01");
+        return;
+    }
+
+    // "X addr,0:" is GDB probing for X support
+    rspPutPacket(hudsonWriteMem(addr, bin, len) < 0 ? "E01" : "OK");
+}
+
+// Stop reply. Registers known from a step's dump go along with it (the
+// FP, SP and PC in a T packet), which saves GDB asking for them.
+static void replyStop(int sig)
+{
+    char reply[64];
+    if (regsValid)
+        snprintf(reply, sizeof(reply), "T%02x0e:%08x;0f:%08x;11:%08x;", sig, regs[14], regs[15], regs[17]);
+    else
+        snprintf(reply, sizeof(reply), "S%02x", sig);
+    rspPutPacket(reply);
 }
 
 // 'c [addr]' - continue
@@ -958,7 +2664,7 @@ static void handleContinue(const char* data)
         addr = regs[17];
     }
     int interrupted = hudsonContinue(addr);
-    rspPutPacket(interrupted ? "S02" : "S05");
+    replyStop(interrupted ? 2 : 5);
 }
 
 // 's [addr]' - single step
@@ -975,7 +2681,55 @@ static void handleStep(const char* data)
         addr = regs[17];
     }
     hudsonStep(addr);
-    rspPutPacket("S05");
+    replyStop(5);
+}
+
+// 'vCont?' and 'vCont;action...' - resume with c, s or range step r
+// There is one thread, so only the first action matters
+static void handleVCont(const char* data)
+{
+    if (strcmp(data, "?") == 0)
+    {
+        rspPutPacket("vCont;c;C;s;S;r");
+        return;
+    }
+    if (data[0] != ';')
+    {
+        rspPutPacket("E01");
+        return;
+    }
+
+    if (!regsValid) hudsonFetchRegs();
+    uint32_t addr = regs[17];
+
+    switch (data[1])
+    {
+    case 'c':
+    case 'C':
+        replyStop(hudsonContinue(addr) ? 2 : 5);
+        break;
+    case 's':
+    case 'S':
+        hudsonStep(addr);
+        replyStop(5);
+        break;
+    case 'r':
+    {
+        // "rSTART,END[:thread]"
+        char* comma = strchr(data, ',');
+        if (!comma)
+        {
+            rspPutPacket("E01");
+            return;
+        }
+        int rc = hudsonRangeStep(addr, hexToU32(data + 2), hexToU32(comma + 1));
+        replyStop(rc == 1 ? 2 : 5);
+        break;
+    }
+    default:
+        rspPutPacket("E01");
+        break;
+    }
 }
 
 // 'Z type,addr,kind' - set breakpoint
@@ -996,8 +2750,7 @@ static void handleSetBreakpoint(const char* data)
     }
 
     uint32_t addr = hexToU32(comma1 + 1);
-    hudsonSetBreakpoint(addr);
-    rspPutPacket("OK");
+    rspPutPacket(hudsonSetBreakpoint(addr) < 0 ? "E01" : "OK");
 }
 
 // 'z type,addr,kind' - clear breakpoint
@@ -1017,8 +2770,7 @@ static void handleClearBreakpoint(const char* data)
     }
 
     uint32_t addr = hexToU32(comma1 + 1);
-    hudsonClearBreakpoint(addr);
-    rspPutPacket("OK");
+    rspPutPacket(hudsonClearBreakpoint(addr) < 0 ? "E01" : "OK");
 }
 
 // '?' - halt reason
@@ -1032,7 +2784,9 @@ static void handleQuery(const char* data)
 {
     if (strncmp(data, "Supported", 9) == 0)
     {
-        rspPutPacket("PacketSize=4096");
+        char reply[64];
+        snprintf(reply, sizeof(reply), "PacketSize=%x;binary-upload+", packetSize);
+        rspPutPacket(reply);
     }
     else if (strcmp(data, "Attached") == 0)
     {
@@ -1084,52 +2838,109 @@ static void handleDetach(void)
 // Main dispatch loop
 // ---------------------------------------------------------------------------
 
-static void dispatchLoop(void)
+// Packets an observer may send: those that leave the target alone
+static int observerAllowed(const char* pkt)
 {
-    char pkt[RSP_BUFSIZE];
+    switch (pkt[0])
+    {
+    case 'g': case 'p': case 'm': case 'x': case '?': case 'q': case 'H':
+    case 'k': case 'D':
+        return 1;
+    case 'v':
+        return strcmp(pkt, "vCont?") == 0;
+    }
+    return 0;
+}
 
-    for (;;)
+// Handle one packet from the current client; 0 ends its session
+static int dispatchPacket(char* pkt, int len)
+{
+    if (len == 1 && pkt[0] == 0x03)
+    {
+        // Ctrl-C interrupt - target is already stopped in DB.X
+        rspPutPacket("S05");
+        return 1;
+    }
+
+    char cmd = pkt[0];
+    char* data = pkt + 1;
+
+    if (cur->observer)
     {
-        int len = rspGetPacket(pkt, sizeof(pkt));
-        if (len < 0)
+        if (!observerAllowed(pkt))
         {
-            fprintf(stderr, "GDB disconnected\n");
-            return;
+            rspPutPacket("E01");
+            return 1;
         }
-
-        if (len == 1 && pkt[0] == 0x03)
+        if (cmd == 'k' || cmd == 'D')
         {
-            // Ctrl-C interrupt - target is already stopped in DB.X
-            rspPutPacket("S05");
-            continue;
+            // Breakpoints belong to the controlling session
+            if (cmd == 'D')
+                rspPutPacket("OK");
+            return 0;
         }
+    }
 
-        char cmd = pkt[0];
-        char* data = pkt + 1;
-
-        switch (cmd)
-        {
-        case 'g': handleReadRegs(); break;
-        case 'G': handleWriteRegs(data); break;
-        case 'p': handleReadReg(data); break;
-        case 'P': handleWriteReg(data); break;
-        case 'm': handleReadMem(data); break;
-        case 'M': handleWriteMem(data); break;
-        case 'c': handleContinue(data); break;
-        case 's': handleStep(data); break;
-        case 'Z': handleSetBreakpoint(data); break;
-        case 'z': handleClearBreakpoint(data); break;
-        case '?': handleHaltReason(); break;
-        case 'q': handleQuery(data); break;
-        case 'H': handleSetThread(data); break;
-        case 'k': handleKill(); return;
-        case 'D': handleDetach(); return;
-        default:
-            // Unknown packet - empty response means unsupported
+    switch (cmd)
+    {
+    case 'g': handleReadRegs(); break;
+    case 'G': handleWriteRegs(data); break;
+    case 'p': handleReadReg(data); break;
+    case 'P': handleWriteReg(data); break;
+    case 'm': handleReadMem(data); break;
+    case 'M': handleWriteMem(data); break;
+    case 'x': handleReadMemBinary(data); break;
+    case 'X': handleWriteMemBinary(data, len - 1); break;
+    case 'c': handleContinue(data); break;
+    case 's': handleStep(data); break;
+    case 'Z': handleSetBreakpoint(data); break;
+    case 'z': handleClearBreakpoint(data); break;
+    case '?': handleHaltReason(); break;
+    case 'q': handleQuery(data); break;
+    case 'H': handleSetThread(data); break;
+    case 'v':
+        if (strncmp(data, "Cont", 4) == 0)
+            handleVCont(data + 4);
+        else
             rspPutPacket("");
-            break;
+        break;
+    case 'k': handleKill(); return 0;
+    case 'D': handleDetach(); return 0;
+    default:
+        // Unknown packet - empty response means unsupported
+        rspPutPacket("");
+        break;
+    }
+    return 1;
+}
+
+// Whether a client's ring holds a whole packet or a Ctrl-C, so handling
+// it cannot block on that client while the others wait
+static int clientHasPacket(struct Client* c)
+{
+    uint32_t used = ringUsed(&c->rx);
+    int state = 0;      // 0: before '$', 1: payload, 2-3: checksum
+    for (uint32_t i = 0; i < used; i++)
+    {
+        uint8_t b = c->rx.data[(c->rx.head + i) & (RING_SIZE - 1)];
+        if (state == 0)
+        {
+            if (b == 0x03)
+                return 1;
+            if (b == '$')
+                state = 1;
+        }
+        else if (state == 1)
+        {
+            if (b == '#')
+                state = 2;
+        }
+        else if (++state == 4)
+        {
+            return 1;
         }
     }
+    return 0;
 }
 
 // ---------------------------------------------------------------------------
@@ -1171,6 +2982,60 @@ static int listenGdb(int port)
     return fd;
 }
 
+static void acceptClient(void)
+{
+    struct sockaddr_in clientAddr;
+    socklen_t addrLen = sizeof(clientAddr);
+    int fd = accept(listenFd, (struct sockaddr*)&clientAddr, &addrLen);
+    if (fd < 0)
+    {
+        if (errno != EINTR && errno != EAGAIN)
+            perror("accept");
+        return;
+    }
+
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+    struct Client* slot = NULL;
+    int controlled = 0;
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        if (clients[i].fd < 0 && !slot)
+            slot = &clients[i];
+        else if (clients[i].fd >= 0 && !clients[i].observer)
+            controlled = 1;
+    }
+    if (!slot)
+    {
+        close(fd);
+        return;
+    }
+
+    // Registers and cached memory stay valid: the target has not run
+    slot->fd = fd;
+    slot->eof = 0;
+    slot->observer = controlled;
+    slot->rx.head = slot->rx.tail = 0;
+    fprintf(stderr, "GDB connected from %s:%d%s\n", inet_ntoa(clientAddr.sin_addr),
+            ntohs(clientAddr.sin_port), controlled ? " (observer, read-only)" : "");
+}
+
+static void closeClient(struct Client* c)
+{
+    close(c->fd);
+    c->fd = -1;
+    if (c->observer)
+    {
+        fprintf(stderr, "Observer disconnected\n");
+        return;
+    }
+
+    // A session that ends without D or k leaves no breakpoints behind
+    hudsonClearAllBreakpoints();
+    fprintf(stderr, "GDB disconnected, waiting for new connection...\n");
+}
+
 // ---------------------------------------------------------------------------
 // Usage and main
 // ---------------------------------------------------------------------------
@@ -1186,7 +3051,30 @@ static void usage(const char* prog)
     fprintf(stderr, "  -l PORT   Listen for target connection (for MAME -bitb socket.localhost:PORT)\n");
     fprintf(stderr, "  -p PORT   GDB listen port (default 2345)\n");
     fprintf(stderr, "  -P CHAR   Prompt character: '-' for DB.X (default), '+' for ROM debugger\n");
-    fprintf(stderr, "  -v        Verbose (show protocol traffic on stderr)\n");
+    fprintf(stderr, "  -b BAUD   Serial baud rate (default 9600; e.g. 19200, 38400, 57600, or any\n");
+    fprintf(stderr, "            rate the port supports on Linux)\n");
+    fprintf(stderr, "  -r        RTS/CTS hardware flow control\n");
+    fprintf(stderr, "  -T [ADDR,LEN]\n");
+    fprintf(stderr, "            Measure throughput with large 'd' dumps (default fe0000,10000,\n");
+    fprintf(stderr, "            the IPL ROM) and exit\n");
+    fprintf(stderr, "  -w BYTES  Pipeline window: command bytes sent ahead of DB.X's replies\n");
+    fprintf(stderr, "            (default %d, 0 = wait for each prompt)\n", PIPE_WINDOW);
+    fprintf(stderr, "  -L CHARS  Longest memory-write command line (default %d, 0 = one value\n", DBX_LINE_MAX);
+    fprintf(stderr, "            per command)\n");
+    fprintf(stderr, "  -S BYTES  RSP packet size offered to GDB (default %d)\n", PACKET_SIZE);
+    fprintf(stderr, "  -M N      Serve up to N GDB connections at once (default 1, max %d);\n", MAX_CLIENTS);
+    fprintf(stderr, "            the first controls the target, the others may only read\n");
+    fprintf(stderr, "  -C        Do not cache target memory between reads\n");
+    fprintf(stderr, "  -e ELF    Serve reads of the program's read-only sections from ELF\n");
+    fprintf(stderr, "            (linked with -q so it can be relocated)\n");
+    fprintf(stderr, "  -o ADDR   Load address of the program's text, for -e (hex, default 0)\n");
+    fprintf(stderr, "  -R ROM    Serve reads of the top of memory from ROM image file ROM\n");
+    fprintf(stderr, "  -s PREFIX Profile: run the program, sample its PC and callers, write\n");
+    fprintf(stderr, "            PREFIX.flat and PREFIX.folded (needs -e) and exit\n");
+    fprintf(stderr, "  -i MS     Profile sample interval (default 100)\n");
+    fprintf(stderr, "  -t SECS   Stop profiling after SECS (default: Ctrl-C or program stop)\n");
+    fprintf(stderr, "  -g DEPTH  Callers sampled through the A6 frame chain (default 16, max %d)\n", PROFILE_DEPTH);
+    fprintf(stderr, "  -v        Verbose (show protocol traffic and cache statistics on stderr)\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "MAME setup:\n");
     fprintf(stderr, "  mame x68000 -debug -rs232 null_modem -bitb socket.localhost:1234\n");
@@ -1198,8 +3086,6 @@ static void usage(const char* prog)
     fprintf(stderr, "  m68k-human68k-gdb hello.elf -ex 'target remote :2345'\n");
 }
 
-static volatile int running = 1;
-
 static void sigHandler(int sig)
 {
     (void)sig;
@@ -1211,6 +3097,16 @@ int main(int argc, char** argv)
     int gdbPort = 2345;
     int targetListenPort = 0;
     const char* target = NULL;
+    int speedTest = 0;
+    uint32_t speedAddr = 0xfe0000;
+    uint32_t speedLen = 0x10000;
+    const char* elfPath = NULL;
+    const char* romPath = NULL;
+    uint32_t loadBase = 0;
+    const char* profilePrefix = NULL;
+    int profileInterval = 100;
+    int profileSeconds = 0;
+    int profileDepth = 16;
 
     // Parse arguments
     int i = 1;
@@ -1228,6 +3124,72 @@ int main(int argc, char** argv)
         {
             promptChar = argv[++i][0];
         }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            baudRate = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-r") == 0)
+        {
+            rtscts = 1;
+        }
+        else if (strcmp(argv[i], "-T") == 0)
+        {
+            speedTest = 1;
+            if (i + 1 < argc && strchr(argv[i + 1], ','))
+            {
+                char* comma = strchr(argv[++i], ',');
+                speedAddr = strtoul(argv[i], NULL, 16);
+                speedLen = strtoul(comma + 1, NULL, 16);
+            }
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            pipeWindow = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc)
+        {
+            lineMax = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc)
+        {
+            packetSize = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc)
+        {
+            maxClients = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-C") == 0)
+        {
+            cacheEnabled = 0;
+        }
+        else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+        {
+            elfPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            loadBase = strtoul(argv[++i], NULL, 16);
+        }
+        else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc)
+        {
+            romPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            profilePrefix = argv[++i];
+        }
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+        {
+            profileInterval = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            profileSeconds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+        {
+            profileDepth = atoi(argv[++i]);
+        }
         else if (strcmp(argv[i], "-v") == 0)
         {
             verbose = 1;
@@ -1255,6 +3217,39 @@ int main(int argc, char** argv)
         usage(argv[0]);
         return 1;
     }
+    if (baudRate <= 0)
+    {
+        fprintf(stderr, "Invalid baud rate\n");
+        return 1;
+    }
+    if (packetSize < 256 || packetSize > RING_SIZE - 8)
+    {
+        fprintf(stderr, "Packet size must be between 256 and %d\n", RING_SIZE - 8);
+        return 1;
+    }
+    if (maxClients < 1 || maxClients > MAX_CLIENTS)
+    {
+        fprintf(stderr, "Client count must be between 1 and %d\n", MAX_CLIENTS);
+        return 1;
+    }
+    if (profileInterval < 1 || profileSeconds < 0 || profileDepth < 0 || profileDepth > PROFILE_DEPTH)
+    {
+        fprintf(stderr, "Invalid profile interval, time or depth (at most %d frames)\n", PROFILE_DEPTH);
+        return 1;
+    }
+    if (profilePrefix && !elfPath)
+    {
+        fprintf(stderr, "Profiling needs the program's ELF (-e) for its symbols\n");
+        return 1;
+    }
+    for (i = 0; i < MAX_CLIENTS; i++)
+        clients[i].fd = -1;
+    if (elfPath && backingLoadElf(elfPath, loadBase) < 0)
+        return 1;
+    if (romPath && backingLoadRom(romPath) < 0)
+        return 1;
+    if (profilePrefix && symbolsLoadElf(elfPath, loadBase) < 0)
+        return 1;
 
     signal(SIGINT, sigHandler);
     signal(SIGPIPE, SIG_IGN);
@@ -1280,21 +3275,31 @@ int main(int argc, char** argv)
     {
         targetSend("\r");
 
-        // Use select() with 3-second timeout to avoid blocking forever
-        fd_set fds;
-        struct timeval tv = { .tv_sec = 3, .tv_usec = 0 };
-        FD_ZERO(&fds);
-        FD_SET(targetFd, &fds);
-        int ready = select(targetFd + 1, &fds, NULL, NULL, &tv);
-        if (ready > 0)
-        {
-            targetWaitPrompt(buf, sizeof(buf));
+        // 3-second timeout to avoid blocking forever
+        int n = targetWaitFor(buf, sizeof(buf), promptChar, 1, 3000);
+        if (n == -1)
+            return 1;
+        if (n >= 0)
             break;
-        }
         fprintf(stderr, "  (no response, retrying...)\n");
     }
+    // Prompts answering earlier retries would be taken as command replies
+    targetDrain(200);
     fprintf(stderr, "Got prompt, DB.X is ready\n");
 
+    if (speedTest)
+    {
+        int rc = hudsonSpeedTest(speedAddr, speedLen ? speedLen : 1, 2);
+        close(targetFd);
+        return rc;
+    }
+    if (profilePrefix)
+    {
+        int rc = hudsonProfile(profilePrefix, profileInterval, profileSeconds, profileDepth);
+        close(targetFd);
+        return rc;
+    }
+
     // Listen for GDB connections
     listenFd = listenGdb(gdbPort);
     if (listenFd < 0)
@@ -1304,32 +3309,42 @@ int main(int argc, char** argv)
     }
     fprintf(stderr, "Listening for GDB on port %d\n", gdbPort);
 
-    // Accept GDB connections in a loop
+    // Serve GDB clients: one packet from each in turn
+    char* pkt = malloc(packetSize + 1);
+    int next = 0;
     while (running)
     {
-        struct sockaddr_in clientAddr;
-        socklen_t addrLen = sizeof(clientAddr);
-        gdbFd = accept(listenFd, (struct sockaddr*)&clientAddr, &addrLen);
-        if (gdbFd < 0)
+        int served = 0;
+        for (int k = 0; k < MAX_CLIENTS; k++)
         {
-            if (errno == EINTR) continue;
-            perror("accept");
-            break;
+            struct Client* c = &clients[(next + k) % MAX_CLIENTS];
+            if (c->fd < 0)
+                continue;
+            cur = c;
+            if (clientHasPacket(c))
+            {
+                int len = rspGetPacket(pkt, packetSize + 1);
+                if (len == -2)
+                    rspPutPacket("E01");
+                else if (len < 0 || !dispatchPacket(pkt, len))
+                    closeClient(c);
+                served = 1;
+            }
+            else if (c->eof)
+            {
+                closeClient(c);
+            }
         }
+        cur = NULL;
+        next = (next + 1) % MAX_CLIENTS;
 
-        int flag = 1;
-        setsockopt(gdbFd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
-
-        fprintf(stderr, "GDB connected from %s:%d\n",
-                inet_ntoa(clientAddr.sin_addr), ntohs(clientAddr.sin_port));
-
-        regsValid = 0;
-        dispatchLoop();
-
-        close(gdbFd);
-        gdbFd = -1;
-        fprintf(stderr, "GDB disconnected, waiting for new connection...\n");
+        if (!served && ioPoll(-1) < 0)
+        {
+            fprintf(stderr, "Target connection lost\n");
+            break;
+        }
     }
+    free(pkt);
 
     close(listenFd);
     close(targetFd);
@@ -0,0 +1,602 @@
+// run68-pool - Persistent elf2x68k + run68 front-end for test suites
+//
+// Usage: run68-pool [options] --socket PATH          (server)
+//        run68-pool --client PATH prog.elf [args...] (one job)
+//
+// The server pre-forks worker processes that accept jobs on a unix socket.
+// A job is an ELF file, its arguments, the client's working directory and
+// its stdin/stdout/stderr (passed as descriptors). The worker converts the
+// ELF in-process with elf2x68k's converter into a per-worker X-file on
+// tmpfs, runs run68 on it with the client's descriptors and sends back the
+// exit status. Each test then costs one small client process and the run68
+// execution, instead of a shell, an elf2x68k process and a file on disk.
+//
+// If the client goes away (e.g. a DejaGNU timeout kills it), the worker
+// kills run68 and takes the next job.
+//
+//   run68-pool --daemon --pidfile pool.pid --socket pool.sock -j 8
+//   RUN68_POOL=pool.sock tools/run68-sim.sh prog.elf
+//   kill $(cat pool.pid)
+
+#define ELF2X68K_NO_MAIN
+#include "elf2x68k.c"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+// Request: be32 payload length, then NUL-terminated strings (cwd, ELF path,
+// run68 arguments), with the client's fds 0-2 attached to the first bytes.
+// Reply: be32 status; the run68 exit code, 128+signal, or POOL_CONVERT_FAILED.
+#define POOL_MAX_REQUEST (256 * 1024)
+#define POOL_CONVERT_FAILED 0xFFFFFFFFu
+
+static volatile sig_atomic_t poolStop;
+static int childPipe[2] = { -1, -1 };   // written by the SIGCHLD handler
+
+static void poolStopHandler(int sig)
+{
+    (void)sig;
+    poolStop = 1;
+}
+
+static void poolChildHandler(int sig)
+{
+    (void)sig;
+    int saved = errno;
+    if (write(childPipe[1], "c", 1) < 0)
+    {
+        // pipe full: a wakeup is already pending
+    }
+    errno = saved;
+}
+
+static int readFull(int fd, void* buf, size_t len)
+{
+    uint8_t* p = buf;
+    while (len > 0)
+    {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int writeFull(int fd, const void* buf, size_t len)
+{
+    const uint8_t* p = buf;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Worker
+// ---------------------------------------------------------------------------
+
+struct PoolConfig
+{
+    struct Options opt;     // elf2x68k conversion options
+    const char* run68;      // run68 executable
+    char xfile[PATH_MAX];   // this worker's X-file (on tmpfs)
+    FILE* quiet;            // converter diagnostics are discarded, as in run68-sim.sh
+};
+
+// Receive one request; returns the payload (malloc'd) and the three client
+// descriptors, or NULL if the connection is unusable.
+static char* poolRecv(int conn, uint32_t* lenOut, int fds[3])
+{
+    uint8_t hdr[4];
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(3 * sizeof(int))];
+    } ctrl;
+    struct iovec iov = { hdr, sizeof(hdr) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl.buf;
+    msg.msg_controllen = sizeof(ctrl.buf);
+
+    fds[0] = fds[1] = fds[2] = -1;
+    ssize_t n;
+    do
+        n = recvmsg(conn, &msg, 0);
+    while (n < 0 && errno == EINTR);
+    if (n <= 0)
+        return NULL;
+
+    for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c))
+    {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS &&
+            c->cmsg_len == CMSG_LEN(3 * sizeof(int)))
+            memcpy(fds, CMSG_DATA(c), 3 * sizeof(int));
+    }
+    if (fds[0] < 0 || (n < 4 && readFull(conn, hdr + n, 4 - n) < 0))
+        goto fail;
+
+    uint32_t len = read_be32(hdr);
+    if (len == 0 || len > POOL_MAX_REQUEST)
+        goto fail;
+    char* payload = malloc(len + 1);
+    if (readFull(conn, payload, len) < 0)
+    {
+        free(payload);
+        goto fail;
+    }
+    payload[len] = '\0';
+    *lenOut = len;
+    return payload;
+
+fail:
+    for (int i = 0; i < 3; i++)
+    {
+        if (fds[i] >= 0)
+            close(fds[i]);
+    }
+    return NULL;
+}
+
+// Run run68 on the converted file with the client's stdio; returns the
+// status to report, killing run68 if the client disconnects first.
+static uint32_t poolRun(const struct PoolConfig* cfg, int conn, const int fds[3], char** args,
+                        int numArgs)
+{
+    char** argv = malloc((numArgs + 3) * sizeof(char*));
+    argv[0] = (char*)cfg->run68;
+    argv[1] = (char*)cfg->xfile;
+    memcpy(argv + 2, args, numArgs * sizeof(char*));
+    argv[numArgs + 2] = NULL;
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // own process group, so a kill also reaches anything run68 started
+        setpgid(0, 0);
+        for (int i = 0; i < 3; i++)
+            dup2(fds[i], i);
+        signal(SIGCHLD, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        execv(cfg->run68, argv);
+        fprintf(stderr, "run68-pool: %s: %s\n", cfg->run68, strerror(errno));
+        _exit(127);
+    }
+    free(argv);
+    if (pid < 0)
+        return 127;
+    setpgid(pid, pid);
+
+    struct pollfd pfd[2] = { { childPipe[0], POLLIN, 0 }, { conn, POLLIN, 0 } };
+    int status = 0;
+    int killed = 0;
+    for (;;)
+    {
+        pid_t r = waitpid(pid, &status, WNOHANG);
+        if (r == pid || (r < 0 && errno != EINTR))
+            break;
+
+        if (poll(pfd, killed ? 1 : 2, -1) < 0 && errno != EINTR)
+            break;
+        if (pfd[0].revents & POLLIN)
+        {
+            char drain[64];
+            if (read(childPipe[0], drain, sizeof(drain)) < 0)
+            {
+                // nothing to drain
+            }
+        }
+        if (!killed && (pfd[1].revents & (POLLIN | POLLHUP | POLLERR)))
+        {
+            // the client never sends after the request, so this is EOF
+            kill(-pid, SIGKILL);
+            killed = 1;
+        }
+    }
+
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
+
+static void poolJob(const struct PoolConfig* cfg, int conn)
+{
+    uint32_t len;
+    int fds[3];
+    char* payload = poolRecv(conn, &len, fds);
+    if (!payload)
+        return;
+
+    // split cwd, ELF and arguments
+    char* strs[256];
+    int numStrs = 0;
+    for (uint32_t pos = 0; pos < len && numStrs < 256; pos += strlen(payload + pos) + 1)
+        strs[numStrs++] = payload + pos;
+
+    uint32_t result = POOL_CONVERT_FAILED;
+    if (numStrs >= 2 && chdir(strs[0]) == 0 &&
+        convertFile(&cfg->opt, strs[1], cfg->xfile, cfg->quiet) == 0)
+        result = poolRun(cfg, conn, fds, strs + 2, numStrs - 2);
+
+    uint8_t reply[4];
+    putBe32(reply, result);
+    writeFull(conn, reply, sizeof(reply));
+
+    for (int i = 0; i < 3; i++)
+        close(fds[i]);
+    free(payload);
+}
+
+static void poolWorker(const struct PoolConfig* base, int listenFd, const char* tmpDir)
+{
+    struct PoolConfig cfg = *base;
+    snprintf(cfg.xfile, sizeof(cfg.xfile), "%s/run68-pool.%d.x", tmpDir, (int)getpid());
+
+    if (pipe(childPipe) < 0)
+        _exit(1);
+    fcntl(childPipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(childPipe[1], F_SETFL, O_NONBLOCK);
+    fcntl(childPipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(childPipe[1], F_SETFD, FD_CLOEXEC);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = poolChildHandler;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, NULL);
+    sa.sa_handler = poolStopHandler;
+    sa.sa_flags = 0;
+    sigaction(SIGTERM, &sa, NULL);
+
+    while (!poolStop)
+    {
+        int conn = accept(listenFd, NULL, NULL);
+        if (conn < 0)
+            continue;
+        fcntl(conn, F_SETFD, FD_CLOEXEC);
+        poolJob(&cfg, conn);
+        close(conn);
+    }
+
+    unlink(cfg.xfile);
+    _exit(0);
+}
+
+// ---------------------------------------------------------------------------
+// Server
+// ---------------------------------------------------------------------------
+
+static pid_t poolSpawn(const struct PoolConfig* cfg, int listenFd, const char* tmpDir)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+        poolWorker(cfg, listenFd, tmpDir);
+    if (pid < 0)
+        fprintf(stderr, "run68-pool: fork: %s\n", strerror(errno));
+    return pid;
+}
+
+static int runServer(const struct PoolConfig* cfg, const char* sockPath, int numWorkers,
+                     int daemonize, const char* pidFile)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(sockPath) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "run68-pool: socket path too long: %s\n", sockPath);
+        return 1;
+    }
+    strcpy(addr.sun_path, sockPath);
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(sockPath);
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(listenFd, 64) < 0)
+    {
+        fprintf(stderr, "run68-pool: %s: %s\n", sockPath, strerror(errno));
+        return 1;
+    }
+    fcntl(listenFd, F_SETFD, FD_CLOEXEC);
+
+    // Converted files live on tmpfs where there is one
+    struct stat st;
+    const char* tmpDir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    if (stat("/dev/shm", &st) == 0 && S_ISDIR(st.st_mode) && access("/dev/shm", W_OK) == 0)
+        tmpDir = "/dev/shm";
+
+    // The socket accepts connections from here on, so once a daemonizing
+    // parent exits, clients can connect
+    if (daemonize)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            fprintf(stderr, "run68-pool: fork: %s\n", strerror(errno));
+            return 1;
+        }
+        if (pid > 0)
+        {
+            if (pidFile)
+            {
+                FILE* f = fopen(pidFile, "w");
+                if (!f)
+                {
+                    fprintf(stderr, "run68-pool: %s: %s\n", pidFile, strerror(errno));
+                    kill(pid, SIGTERM);
+                    return 1;
+                }
+                fprintf(f, "%d\n", (int)pid);
+                fclose(f);
+            }
+            return 0;
+        }
+        setsid();
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = poolStopHandler;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    pid_t* workers = calloc(numWorkers, sizeof(pid_t));
+    for (int i = 0; i < numWorkers; i++)
+        workers[i] = poolSpawn(cfg, listenFd, tmpDir);
+
+    // Replace workers that die until told to stop
+    while (!poolStop)
+    {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+        {
+            if (errno == ECHILD)
+                break;
+            continue;
+        }
+        for (int i = 0; i < numWorkers; i++)
+        {
+            if (workers[i] == pid)
+            {
+                workers[i] = poolStop ? -1 : poolSpawn(cfg, listenFd, tmpDir);
+                break;
+            }
+        }
+    }
+
+    close(listenFd);
+    unlink(sockPath);
+    for (int i = 0; i < numWorkers; i++)
+    {
+        if (workers[i] > 0)
+            kill(workers[i], SIGTERM);
+    }
+    while (waitpid(-1, NULL, 0) > 0 || errno == EINTR)
+        ;
+    free(workers);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Client
+// ---------------------------------------------------------------------------
+
+static int runClient(const char* sockPath, int argc, char* argv[])
+{
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd)))
+    {
+        fprintf(stderr, "run68-pool: getcwd: %s\n", strerror(errno));
+        return 1;
+    }
+
+    size_t len = strlen(cwd) + 1;
+    for (int i = 0; i < argc; i++)
+        len += strlen(argv[i]) + 1;
+    if (len > POOL_MAX_REQUEST || argc > 254)
+    {
+        fprintf(stderr, "run68-pool: command line too long\n");
+        return 1;
+    }
+
+    uint8_t* req = malloc(4 + len);
+    putBe32(req, len);
+    size_t pos = 4;
+    memcpy(req + pos, cwd, strlen(cwd) + 1);
+    pos += strlen(cwd) + 1;
+    for (int i = 0; i < argc; i++)
+    {
+        memcpy(req + pos, argv[i], strlen(argv[i]) + 1);
+        pos += strlen(argv[i]) + 1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sockPath, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        fprintf(stderr, "run68-pool: %s: %s\n", sockPath, strerror(errno));
+        free(req);
+        return 1;
+    }
+
+    // The descriptors travel with the first part of the request
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(3 * sizeof(int))];
+    } ctrl;
+    memset(&ctrl, 0, sizeof(ctrl));
+    struct iovec iov = { req, 4 + len };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl.buf;
+    msg.msg_controllen = sizeof(ctrl.buf);
+    struct cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(3 * sizeof(int));
+    int stdFds[3] = { 0, 1, 2 };
+    memcpy(CMSG_DATA(c), stdFds, sizeof(stdFds));
+
+    ssize_t n;
+    do
+        n = sendmsg(fd, &msg, 0);
+    while (n < 0 && errno == EINTR);
+    if (n < 0 || writeFull(fd, req + n, 4 + len - n) < 0)
+    {
+        fprintf(stderr, "run68-pool: send: %s\n", strerror(errno));
+        free(req);
+        return 1;
+    }
+    free(req);
+
+    uint8_t reply[4];
+    if (readFull(fd, reply, sizeof(reply)) < 0)
+    {
+        fprintf(stderr, "run68-pool: no reply from server\n");
+        return 1;
+    }
+    close(fd);
+
+    uint32_t status = read_be32(reply);
+    if (status == POOL_CONVERT_FAILED)
+    {
+        fprintf(stderr, "run68-sim: elf2x68k conversion failed\n");
+        return 1;
+    }
+    return status;
+}
+
+// ---------------------------------------------------------------------------
+// Usage and main
+// ---------------------------------------------------------------------------
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [options] --socket PATH\n", prog);
+    fprintf(stderr, "       %s --client PATH prog.elf [args...]\n", prog);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Server options:\n");
+    fprintf(stderr, "  -j N            Worker processes (default: CPU count)\n");
+    fprintf(stderr, "  --run68 FILE    run68 executable (default: $HUMAN68K_PREFIX/bin/run68)\n");
+    fprintf(stderr, "  --daemon        Return once the socket is listening\n");
+    fprintf(stderr, "  --pidfile FILE  Write the server pid to FILE (with --daemon)\n");
+    fprintf(stderr, "  -s, --optimize-relocs, --compress\n");
+    fprintf(stderr, "                  Conversion options, as for elf2x68k\n");
+}
+
+int main(int argc, char* argv[])
+{
+    struct PoolConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+
+    const char* sockPath = NULL;
+    const char* clientPath = NULL;
+    const char* pidFile = NULL;
+    int numWorkers = 0;
+    int daemonize = 0;
+    int argIdx = 1;
+
+    while (argIdx < argc && argv[argIdx][0] == '-' && !clientPath)
+    {
+        if (strcmp(argv[argIdx], "--socket") == 0 && argIdx + 1 < argc)
+            sockPath = argv[++argIdx];
+        else if (strcmp(argv[argIdx], "--client") == 0 && argIdx + 1 < argc)
+            clientPath = argv[++argIdx];
+        else if (strcmp(argv[argIdx], "--run68") == 0 && argIdx + 1 < argc)
+            cfg.run68 = argv[++argIdx];
+        else if (strcmp(argv[argIdx], "--pidfile") == 0 && argIdx + 1 < argc)
+            pidFile = argv[++argIdx];
+        else if (strcmp(argv[argIdx], "--daemon") == 0)
+            daemonize = 1;
+        else if (strcmp(argv[argIdx], "-j") == 0 && argIdx + 1 < argc)
+            numWorkers = atoi(argv[++argIdx]);
+        else if (strncmp(argv[argIdx], "-j", 2) == 0 && argv[argIdx][2] != '\0')
+            numWorkers = atoi(argv[argIdx] + 2);
+        else if (strcmp(argv[argIdx], "-s") == 0)
+            cfg.opt.includeSymbols = 1;
+        else if (strcmp(argv[argIdx], "--optimize-relocs") == 0)
+            cfg.opt.optimizeRelocs = 1;
+        else if (strcmp(argv[argIdx], "--compress") == 0)
+            cfg.opt.compress = 1;
+        else if (strcmp(argv[argIdx], "-h") == 0 || strcmp(argv[argIdx], "--help") == 0)
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[argIdx]);
+            usage(argv[0]);
+            return 1;
+        }
+        argIdx++;
+    }
+
+    if (clientPath)
+    {
+        if (argIdx >= argc)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        return runClient(clientPath, argc - argIdx, argv + argIdx);
+    }
+
+    if (!sockPath || argIdx != argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    char run68[PATH_MAX];
+    if (!cfg.run68)
+    {
+        const char* prefix = getenv("HUMAN68K_PREFIX");
+        snprintf(run68, sizeof(run68), "%s/bin/run68", prefix ? prefix : "/opt/human68k");
+        cfg.run68 = run68;
+    }
+    if (access(cfg.run68, X_OK) != 0)
+    {
+        fprintf(stderr, "run68-pool: %s: %s\n", cfg.run68, strerror(errno));
+        return 1;
+    }
+
+    cfg.quiet = fopen("/dev/null", "w");
+    if (!cfg.quiet)
+    {
+        fprintf(stderr, "run68-pool: /dev/null: %s\n", strerror(errno));
+        return 1;
+    }
+
+    if (numWorkers <= 0)
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        numWorkers = n > 0 ? (int)n : 1;
+    }
+
+    return runServer(&cfg, sockPath, numWorkers, daemonize, pidFile);
+}
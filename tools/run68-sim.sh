@@ -1,6 +1,9 @@
 #!/bin/sh
 # Wrapper for DejaGNU: convert ELF to X-file and run with run68
 # Usage: run68-sim.sh <elf-binary> [args...]
+# Extra elf2x68k options (e.g. --compress) can be passed in ELF2X68K_FLAGS.
+# If RUN68_POOL names the socket of a running run68-pool server, the job is
+# handed to it instead (conversion options are then the server's).
 
 PREFIX="${HUMAN68K_PREFIX:-/opt/human68k}"
 ELF2X68K="${PREFIX}/bin/elf2x68k"
@@ -14,8 +17,12 @@ if [ ! -f "$ELF" ]; then
     exit 1
 fi
 
+if [ -n "$RUN68_POOL" ] && [ -S "$RUN68_POOL" ]; then
+    exec "${PREFIX}/bin/run68-pool" --client "$RUN68_POOL" "$ELF" "$@"
+fi
+
 XFILE="${ELF}.x"
-"$ELF2X68K" "$ELF" "$XFILE" 2>/dev/null
+"$ELF2X68K" $ELF2X68K_FLAGS "$ELF" "$XFILE" 2>/dev/null
 if [ $? -ne 0 ]; then
     echo "run68-sim: elf2x68k conversion failed" >&2
     exit 1
@@ -0,0 +1,507 @@
+// x68kdump - Inspect Human68k X-files
+//
+// Usage: x68kdump [options] file.x [file.x ...]
+//
+// Prints the header fields, decodes the delta-encoded relocation table,
+// lists the symbol table and maps addresses back to symbols, e.g. for
+// crash triage:
+//
+//   x68kdump -r -t prog.x
+//   x68kdump -b 0x3a100 -a 0x3c2f4 prog.x       (PC from a register dump)
+//   grep -o 'PC=[0-9a-f]*' log | cut -c4- | x68kdump -a - prog.x
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define X_HEADER_SIZE 0x40
+#define X_SYM_EXTERNAL 0x00
+#define X_SYM_LOCAL 0x02
+
+static uint16_t read_be16(const uint8_t* p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static uint32_t read_be32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// Header fields (offsets as written by elf2x68k)
+struct XHeader
+{
+    uint8_t loadMode;       // 0x03
+    uint32_t base;          // 0x04
+    uint32_t entry;         // 0x08
+    uint32_t textSize;      // 0x0C
+    uint32_t dataSize;      // 0x10
+    uint32_t bssSize;       // 0x14
+    uint32_t relSize;       // 0x18
+    uint32_t symSize;       // 0x1C
+    uint32_t scdLineSize;   // 0x20
+    uint32_t scdSymSize;    // 0x24
+    uint32_t scdStrSize;    // 0x28
+    uint32_t bindOffset;    // 0x3C
+};
+
+struct XSym
+{
+    uint32_t value;
+    uint8_t location;       // X_SYM_EXTERNAL or X_SYM_LOCAL
+    uint8_t section;        // 1=text, 2=data, 3=bss, others (common, ...) as is
+    const char* name;
+    int nameLen;
+};
+
+// One mapped X-file with its decoded symbol table
+struct XFile
+{
+    const char* path;
+    const uint8_t* data;
+    size_t size;
+    struct XHeader hdr;
+    const uint8_t* image;   // text+data
+    const uint8_t* rel;
+    const uint8_t* sym;
+    struct XSym* syms;      // sorted by section, then value
+    int numSyms;
+    struct XSym** byValue;  // sorted by value, for address lookup
+};
+
+static const char* sectionName(uint8_t section)
+{
+    switch (section)
+    {
+    case 1: return "text";
+    case 2: return "data";
+    case 3: return "bss";
+    case 4: return "stack";
+    default: return "?";
+    }
+}
+
+static int symSectionCmp(const void* a, const void* b)
+{
+    const struct XSym* sa = a;
+    const struct XSym* sb = b;
+    if (sa->section != sb->section)
+        return sa->section - sb->section;
+    if (sa->value != sb->value)
+        return sa->value < sb->value ? -1 : 1;
+    return 0;
+}
+
+static int symValueCmp(const void* a, const void* b)
+{
+    const struct XSym* sa = *(const struct XSym* const*)a;
+    const struct XSym* sb = *(const struct XSym* const*)b;
+    if (sa->value != sb->value)
+        return sa->value < sb->value ? -1 : 1;
+    // prefer global names for aliases
+    return sa->location - sb->location;
+}
+
+static void xfileClose(struct XFile* xf)
+{
+    if (xf->data)
+        munmap((void*)xf->data, xf->size);
+    free(xf->syms);
+    free(xf->byValue);
+    memset(xf, 0, sizeof(*xf));
+}
+
+static int xfileOpen(const char* path, struct XFile* xf)
+{
+    memset(xf, 0, sizeof(*xf));
+    xf->path = path;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < X_HEADER_SIZE)
+    {
+        fprintf(stderr, "%s: not an X-file (too short)\n", path);
+        close(fd);
+        return -1;
+    }
+
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    xf->data = p;
+    xf->size = st.st_size;
+
+    const uint8_t* h = xf->data;
+    if (h[0] != 'H' || h[1] != 'U')
+    {
+        fprintf(stderr, "%s: not an X-file (bad magic)\n", path);
+        xfileClose(xf);
+        return -1;
+    }
+
+    xf->hdr.loadMode = h[3];
+    xf->hdr.base = read_be32(h + 0x04);
+    xf->hdr.entry = read_be32(h + 0x08);
+    xf->hdr.textSize = read_be32(h + 0x0C);
+    xf->hdr.dataSize = read_be32(h + 0x10);
+    xf->hdr.bssSize = read_be32(h + 0x14);
+    xf->hdr.relSize = read_be32(h + 0x18);
+    xf->hdr.symSize = read_be32(h + 0x1C);
+    xf->hdr.scdLineSize = read_be32(h + 0x20);
+    xf->hdr.scdSymSize = read_be32(h + 0x24);
+    xf->hdr.scdStrSize = read_be32(h + 0x28);
+    xf->hdr.bindOffset = read_be32(h + 0x3C);
+
+    uint64_t end = X_HEADER_SIZE + (uint64_t)xf->hdr.textSize + xf->hdr.dataSize +
+                   xf->hdr.relSize + xf->hdr.symSize;
+    if (end > xf->size)
+    {
+        fprintf(stderr, "%s: truncated (header says %llu bytes, file has %zu)\n",
+                path, (unsigned long long)end, xf->size);
+        xfileClose(xf);
+        return -1;
+    }
+
+    xf->image = xf->data + X_HEADER_SIZE;
+    xf->rel = xf->image + xf->hdr.textSize + xf->hdr.dataSize;
+    xf->sym = xf->rel + xf->hdr.relSize;
+
+    // Symbol table: location, section, 32-bit value, NUL-terminated name
+    // padded to an even length. Count first, then decode in one pass.
+    const uint8_t* sp = xf->sym;
+    const uint8_t* symEnd = xf->sym + xf->hdr.symSize;
+    int count = 0;
+    while (symEnd - sp >= 6)
+    {
+        const uint8_t* nul = memchr(sp + 6, 0, symEnd - (sp + 6));
+        if (!nul)
+            break;
+        count++;
+        sp += 6 + ((nul - (sp + 6) + 2) & ~1);
+    }
+
+    xf->syms = malloc((count ? count : 1) * sizeof(struct XSym));
+    xf->byValue = malloc((count ? count : 1) * sizeof(struct XSym*));
+    sp = xf->sym;
+    for (int i = 0; i < count; i++)
+    {
+        struct XSym* s = &xf->syms[i];
+        s->location = sp[0];
+        s->section = sp[1];
+        s->value = read_be32(sp + 2);
+        s->name = (const char*)sp + 6;
+        s->nameLen = strlen(s->name);
+        sp += 6 + ((s->nameLen + 2) & ~1);
+    }
+    xf->numSyms = count;
+
+    qsort(xf->syms, count, sizeof(struct XSym), symSectionCmp);
+    for (int i = 0; i < count; i++)
+        xf->byValue[i] = &xf->syms[i];
+    qsort(xf->byValue, count, sizeof(struct XSym*), symValueCmp);
+
+    return 0;
+}
+
+// Closest symbol at or below addr (binary search), or NULL. Of several
+// symbols at the same value the first (global) one is returned.
+static const struct XSym* symLookup(const struct XFile* xf, uint32_t addr)
+{
+    int lo = 0;
+    int hi = xf->numSyms;
+
+    // first index with value > addr
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (xf->byValue[mid]->value <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return NULL;
+
+    int i = lo - 1;
+    while (i > 0 && xf->byValue[i - 1]->value == xf->byValue[i]->value)
+        i--;
+    return xf->byValue[i];
+}
+
+static void printSymAddr(FILE* out, const struct XFile* xf, uint32_t addr)
+{
+    uint32_t imageEnd = xf->hdr.textSize + xf->hdr.dataSize + xf->hdr.bssSize;
+    const struct XSym* s = symLookup(xf, addr);
+
+    // Past the end of bss only an exact match is meaningful
+    if (s && addr >= imageEnd && addr != s->value)
+        s = NULL;
+
+    if (s)
+    {
+        fprintf(out, "%.*s", s->nameLen, s->name);
+        if (addr != s->value)
+            fprintf(out, "+0x%x", addr - s->value);
+    }
+    else
+    {
+        fprintf(out, "?");
+    }
+
+    if (addr < xf->hdr.textSize)
+        fprintf(out, " (text)");
+    else if (addr < xf->hdr.textSize + xf->hdr.dataSize)
+        fprintf(out, " (data)");
+    else if (addr < imageEnd)
+        fprintf(out, " (bss)");
+    else
+        fprintf(out, " (outside image)");
+}
+
+static void dumpHeader(const struct XFile* xf)
+{
+    const struct XHeader* h = &xf->hdr;
+    printf("Load mode:    %u\n", h->loadMode);
+    printf("Base:         0x%08x\n", h->base);
+    printf("Entry:        0x%08x\n", h->entry);
+    printf("Text:         0x%08x - 0x%08x (%u bytes)\n", 0, h->textSize, h->textSize);
+    printf("Data:         0x%08x - 0x%08x (%u bytes)\n",
+           h->textSize, h->textSize + h->dataSize, h->dataSize);
+    printf("BSS:          0x%08x - 0x%08x (%u bytes)\n", h->textSize + h->dataSize,
+           h->textSize + h->dataSize + h->bssSize, h->bssSize);
+    printf("Relocations:  %u bytes\n", h->relSize);
+    printf("Symbols:      %u bytes (%d entries)\n", h->symSize, xf->numSyms);
+    if (h->scdLineSize || h->scdSymSize || h->scdStrSize)
+        printf("SCD debug:    line %u, sym %u, str %u bytes\n",
+               h->scdLineSize, h->scdSymSize, h->scdStrSize);
+    if (h->bindOffset)
+        printf("Bind list:    0x%08x\n", h->bindOffset);
+    printf("File size:    %zu bytes\n", xf->size);
+}
+
+// Decode the relocation table: 16-bit deltas from the previous location,
+// 0x0001 followed by a 32-bit delta for large gaps. An odd delta marks a
+// 16-bit (word) relocation at the even address below it.
+static int dumpRelocs(const struct XFile* xf)
+{
+    uint32_t imageSize = xf->hdr.textSize + xf->hdr.dataSize;
+    const uint8_t* p = xf->rel;
+    const uint8_t* end = xf->rel + xf->hdr.relSize;
+    uint32_t pos = 0;
+    int count = 0, longs = 0, words = 0, errors = 0;
+
+    printf("Relocations:\n");
+    while (end - p >= 2)
+    {
+        uint32_t delta = read_be16(p);
+        p += 2;
+        if (delta == 1)
+        {
+            if (end - p < 4)
+            {
+                printf("  error: truncated long entry at table offset 0x%x\n",
+                       (unsigned)(p - 2 - xf->rel));
+                errors++;
+                break;
+            }
+            delta = read_be32(p);
+            p += 4;
+            longs++;
+        }
+
+        int word = delta & 1;
+        pos += delta & ~1u;
+        if (word)
+            words++;
+        count++;
+
+        int size = word ? 2 : 4;
+        if (pos + size > imageSize)
+        {
+            printf("  %08x  error: outside text+data\n", pos);
+            errors++;
+            continue;
+        }
+
+        uint32_t target = word ? read_be16(xf->image + pos) : read_be32(xf->image + pos);
+        printf("  %08x  %s %-4s -> %08x  ", pos, word ? "word" : "long",
+               pos < xf->hdr.textSize ? "text" : "data", target);
+        printSymAddr(stdout, xf, target);
+        printf("\n");
+    }
+    if (p != end)
+    {
+        printf("  error: %d stray byte(s) at end of table\n", (int)(end - p));
+        errors++;
+    }
+    printf("%d relocations (%d long-form, %d word), %d errors\n", count, longs, words, errors);
+    return errors ? -1 : 0;
+}
+
+static void dumpSymbols(const struct XFile* xf)
+{
+    printf("Symbols:\n");
+    for (int i = 0; i < xf->numSyms; i++)
+    {
+        const struct XSym* s = &xf->syms[i];
+        printf("  %08x  %-5s %c  %.*s\n", s->value, sectionName(s->section),
+               s->location == X_SYM_EXTERNAL ? 'g' : 'l', s->nameLen, s->name);
+    }
+}
+
+static void lookupOne(const struct XFile* xf, const char* arg, uint32_t base)
+{
+    char* endp;
+    uint32_t addr = strtoul(arg, &endp, 16);
+    if (endp == arg)
+    {
+        fprintf(stderr, "%s: bad address '%s'\n", xf->path, arg);
+        return;
+    }
+    addr -= base;
+    printf("%08x  ", addr);
+    printSymAddr(stdout, xf, addr);
+    printf("\n");
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [options] file.x [file.x ...]\n", prog);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -f              Print the header (default without -r/-t/-a)\n");
+    fprintf(stderr, "  -r              Decode the relocation table\n");
+    fprintf(stderr, "  -t              List symbols sorted by section and value\n");
+    fprintf(stderr, "  -a ADDR         Look up the symbol for a hex address (repeatable);\n");
+    fprintf(stderr, "                  '-' reads addresses from stdin, one per line\n");
+    fprintf(stderr, "  -b BASE         Load address to subtract from -a addresses\n");
+}
+
+int main(int argc, char* argv[])
+{
+    int showHeader = 0, showRelocs = 0, showSyms = 0;
+    const char** addrs = calloc(argc, sizeof(char*));
+    int numAddrs = 0;
+    int addrStdin = 0;
+    uint32_t base = 0;
+    int argIdx = 1;
+
+    while (argIdx < argc && argv[argIdx][0] == '-' && argv[argIdx][1] != '\0')
+    {
+        if (strcmp(argv[argIdx], "-f") == 0)
+            showHeader = 1;
+        else if (strcmp(argv[argIdx], "-r") == 0)
+            showRelocs = 1;
+        else if (strcmp(argv[argIdx], "-t") == 0)
+            showSyms = 1;
+        else if (strcmp(argv[argIdx], "-a") == 0 && argIdx + 1 < argc)
+        {
+            argIdx++;
+            if (strcmp(argv[argIdx], "-") == 0)
+                addrStdin = 1;
+            else
+                addrs[numAddrs++] = argv[argIdx];
+        }
+        else if (strcmp(argv[argIdx], "-b") == 0 && argIdx + 1 < argc)
+            base = strtoul(argv[++argIdx], NULL, 16);
+        else if (strcmp(argv[argIdx], "-h") == 0 || strcmp(argv[argIdx], "--help") == 0)
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[argIdx]);
+            usage(argv[0]);
+            return 1;
+        }
+        argIdx++;
+    }
+
+    if (argIdx >= argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!showRelocs && !showSyms && numAddrs == 0 && !addrStdin)
+        showHeader = 1;
+
+    // stdin addresses are read once and applied to every file
+    char* stdinBuf = NULL;
+    size_t stdinLen = 0;
+    if (addrStdin)
+    {
+        FILE* mem = open_memstream(&stdinBuf, &stdinLen);
+        char chunk[65536];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), stdin)) > 0)
+            fwrite(chunk, 1, n, mem);
+        fclose(mem);
+    }
+
+    int numFiles = argc - argIdx;
+    int rc = 0;
+
+    for (; argIdx < argc; argIdx++)
+    {
+        struct XFile xf;
+        if (xfileOpen(argv[argIdx], &xf) < 0)
+        {
+            rc = 1;
+            continue;
+        }
+
+        if (numFiles > 1)
+            printf("%s:\n", xf.path);
+        if (showHeader)
+            dumpHeader(&xf);
+        if (showRelocs && dumpRelocs(&xf) < 0)
+            rc = 1;
+        if (showSyms)
+            dumpSymbols(&xf);
+        for (int i = 0; i < numAddrs; i++)
+            lookupOne(&xf, addrs[i], base);
+
+        if (stdinBuf)
+        {
+            char* line = stdinBuf;
+            while (line < stdinBuf + stdinLen)
+            {
+                char* nl = memchr(line, '\n', stdinBuf + stdinLen - line);
+                if (nl)
+                    *nl = '\0';
+                while (*line == ' ' || *line == '\t')
+                    line++;
+                if (*line)
+                    lookupOne(&xf, line, base);
+                if (!nl)
+                    break;
+                *nl = '\n';
+                line = nl + 1;
+            }
+        }
+
+        xfileClose(&xf);
+    }
+
+    free(stdinBuf);
+    free(addrs);
+    return rc;
+}